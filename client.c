@@ -11,38 +11,60 @@
 #include <readline/readline.h>
 #include <readline/history.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include "protocol.h"
+#include "compression.h"
+#include "driver.h"
 
 // defined constants
 #define QUERY_TYPES 21             // number of supported queries (e.g. select, fetch, update)
 #define QUERY_ARGUMENTS 15         // maximum number of arguments for a query
+#define BINARY_RECEIVE_CHUNK 65536 // values of a binary result decoded at a time
 
 // variables
 int socketfd;                      // socket file descriptor for the server
 char* queries[QUERY_TYPES];        // array of supported queries
+bool renderBinaryResults = true;   // false to only report the size and rate of binary results
+bool compressResults = false;      // true to ask the server to compress large results
 
 // function prototypes
 void getQuery(void);
 void parseQuery(char* query);
+void receiveAll(void* buffer, size_t length);
+void receiveBinaryResult(bool compressed);
+void requestCompression(void);
+int connectToServer(char* socketPath);
 
 // error handling
 void quit(void);
 
 int main(int argc, char const *argv[])
 {
-    // set up a socket and get the file descriptor of the server
-    socketfd = 0; 
-    char recvBuff[1024];
-    struct sockaddr_in serv_addr; 
-    char* server_ip = "127.0.0.1";
-    memset(recvBuff, '0', sizeof(recvBuff));
-    if ((socketfd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    // replay a script over many connections instead of reading queries interactively
+    if ((argc > 1) && (strcmp(argv[1], "--driver") == 0))
     {
-        printf("Error: Count not create socket\n");
-        return 1;
-    } 
-    memset(&serv_addr, '0', sizeof(serv_addr)); 
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(5000);
+        return runDriver(argc, argv);
+    }
+
+    // options: --no-render to not print binary results, --socket path to connect through a Unix
+    // domain socket instead of TCP, --compress to have large results compressed
+    char* socketPath = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--no-render") == 0)
+            renderBinaryResults = false;
+        else if (strcmp(argv[i], "--compress") == 0)
+            compressResults = true;
+        else if ((strcmp(argv[i], "--socket") == 0) && (i + 1 < argc))
+            socketPath = (char*)argv[++i];
+    }
 
     // clear terminal window (for aesthetics)
     printf("\033[2J");
@@ -52,13 +74,9 @@ int main(int argc, char const *argv[])
     printf("=============================== PersonalDB - Client ===============================\n");
     printf("Waiting for a server to connect to....\n");
 
-    // connect to the client
-    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr)<=0)
-    {
-        printf("inet_pton error occured\n");
-        return 1;
-    }
-    if (connect(socketfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    // connect to the server
+    socketfd = connectToServer(socketPath);
+    if (socketfd < 0)
     {
        printf("The call to socket() failed, please wait a few seconds and try again.\n");
        return 2;
@@ -66,6 +84,8 @@ int main(int argc, char const *argv[])
 
     // print message
     printf("Connection received from file descriptor %d.\n", socketfd);
+    if (compressResults)
+        requestCompression();
     printf("Ready to send queries to server.\n");
     printf("=====\n");
 
@@ -124,14 +144,19 @@ void getQuery(void)
 
     // get the number of chars in the response message
     int messageLength;
-    int bytesReceivedFromServerB = 0;
-    while ((bytesReceivedFromServerB = recv(socketfd, &messageLength, sizeof(int), 0)) <= 0);    
+    receiveAll(&messageLength, sizeof(int));
     write(socketfd, &storage, sizeof(bool));          
 
-    // get the response message and print it
+    // get the response message and print it, a binary result is decoded as it arrives
+    if ((messageLength == BINARY_RESPONSE) || (messageLength == BINARY_DESCRIPTOR_RESPONSE) || (messageLength == BINARY_COMPRESSED_RESPONSE))
+    {
+        receiveBinaryResult(messageLength == BINARY_COMPRESSED_RESPONSE);
+        free(query);
+        printf("=====\n");
+        return;
+    }
     char* response = malloc(messageLength * sizeof(char));
-    int bytesReceivedFromServerC = 0;
-    while ((bytesReceivedFromServerC = recv(socketfd, response, messageLength, 0)) <= 0);       
+    receiveAll(response, messageLength);
     printf("%s\n", response);
 
     // ******* DO NOT DELETE | USED TO TEST FOR NULL TERMINATOR ******** //
@@ -145,6 +170,184 @@ void getQuery(void)
     printf("=====\n");                        
 }
 
+/*
+ *  requestCompression()
+ *  Asks the server to compress large results, printing its answer.
+ */
+void requestCompression(void)
+{
+    // send the query the way getQuery does
+    char* query = COMPRESS_QUERY;
+    int queryLength = strlen(query) + 1;
+    bool storage;
+    write(socketfd, &queryLength, sizeof(int));
+    receiveAll(&storage, sizeof(bool));
+    write(socketfd, query, queryLength);
+
+    // the answer is always text
+    int messageLength;
+    receiveAll(&messageLength, sizeof(int));
+    write(socketfd, &storage, sizeof(bool));
+    char* response = malloc((messageLength > 0) ? messageLength : 1);
+    receiveAll(response, (messageLength > 0) ? messageLength : 0);
+    printf("%s\n", (messageLength > 0) ? response : "The server did not answer the request for compression.");
+    free(response);
+}
+
+/*
+ *  connectToServer()
+ *  Connects to the server on 127.0.0.1:5000, or through the Unix domain socket at
+ *  socketPath if it is not NULL. Returns the socket, -1 on failure.
+ */
+int connectToServer(char* socketPath)
+{
+    int fd;
+    if (socketPath != NULL)
+    {
+        struct sockaddr_un localAddress;
+        memset(&localAddress, 0, sizeof(localAddress));
+        localAddress.sun_family = AF_UNIX;
+        snprintf(localAddress.sun_path, sizeof(localAddress.sun_path), "%s", socketPath);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((fd >= 0) && (connect(fd, (struct sockaddr*)&localAddress, sizeof(localAddress)) == 0))
+            return fd;
+    }
+    else
+    {
+        struct sockaddr_in serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(5000);
+        inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if ((fd >= 0) && (connect(fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == 0))
+            return fd;
+    }
+    if (fd >= 0)
+        close(fd);
+    return -1;
+}
+
+/*
+ *  receiveAll()
+ *  Receives exactly length bytes from the server, which may take several calls to recv.
+ */
+void receiveAll(void* buffer, size_t length)
+{
+    for (size_t received = 0; received < length; )
+    {
+        ssize_t bytes = recv(socketfd, (char*)buffer + received, length - received, 0);
+        if (bytes <= 0)
+        {
+            printf("The server closed the connection.\n");
+            quit();
+        }
+        received += bytes;
+    }
+}
+
+/*
+ *  receiveBinaryResult()
+ *  Receives a binary result in chunks, printing its values as a comma separated list
+ *  (or, if not rendering, how many values arrived and how fast). A result passed as a
+ *  file descriptor is mapped and decoded from memory instead, a compressed one is
+ *  decompressed a frame at a time as the frames arrive.
+ */
+void receiveBinaryResult(bool compressed)
+{
+    // the header says how many values follow, or where they are in the file passed along
+    binaryResultHeader header;
+    int fd;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!receiveBinaryResultHeader(socketfd, &header, &fd))
+    {
+        printf("The server closed the connection.\n");
+        quit();
+    }
+    char* mapped = NULL;
+    size_t mappedLength = header.offset + (header.numberOfValues * header.valueSize);
+    if (fd >= 0)
+    {
+        mapped = (header.numberOfValues > 0) ? mmap(NULL, mappedLength, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            printf("Could not map the result passed by the server.\n");
+            return;
+        }
+    }
+
+    // decode the values a chunk at a time (they are 1, 2, 4, or 8 bytes wide, depending on the
+    // type of the column they came from), formatting them into a buffer of text
+    // (a frame of a compressed result is a chunk)
+    char* values = malloc(BINARY_RECEIVE_CHUNK * header.valueSize);
+    char* text = malloc(BINARY_RECEIVE_CHUNK * 21);
+    unsigned long long* words = compressed ? malloc((COMPRESSED_FRAME_VALUES + 1) * sizeof(unsigned long long)) : NULL;
+    long long receivedBytes = sizeof(header);
+    for (long long decoded = 0; decoded < header.numberOfValues; )
+    {
+        int chunk = (header.numberOfValues - decoded < BINARY_RECEIVE_CHUNK) ? (int)(header.numberOfValues - decoded) : BINARY_RECEIVE_CHUNK;
+        if (mapped != NULL)
+        {
+            memcpy(values, mapped + header.offset + (decoded * header.valueSize), (size_t)chunk * header.valueSize);
+        }
+        else if (compressed)
+        {
+            compressedFrameHeader frame;
+            receiveAll(&frame, sizeof(frame));
+            if ((frame.numberOfValues <= 0) || (frame.numberOfValues > chunk) || (frame.encodedBytes < 0) ||
+                (frame.encodedBytes > (COMPRESSED_FRAME_VALUES + 1) * (int)sizeof(unsigned long long)))
+            {
+                printf("The server sent an invalid compressed frame.\n");
+                quit();
+            }
+            receiveAll(words, frame.encodedBytes);
+            if (!decompressFrame(&frame, words, values, header.valueSize))
+            {
+                printf("The server sent an invalid compressed frame.\n");
+                quit();
+            }
+            chunk = frame.numberOfValues;
+            receivedBytes += sizeof(frame) + frame.encodedBytes;
+        }
+        else
+        {
+            receiveAll(values, (size_t)chunk * header.valueSize);
+        }
+        if (renderBinaryResults)
+        {
+            int textLength = 0;
+            for (int i = 0; i < chunk; i++)
+            {
+                long long value = (header.valueSize == 1) ? ((signed char*)values)[i] :
+                                  ((header.valueSize == 2) ? ((short*)values)[i] :
+                                  ((header.valueSize == 4) ? ((int*)values)[i] : ((long long*)values)[i]));
+                textLength += sprintf(text + textLength, (decoded + i + 1 < header.numberOfValues) ? "%lld," : "%lld", value);
+            }
+            fwrite(text, 1, textLength, stdout);
+        }
+        decoded += chunk;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (mapped != NULL)
+        munmap(mapped, mappedLength);
+    free(values);
+    free(text);
+    free(words);
+
+    // report the result
+    double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    double megabytes = (header.numberOfValues * header.valueSize) / 1e6;
+    if (renderBinaryResults)
+        printf("\n");
+    else
+        printf("Received %lld %s (%.1f MB) in %.3f seconds (%.1f MB/s).\n", header.numberOfValues,
+               (header.resultType == BINARY_POSITIONS) ? "positions" : "values", megabytes, seconds, (seconds > 0) ? megabytes / seconds : 0.0);
+    if (!renderBinaryResults && compressed)
+        printf("Compressed to %.1f MB (%.1fx).\n", receivedBytes / 1e6, (receivedBytes > 0) ? (megabytes * 1e6) / receivedBytes : 0.0);
+}
+
 /*
  *  quit()
  *  Is called anytime the program is correctly quitting
@@ -0,0 +1,463 @@
+// column files are read and written in blocks of IO_BLOCK_SIZE bytes, with up to IO_QUEUE_DEPTH
+// of them in flight so the device always has work queued
+#define IO_BLOCK_SIZE (1024 * 1024)
+#define IO_QUEUE_DEPTH 32
+
+// blocks a scan keeps read ahead of the block being consumed, and the alignment of their buffers
+#define IO_READAHEAD_BLOCKS 8
+#define IO_BUFFER_ALIGNMENT 4096
+
+// threads that perform I/O when io_uring is not available
+#define IO_POOL_THREADS 4
+
+// what a request does
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_SYNC 2
+
+// a read or write of part of a file, or an fsync of a file. result is the bytes transferred (0 for
+// an fsync) or -errno once done
+typedef struct ioRequest
+{
+	int fd;
+	struct iovec vector;            // buffer and length
+	off_t offset;
+	int operation;
+	ssize_t result;
+	bool done;
+	struct ioRequest* next;         // queue of the thread pool
+}ioRequest;
+
+// a thread's io_uring: its submission and completion queues, mapped from the kernel
+typedef struct ioRing
+{
+	int fd;
+	unsigned* submissionTail;
+	unsigned* submissionMask;
+	unsigned* submissionArray;
+	struct io_uring_sqe* submissionEntries;
+	unsigned* completionHead;
+	unsigned* completionTail;
+	unsigned* completionMask;
+	struct io_uring_cqe* completionEntries;
+	void* submissionRing;
+	size_t submissionRingSize;
+	void* completionRing;
+	size_t completionRingSize;
+	size_t submissionEntriesSize;
+	int unsubmitted;                // queued submissions the kernel was not told about yet
+	int inFlight;
+}ioRing;
+
+// whether io_uring can be used, decided the first time I/O is done
+pthread_once_t ioBackendChosen = PTHREAD_ONCE_INIT;
+bool ioUringAvailable = false;
+__thread ioRing* currentIoRing = NULL;
+
+// the thread pool's queue of requests, and the signal that a request completed
+ioRequest* ioQueueHead = NULL;
+ioRequest* ioQueueTail = NULL;
+pthread_mutex_t ioQueueLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ioQueueNotEmpty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t ioRequestCompleted = PTHREAD_COND_INITIALIZER;
+
+// performs a request synchronously, the way the thread pool does
+void performIoRequest(ioRequest* request)
+{
+	ssize_t result = (request->operation == IO_SYNC)  ? fsync(request->fd) :
+	                 (request->operation == IO_WRITE) ? pwrite(request->fd, request->vector.iov_base, request->vector.iov_len, request->offset)
+	                                                  : pread(request->fd, request->vector.iov_base, request->vector.iov_len, request->offset);
+	request->result = (result < 0) ? -errno : result;
+}
+
+// a thread of the pool, performing queued requests forever
+void* ioPoolWorker(void* arguments)
+{
+	while (1)
+	{
+		pthread_mutex_lock(&ioQueueLock);
+		while (ioQueueHead == NULL)
+		{
+			pthread_cond_wait(&ioQueueNotEmpty, &ioQueueLock);
+		}
+		ioRequest* request = ioQueueHead;
+		ioQueueHead = request->next;
+		ioQueueTail = (ioQueueHead == NULL) ? NULL : ioQueueTail;
+		pthread_mutex_unlock(&ioQueueLock);
+
+		performIoRequest(request);
+		pthread_mutex_lock(&ioQueueLock);
+		request->done = true;
+		pthread_cond_broadcast(&ioRequestCompleted);
+		pthread_mutex_unlock(&ioQueueLock);
+	}
+	return NULL;
+}
+
+// sets up an io_uring, NULL if the kernel does not allow it
+ioRing* createIoRing(void)
+{
+	struct io_uring_params parameters;
+	memset(&parameters, 0, sizeof(parameters));
+	int fd = syscall(__NR_io_uring_setup, IO_QUEUE_DEPTH, &parameters);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	// map the queues (with IORING_FEAT_SINGLE_MMAP both rings share one mapping)
+	ioRing* ring = calloc(1, sizeof(ioRing));
+	ring->fd = fd;
+	ring->submissionRingSize = parameters.sq_off.array + (parameters.sq_entries * sizeof(unsigned));
+	ring->completionRingSize = parameters.cq_off.cqes + (parameters.cq_entries * sizeof(struct io_uring_cqe));
+	bool singleMapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMapping)
+	{
+		ring->submissionRingSize = (ring->completionRingSize > ring->submissionRingSize) ? ring->completionRingSize : ring->submissionRingSize;
+		ring->completionRingSize = ring->submissionRingSize;
+	}
+	ring->submissionRing = mmap(NULL, ring->submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	ring->completionRing = singleMapping ? ring->submissionRing :
+	                       mmap(NULL, ring->completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	ring->submissionEntriesSize = parameters.sq_entries * sizeof(struct io_uring_sqe);
+	ring->submissionEntries = mmap(NULL, ring->submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if ((ring->submissionRing == MAP_FAILED) || (ring->completionRing == MAP_FAILED) || (ring->submissionEntries == MAP_FAILED))
+	{
+		close(fd);
+		free(ring);
+		return NULL;
+	}
+	char* submissionRing = ring->submissionRing;
+	char* completionRing = ring->completionRing;
+	ring->submissionTail = (unsigned*)(submissionRing + parameters.sq_off.tail);
+	ring->submissionMask = (unsigned*)(submissionRing + parameters.sq_off.ring_mask);
+	ring->submissionArray = (unsigned*)(submissionRing + parameters.sq_off.array);
+	ring->completionHead = (unsigned*)(completionRing + parameters.cq_off.head);
+	ring->completionTail = (unsigned*)(completionRing + parameters.cq_off.tail);
+	ring->completionMask = (unsigned*)(completionRing + parameters.cq_off.ring_mask);
+	ring->completionEntries = (struct io_uring_cqe*)(completionRing + parameters.cq_off.cqes);
+	return ring;
+}
+
+// unmaps and closes an io_uring
+void destroyIoRing(ioRing* ring)
+{
+	munmap(ring->submissionEntries, ring->submissionEntriesSize);
+	if (ring->completionRing != ring->submissionRing)
+		munmap(ring->completionRing, ring->completionRingSize);
+	munmap(ring->submissionRing, ring->submissionRingSize);
+	close(ring->fd);
+	free(ring);
+}
+
+// uses io_uring if the kernel allows it, otherwise starts the thread pool
+void chooseIoBackend(void)
+{
+	ioRing* ring = createIoRing();
+	ioUringAvailable = (ring != NULL);
+	if (ioUringAvailable)
+	{
+		destroyIoRing(ring);
+		return;
+	}
+	for (int i = 0; i < IO_POOL_THREADS; i++)
+	{
+		pthread_t worker;
+		pthread_create(&worker, NULL, ioPoolWorker, NULL);
+		pthread_detach(worker);
+	}
+}
+
+// returns the io_uring of the calling thread (each thread has its own, as a ring has a single
+// submitter), NULL if the thread pool is used instead
+ioRing* getIoRing(void)
+{
+	pthread_once(&ioBackendChosen, chooseIoBackend);
+	if (ioUringAvailable && (currentIoRing == NULL))
+	{
+		currentIoRing = createIoRing();
+	}
+	return currentIoRing;
+}
+
+// releases the io_uring of the calling thread when it exits
+void releaseIoRing(void)
+{
+	if (currentIoRing != NULL)
+	{
+		destroyIoRing(currentIoRing);
+		currentIoRing = NULL;
+	}
+}
+
+// marks the requests the kernel completed as done. if wait is true, first blocks until at least one
+// completes (submitting whatever is still queued)
+void reapIoCompletions(ioRing* ring, bool wait)
+{
+	int submitted = syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	ring->unsubmitted -= (submitted > 0) ? submitted : 0;
+	unsigned head = *ring->completionHead;
+	while (head != __atomic_load_n(ring->completionTail, __ATOMIC_ACQUIRE))
+	{
+		struct io_uring_cqe* completion = &ring->completionEntries[head & *ring->completionMask];
+		ioRequest* request = (ioRequest*)(unsigned long)completion->user_data;
+		request->result = completion->res;
+		request->done = true;
+		ring->inFlight--;
+		head++;
+	}
+	__atomic_store_n(ring->completionHead, head, __ATOMIC_RELEASE);
+}
+
+// starts a request without waiting for it
+void submitIo(ioRequest* request)
+{
+	request->done = false;
+	request->next = NULL;
+	ioRing* ring = getIoRing();
+
+	// the thread pool
+	if (ring == NULL)
+	{
+		pthread_mutex_lock(&ioQueueLock);
+		if (ioQueueTail != NULL)
+			ioQueueTail->next = request;
+		else
+			ioQueueHead = request;
+		ioQueueTail = request;
+		pthread_cond_signal(&ioQueueNotEmpty);
+		pthread_mutex_unlock(&ioQueueLock);
+		return;
+	}
+
+	// io_uring: make room if the queue is full, then queue a vectored read or write, or an fsync
+	while (ring->inFlight >= IO_QUEUE_DEPTH)
+	{
+		reapIoCompletions(ring, true);
+	}
+	unsigned tail = *ring->submissionTail;
+	unsigned index = tail & *ring->submissionMask;
+	struct io_uring_sqe* submission = &ring->submissionEntries[index];
+	memset(submission, 0, sizeof(struct io_uring_sqe));
+	submission->opcode = (request->operation == IO_SYNC)  ? IORING_OP_FSYNC :
+	                     (request->operation == IO_WRITE) ? IORING_OP_WRITEV : IORING_OP_READV;
+	submission->fd = request->fd;
+	if (request->operation != IO_SYNC)
+	{
+		submission->addr = (unsigned long)&request->vector;
+		submission->len = 1;
+		submission->off = request->offset;
+	}
+	submission->user_data = (unsigned long)request;
+	ring->submissionArray[index] = index;
+	__atomic_store_n(ring->submissionTail, tail + 1, __ATOMIC_RELEASE);
+	ring->unsubmitted++;
+	ring->inFlight++;
+	int submitted = syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, 0, 0, NULL, 0);
+	ring->unsubmitted -= (submitted > 0) ? submitted : 0;
+}
+
+// waits for a request, finishing a short transfer synchronously. returns the bytes transferred
+// (fewer than asked for only at the end of a file), -1 on an error
+ssize_t finishIo(ioRequest* request)
+{
+	ioRing* ring = currentIoRing;
+	if (ring != NULL)
+	{
+		while (!request->done)
+			reapIoCompletions(ring, true);
+	}
+	else
+	{
+		pthread_mutex_lock(&ioQueueLock);
+		while (!request->done)
+			pthread_cond_wait(&ioRequestCompleted, &ioQueueLock);
+		pthread_mutex_unlock(&ioQueueLock);
+	}
+	if ((request->result < 0) || (request->operation == IO_SYNC))
+	{
+		return (request->result < 0) ? -1 : 0;
+	}
+	size_t transferred = request->result;
+	while (transferred < request->vector.iov_len)
+	{
+		ioRequest rest = *request;
+		rest.vector.iov_base = (char*)request->vector.iov_base + transferred;
+		rest.vector.iov_len -= transferred;
+		rest.offset += transferred;
+		performIoRequest(&rest);
+		if (rest.result <= 0)
+			break;
+		transferred += rest.result;
+	}
+	return transferred;
+}
+
+// reads or writes length bytes of a file from offset on, with up to IO_QUEUE_DEPTH blocks in flight.
+// returns the bytes transferred, -1 on an error
+ssize_t transferFileAsync(int fd, void* buffer, size_t length, off_t offset, int operation)
+{
+	ioRequest requests[IO_QUEUE_DEPTH];
+	size_t numberOfBlocks = (length + IO_BLOCK_SIZE - 1) / IO_BLOCK_SIZE;
+	size_t transferred = 0;
+	bool failed = false;
+	for (size_t block = 0, finished = 0; finished < numberOfBlocks; finished++)
+	{
+		// keep the queue full
+		for ( ; (block < numberOfBlocks) && (block < finished + IO_QUEUE_DEPTH); block++)
+		{
+			ioRequest* request = &requests[block % IO_QUEUE_DEPTH];
+			request->fd = fd;
+			request->operation = operation;
+			request->offset = offset + (block * IO_BLOCK_SIZE);
+			request->vector.iov_base = (char*)buffer + (block * IO_BLOCK_SIZE);
+			request->vector.iov_len = (block + 1 < numberOfBlocks) ? IO_BLOCK_SIZE : length - (block * IO_BLOCK_SIZE);
+			submitIo(request);
+		}
+
+		// the blocks complete in order as far as the caller is concerned
+		ssize_t result = finishIo(&requests[finished % IO_QUEUE_DEPTH]);
+		failed = failed || (result < 0);
+		transferred += (result > 0) ? result : 0;
+	}
+	return failed ? -1 : (ssize_t)transferred;
+}
+
+// reads length bytes of a file from offset on. returns the bytes read, -1 on an error
+ssize_t readFileAsync(int fd, void* destination, size_t length, off_t offset)
+{
+	posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+	return transferFileAsync(fd, destination, length, offset, IO_READ);
+}
+
+// writes length bytes to a file from offset on. returns false on an error
+bool writeFileAsync(int fd, void* source, size_t length, off_t offset)
+{
+	return transferFileAsync(fd, source, length, offset, IO_WRITE) == (ssize_t)length;
+}
+
+// copies length bytes of one file from fromOffset on to another from toOffset on, inside the kernel
+// (sharing the blocks where the file system can), falling back to reading and writing them through a
+// buffer. returns false on an error
+bool copyFileRange(int fromFd, off_t fromOffset, int toFd, off_t toOffset, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t copied = copy_file_range(fromFd, &fromOffset, toFd, &toOffset, length, 0);
+		if (copied <= 0)
+			break;
+		length -= copied;
+	}
+	char* buffer = (length > 0) ? malloc(IO_BLOCK_SIZE) : NULL;
+	while (length > 0)
+	{
+		size_t chunk = (length < IO_BLOCK_SIZE) ? length : IO_BLOCK_SIZE;
+		ssize_t read = readFileAsync(fromFd, buffer, chunk, fromOffset);
+		if ((read <= 0) || !writeFileAsync(toFd, buffer, read, toOffset))
+			break;
+		fromOffset += read;
+		toOffset += read;
+		length -= read;
+	}
+	free(buffer);
+	return (length == 0);
+}
+
+// flushes files to stable storage, all of them at once. returns false if any of them failed
+bool syncFilesAsync(int* fds, int numberOfFiles)
+{
+	ioRequest* requests = calloc(numberOfFiles + 1, sizeof(ioRequest));
+	for (int i = 0; i < numberOfFiles; i++)
+	{
+		requests[i].fd = fds[i];
+		requests[i].operation = IO_SYNC;
+		submitIo(&requests[i]);
+	}
+	bool synced = true;
+	for (int i = 0; i < numberOfFiles; i++)
+	{
+		synced = (finishIo(&requests[i]) == 0) && synced;
+	}
+	free(requests);
+	return synced;
+}
+
+// a sequential scan of part of a file that keeps IO_READAHEAD_BLOCKS blocks read ahead of the one
+// being consumed, in aligned buffers
+typedef struct columnScan
+{
+	int fd;
+	off_t nextOffset;               // of the next block to read ahead
+	off_t end;
+	char* buffers;
+	ioRequest requests[IO_READAHEAD_BLOCKS];
+	int blocksSubmitted;
+	int blocksConsumed;
+}columnScan;
+
+// queues the next block of a scan into a buffer, if any is left
+void readAheadColumnScan(columnScan* scan, int slot)
+{
+	if (scan->nextOffset >= scan->end)
+	{
+		return;
+	}
+	ioRequest* request = &scan->requests[slot];
+	request->fd = scan->fd;
+	request->operation = IO_READ;
+	request->offset = scan->nextOffset;
+	request->vector.iov_base = scan->buffers + ((size_t)slot * IO_BLOCK_SIZE);
+	request->vector.iov_len = (scan->end - scan->nextOffset < IO_BLOCK_SIZE) ? scan->end - scan->nextOffset : IO_BLOCK_SIZE;
+	scan->nextOffset += request->vector.iov_len;
+	scan->blocksSubmitted++;
+	submitIo(request);
+}
+
+// starts a scan of the bytes of a file from start to end
+void openColumnScan(columnScan* scan, int fd, off_t start, off_t end)
+{
+	memset(scan, 0, sizeof(columnScan));
+	scan->fd = fd;
+	scan->nextOffset = start;
+	scan->end = end;
+	if (posix_memalign((void**)&scan->buffers, IO_BUFFER_ALIGNMENT, (size_t)IO_READAHEAD_BLOCKS * IO_BLOCK_SIZE) != 0)
+	{
+		scan->buffers = NULL;
+		scan->end = start;
+		return;
+	}
+	posix_fadvise(fd, start, end - start, POSIX_FADV_SEQUENTIAL);
+	for (int slot = 0; slot < IO_READAHEAD_BLOCKS; slot++)
+	{
+		readAheadColumnScan(scan, slot);
+	}
+}
+
+// returns the next block of a scan and its length in bytes (0 at the end or on an error). the
+// block stays valid until the next call, which reuses its buffer to read further ahead
+char* nextColumnScanBlock(columnScan* scan, size_t* length)
+{
+	if (scan->blocksConsumed > 0)
+	{
+		readAheadColumnScan(scan, (scan->blocksConsumed - 1) % IO_READAHEAD_BLOCKS);
+	}
+	if (scan->blocksConsumed == scan->blocksSubmitted)
+	{
+		*length = 0;
+		return NULL;
+	}
+	int slot = scan->blocksConsumed++ % IO_READAHEAD_BLOCKS;
+	ssize_t result = finishIo(&scan->requests[slot]);
+	*length = (result > 0) ? result : 0;
+	return scan->buffers + ((size_t)slot * IO_BLOCK_SIZE);
+}
+
+// waits for the blocks a scan still has in flight and frees its buffers
+void closeColumnScan(columnScan* scan)
+{
+	while (scan->blocksConsumed < scan->blocksSubmitted)
+	{
+		finishIo(&scan->requests[scan->blocksConsumed++ % IO_READAHEAD_BLOCKS]);
+	}
+	free(scan->buffers);
+}
@@ -0,0 +1,176 @@
+// value types of columns. the type is stored in the bits of a column file's storage type above
+// COLUMN_TYPE_SHIFT, so files written before columns had types (type 0) hold int32 values
+#define COLUMN_INT32 0
+#define COLUMN_INT8 1
+#define COLUMN_INT16 2
+#define COLUMN_INT64 3
+#define NUMBER_OF_COLUMN_TYPES 4
+#define COLUMN_TYPE_SHIFT 8
+#define STORAGE_TYPE_MASK ((1 << COLUMN_TYPE_SHIFT) - 1)
+#define COLUMN_TYPE_MASK 0xFF
+
+// names (as given to create), bytes per value, ranges, and the longest a value is as text
+// (with its separator), indexed by type
+char* columnTypeNames[NUMBER_OF_COLUMN_TYPES] = {"int32", "int8", "int16", "int64"};
+int columnTypeWidths[NUMBER_OF_COLUMN_TYPES] = {4, 1, 2, 8};
+long long columnTypeMinimums[NUMBER_OF_COLUMN_TYPES] = {INT_MIN, SCHAR_MIN, SHRT_MIN, LLONG_MIN};
+long long columnTypeMaximums[NUMBER_OF_COLUMN_TYPES] = {INT_MAX, SCHAR_MAX, SHRT_MAX, LLONG_MAX};
+int columnTypeTextWidths[NUMBER_OF_COLUMN_TYPES] = {12, 5, 7, 21};
+
+// returns the type of the values of a column file with the given storage type
+int columnValueType(int headerStorageType)
+{
+	return (headerStorageType >> COLUMN_TYPE_SHIFT) & COLUMN_TYPE_MASK;
+}
+
+// returns the type named name, -1 if there is none
+int findColumnType(char* name)
+{
+	for (int type = 0; type < NUMBER_OF_COLUMN_TYPES; type++)
+	{
+		if (strcmp(name, columnTypeNames[type]) == 0)
+			return type;
+	}
+	return -1;
+}
+
+// the kernels over column values are instantiated once per type (in the order of the type numbers)
+// so each loop runs over values of a fixed width, and are looked up by type once per call rather
+// than once per value
+#define FOR_EACH_COLUMN_TYPE(X) X(int32, int, INT_MIN, INT_MAX) X(int8, signed char, SCHAR_MIN, SCHAR_MAX) \
+                                X(int16, short, SHRT_MIN, SHRT_MAX) X(int64, long long, LLONG_MIN, LLONG_MAX)
+
+#define DEFINE_COLUMN_KERNELS(name, type, minimum, maximum)                                                \
+                                                                                                           \
+/* writes the positions of the values in [low, high] (branch free), returns how many there are */          \
+int selectPositions_##name(void* column, int numberOfValues, long long low, long long high, int* positions) \
+{                                                                                                          \
+	type* values = column;                                                                                 \
+	if ((low > high) || (low > maximum) || (high < minimum))                                               \
+		return 0;                                                                                          \
+	type clampedLow = (low < minimum) ? minimum : low;                                                     \
+	type clampedHigh = (high > maximum) ? maximum : high;                                                  \
+	int selected = 0;                                                                                      \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		positions[selected] = i;                                                                           \
+		selected += (values[i] >= clampedLow) & (values[i] <= clampedHigh);                                \
+	}                                                                                                      \
+	return selected;                                                                                       \
+}                                                                                                          \
+                                                                                                           \
+/* keeps the positions whose values (aligned with them) are in [low, high], returns how many there are */ \
+int refinePositions_##name(void* aligned, int* positions, int numberOfPositions, long long low, long long high, int* refined) \
+{                                                                                                          \
+	type* values = aligned;                                                                                \
+	if ((low > high) || (low > maximum) || (high < minimum))                                               \
+		return 0;                                                                                          \
+	type clampedLow = (low < minimum) ? minimum : low;                                                     \
+	type clampedHigh = (high > maximum) ? maximum : high;                                                  \
+	int selected = 0;                                                                                      \
+	for (int i = 0; i < numberOfPositions; i++)                                                            \
+	{                                                                                                      \
+		refined[selected] = positions[i];                                                                  \
+		selected += (values[i] >= clampedLow) & (values[i] <= clampedHigh);                                \
+	}                                                                                                      \
+	return selected;                                                                                       \
+}                                                                                                          \
+                                                                                                           \
+/* copies the values at the given positions, returns false if a position is out of bounds */              \
+bool gatherValues_##name(void* column, int numberOfValues, int* positions, int numberOfPositions, void* gathered) \
+{                                                                                                          \
+	type* values = column;                                                                                 \
+	type* destination = gathered;                                                                          \
+	unsigned int outOfBounds = 0;                                                                          \
+	for (int i = 0; i < numberOfPositions; i++)                                                            \
+	{                                                                                                      \
+		unsigned int position = positions[i];                                                              \
+		outOfBounds |= (position >= (unsigned int)numberOfValues);                                         \
+		destination[i] = values[(position < (unsigned int)numberOfValues) ? position : 0];                 \
+	}                                                                                                      \
+	return (outOfBounds == 0);                                                                             \
+}                                                                                                          \
+                                                                                                           \
+/* folds values into the running sum, min, and max of an aggregate */                                     \
+void aggregateValues_##name(void* vector, int numberOfValues, long long* sum, long long* min, long long* max) \
+{                                                                                                          \
+	type* values = vector;                                                                                 \
+	long long runningSum = 0;                                                                              \
+	type runningMin = maximum;                                                                             \
+	type runningMax = minimum;                                                                             \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		runningSum += values[i];                                                                           \
+		runningMin = (values[i] < runningMin) ? values[i] : runningMin;                                    \
+		runningMax = (values[i] > runningMax) ? values[i] : runningMax;                                    \
+	}                                                                                                      \
+	*sum += runningSum;                                                                                    \
+	*min = (numberOfValues > 0) && (runningMin < *min) ? runningMin : *min;                                \
+	*max = (numberOfValues > 0) && (runningMax > *max) ? runningMax : *max;                                \
+}                                                                                                          \
+                                                                                                           \
+/* widens (or saturates) values to ints, for the structures that hold ints (cracker copies, statistics) */ \
+void widenValues_##name(void* vector, int numberOfValues, int* widened)                                   \
+{                                                                                                          \
+	type* values = vector;                                                                                 \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		widened[i] = (values[i] < INT_MIN) ? INT_MIN : ((values[i] > INT_MAX) ? INT_MAX : (int)values[i]); \
+	}                                                                                                      \
+}                                                                                                          \
+                                                                                                           \
+/* extends values to int64s, for operators that work on values of any type at once (grouping) */         \
+void extendValues_##name(void* vector, int numberOfValues, long long* extended)                           \
+{                                                                                                          \
+	type* values = vector;                                                                                 \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		extended[i] = values[i];                                                                           \
+	}                                                                                                      \
+}                                                                                                          \
+                                                                                                           \
+/* narrows parsed values to the type, returns the index of the first one out of its range (-1 if none) */ \
+int narrowValues_##name(long long* parsed, int numberOfValues, void* narrowed)                             \
+{                                                                                                          \
+	type* destination = narrowed;                                                                          \
+	int firstOutOfRange = -1;                                                                              \
+	for (int i = numberOfValues - 1; i >= 0; i--)                                                          \
+	{                                                                                                      \
+		destination[i] = (type)parsed[i];                                                                  \
+		firstOutOfRange = (destination[i] != parsed[i]) ? i : firstOutOfRange;                             \
+	}                                                                                                      \
+	return firstOutOfRange;                                                                                \
+}                                                                                                          \
+                                                                                                           \
+/* writes values as a comma separated list, returns its length */                                        \
+int formatValues_##name(void* vector, int numberOfValues, char* text)                                      \
+{                                                                                                          \
+	type* values = vector;                                                                                 \
+	int length = 0;                                                                                        \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		length += sprintf(text + length, (i + 1 != numberOfValues) ? "%lld," : "%lld", (long long)values[i]); \
+	}                                                                                                      \
+	text[length] = '\0';                                                                                   \
+	return length;                                                                                         \
+}
+
+FOR_EACH_COLUMN_TYPE(DEFINE_COLUMN_KERNELS)
+
+// the kernels of each type, indexed by type
+#define SELECT_KERNEL(name, type, minimum, maximum) selectPositions_##name,
+#define REFINE_KERNEL(name, type, minimum, maximum) refinePositions_##name,
+#define GATHER_KERNEL(name, type, minimum, maximum) gatherValues_##name,
+#define AGGREGATE_KERNEL(name, type, minimum, maximum) aggregateValues_##name,
+#define WIDEN_KERNEL(name, type, minimum, maximum) widenValues_##name,
+#define EXTEND_KERNEL(name, type, minimum, maximum) extendValues_##name,
+#define NARROW_KERNEL(name, type, minimum, maximum) narrowValues_##name,
+#define FORMAT_KERNEL(name, type, minimum, maximum) formatValues_##name,
+int (*selectKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, long long, long long, int*) = {FOR_EACH_COLUMN_TYPE(SELECT_KERNEL)};
+int (*refineKernels[NUMBER_OF_COLUMN_TYPES])(void*, int*, int, long long, long long, int*) = {FOR_EACH_COLUMN_TYPE(REFINE_KERNEL)};
+bool (*gatherKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, int*, int, void*) = {FOR_EACH_COLUMN_TYPE(GATHER_KERNEL)};
+void (*aggregateKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, long long*, long long*, long long*) = {FOR_EACH_COLUMN_TYPE(AGGREGATE_KERNEL)};
+void (*widenKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, int*) = {FOR_EACH_COLUMN_TYPE(WIDEN_KERNEL)};
+void (*extendKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, long long*) = {FOR_EACH_COLUMN_TYPE(EXTEND_KERNEL)};
+int (*narrowKernels[NUMBER_OF_COLUMN_TYPES])(long long*, int, void*) = {FOR_EACH_COLUMN_TYPE(NARROW_KERNEL)};
+int (*formatKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, char*) = {FOR_EACH_COLUMN_TYPE(FORMAT_KERNEL)};
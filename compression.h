@@ -0,0 +1,158 @@
+// a compressed binary result is sent as frames of up to COMPRESSED_FRAME_VALUES values, each a
+// compressedFrameHeader followed by its values bit-packed into 64 bit words, so the client can decode
+// (and render) a frame while the next one is still on the way
+#define COMPRESSED_FRAME_VALUES 65536
+
+// how the values of a frame are packed: as deltas from the previous value, less the smallest delta
+// (sorted positions and keys pack into a few bits, consecutive ones into none), or as offsets from
+// the smallest value. the encoder tries both and keeps the narrower
+#define COMPRESSED_DELTA 1
+#define COMPRESSED_FRAME_OF_REFERENCE 2
+
+typedef struct compressedFrameHeader
+{
+	int numberOfValues;
+	int encodedBytes;               // bytes of packed words following the header
+	long long reference;            // the first value (deltas) or the smallest one (frame of reference)
+	long long minimumDelta;
+	int encoding;
+	int bitWidth;                   // bits per packed value, 0 to 64
+}compressedFrameHeader;
+
+// reads the i'th value of an array of 1, 2, 4, or 8 byte values
+long long loadCompressedValue(void* values, int valueSize, int i)
+{
+	return (valueSize == 1) ? ((signed char*)values)[i] :
+	       ((valueSize == 2) ? ((short*)values)[i] :
+	       ((valueSize == 4) ? ((int*)values)[i] : ((long long*)values)[i]));
+}
+
+void storeCompressedValue(void* values, int valueSize, int i, long long value)
+{
+	if (valueSize == 1)
+		((signed char*)values)[i] = (signed char)value;
+	else if (valueSize == 2)
+		((short*)values)[i] = (short)value;
+	else if (valueSize == 4)
+		((int*)values)[i] = (int)value;
+	else
+		((long long*)values)[i] = value;
+}
+
+// returns the number of bits needed to hold value
+int compressedBitWidth(unsigned long long value)
+{
+	return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+}
+
+// packs numberOfValues values of bitWidth bits each into words (zeroed by the caller), the i'th
+// value starting at bit i * bitWidth and straddling two words where it has to
+void packCompressedValues(unsigned long long* packed, int numberOfValues, int bitWidth, unsigned long long* words)
+{
+	if (bitWidth == 0)
+		return;
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		unsigned long long bit = (unsigned long long)i * bitWidth;
+		int shift = bit & 63;
+		words[bit >> 6] |= packed[i] << shift;
+		if (shift + bitWidth > 64)
+			words[(bit >> 6) + 1] |= packed[i] >> (64 - shift);
+	}
+}
+
+// returns the i'th value packed by packCompressedValues
+unsigned long long unpackCompressedValue(unsigned long long* words, int bitWidth, int i)
+{
+	if (bitWidth == 0)
+		return 0;
+	unsigned long long bit = (unsigned long long)i * bitWidth;
+	int shift = bit & 63;
+	unsigned long long value = words[bit >> 6] >> shift;
+	if (shift + bitWidth > 64)
+		value |= words[(bit >> 6) + 1] << (64 - shift);
+	return (bitWidth == 64) ? value : value & ((1ULL << bitWidth) - 1);
+}
+
+// compresses up to COMPRESSED_FRAME_VALUES values into a frame: fills in its header and writes its
+// packed words (room for numberOfValues + 1 words). scratch holds numberOfValues values. the
+// arithmetic is unsigned, so deltas and offsets wrap instead of overflowing and decode exactly
+void compressFrame(void* values, int valueSize, int numberOfValues, compressedFrameHeader* header,
+                   unsigned long long* scratch, unsigned long long* words)
+{
+	// the smallest value and delta, and how wide the offsets from them are
+	long long minimum = LLONG_MAX;
+	long long minimumDelta = LLONG_MAX;
+	long long previous = loadCompressedValue(values, valueSize, 0);
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		long long value = loadCompressedValue(values, valueSize, i);
+		long long delta = (long long)((unsigned long long)value - (unsigned long long)previous);
+		minimum = (value < minimum) ? value : minimum;
+		minimumDelta = ((i > 0) && (delta < minimumDelta)) ? delta : minimumDelta;
+		previous = value;
+	}
+	minimumDelta = (numberOfValues > 1) ? minimumDelta : 0;
+	unsigned long long widestOffset = 0;
+	unsigned long long widestDelta = 0;
+	previous = loadCompressedValue(values, valueSize, 0);
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		long long value = loadCompressedValue(values, valueSize, i);
+		unsigned long long delta = (unsigned long long)value - (unsigned long long)previous - (unsigned long long)minimumDelta;
+		widestOffset |= (unsigned long long)value - (unsigned long long)minimum;
+		widestDelta |= (i > 0) ? delta : 0;
+		previous = value;
+	}
+
+	// pack whichever is narrower (the first delta is always 0)
+	header->numberOfValues = numberOfValues;
+	header->minimumDelta = minimumDelta;
+	if (compressedBitWidth(widestDelta) <= compressedBitWidth(widestOffset))
+	{
+		header->encoding = COMPRESSED_DELTA;
+		header->reference = loadCompressedValue(values, valueSize, 0);
+		header->bitWidth = compressedBitWidth(widestDelta);
+		scratch[0] = 0;
+		for (int i = 1; i < numberOfValues; i++)
+		{
+			scratch[i] = (unsigned long long)loadCompressedValue(values, valueSize, i) -
+			             (unsigned long long)loadCompressedValue(values, valueSize, i - 1) - (unsigned long long)minimumDelta;
+		}
+	}
+	else
+	{
+		header->encoding = COMPRESSED_FRAME_OF_REFERENCE;
+		header->reference = minimum;
+		header->bitWidth = compressedBitWidth(widestOffset);
+		for (int i = 0; i < numberOfValues; i++)
+			scratch[i] = (unsigned long long)loadCompressedValue(values, valueSize, i) - (unsigned long long)minimum;
+	}
+	int numberOfWords = (int)(((unsigned long long)numberOfValues * header->bitWidth + 63) / 64);
+	memset(words, 0, ((size_t)numberOfWords + 1) * sizeof(unsigned long long));
+	packCompressedValues(scratch, numberOfValues, header->bitWidth, words);
+	header->encodedBytes = numberOfWords * sizeof(unsigned long long);
+}
+
+// decompresses a frame's packed words into its values (valueSize bytes each). returns false if the
+// header does not describe a frame
+bool decompressFrame(compressedFrameHeader* header, unsigned long long* words, void* values, int valueSize)
+{
+	if ((header->numberOfValues < 0) || (header->numberOfValues > COMPRESSED_FRAME_VALUES) ||
+	    (header->bitWidth < 0) || (header->bitWidth > 64) ||
+	    ((long long)header->encodedBytes < (((long long)header->numberOfValues * header->bitWidth + 63) / 64) * 8))
+	{
+		return false;
+	}
+	unsigned long long value = (unsigned long long)header->reference;
+	for (int i = 0; i < header->numberOfValues; i++)
+	{
+		unsigned long long packed = unpackCompressedValue(words, header->bitWidth, i);
+		if (header->encoding == COMPRESSED_DELTA)
+			value += (i > 0) ? packed + (unsigned long long)header->minimumDelta : 0;
+		else
+			value = (unsigned long long)header->reference + packed;
+		storeCompressedValue(values, valueSize, i, (long long)value);
+	}
+	return true;
+}
@@ -0,0 +1,176 @@
+// a piece boundary in a cracker index: every value at or after startPosition
+// (up to the next boundary) is >= pivot, every value before it is < pivot
+typedef struct crackerPiece
+{
+	int pivot;
+	int startPosition;
+}crackerPiece;
+
+// a struct for storing a cracked copy of a column
+typedef struct crackerColumn
+{
+	char* columnName;
+	int* values;                    // cracker copy of the column, reorganized by each select
+	int* positions;                 // sideways map from the cracker copy back to original row ids
+	int numberOfValues;
+	bool loaded;                    // false until the cracker copy is read from disk
+	unsigned long long version;     // of the column the cracker copy was read from
+	crackerPiece* pieces;           // cracker index, sorted by pivot
+	int numberOfPieces;
+	int piecesCapacity;
+	pthread_mutex_t lock;
+	struct crackerColumn* next;
+}crackerColumn;
+crackerColumn* crackerColumnRoot = NULL;
+pthread_mutex_t crackerColumnsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// finds the cracker column for a column, NULL if cracking is not enabled for it
+crackerColumn* findCrackerColumn(char* columnName)
+{
+	pthread_mutex_lock(&crackerColumnsLock);
+	crackerColumn* trav = crackerColumnRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	pthread_mutex_unlock(&crackerColumnsLock);
+	return trav;
+}
+
+// enables cracking for a column. the cracker copy is built by the first select
+crackerColumn* enableCracking(char* columnName)
+{
+	pthread_mutex_lock(&crackerColumnsLock);
+	crackerColumn* trav = crackerColumnRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	if (trav == NULL)
+	{
+		trav = calloc(1, sizeof(crackerColumn));
+		trav->columnName = malloc(strlen(columnName) + 1);
+		strcpy(trav->columnName, columnName);
+		pthread_mutex_init(&trav->lock, NULL);
+		trav->next = crackerColumnRoot;
+		crackerColumnRoot = trav;
+	}
+	pthread_mutex_unlock(&crackerColumnsLock);
+	return trav;
+}
+
+// throws away a cracker copy. the column's lock must be held
+void unloadCrackerColumn(crackerColumn* column)
+{
+	free(column->values);
+	free(column->positions);
+	column->values = NULL;
+	column->positions = NULL;
+	column->numberOfValues = 0;
+	column->numberOfPieces = 0;
+	column->loaded = false;
+}
+
+// throws away the cracker copy of a column (e.g. after a load), it is rebuilt on the next select
+void invalidateCrackerColumn(char* columnName)
+{
+	crackerColumn* column = findCrackerColumn(columnName);
+	if (column == NULL)
+	{
+		return;
+	}
+	pthread_mutex_lock(&column->lock);
+	unloadCrackerColumn(column);
+	pthread_mutex_unlock(&column->lock);
+}
+
+// installs the data of a version of a column as its cracker copy. takes ownership of values
+void loadCrackerColumn(crackerColumn* column, int* values, int numberOfValues, unsigned long long version)
+{
+	column->values = values;
+	column->positions = malloc((numberOfValues + 1) * sizeof(int));
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		column->positions[i] = i;
+	}
+	column->numberOfValues = numberOfValues;
+	column->numberOfPieces = 0;
+	column->version = version;
+	column->loaded = true;
+}
+
+// cracks the piece holding pivot in two and returns the first position whose value is >= pivot.
+// the column's lock must be held
+int crackInTwo(crackerColumn* column, int pivot)
+{
+	// binary search the cracker index for the first boundary with a pivot >= the new pivot
+	int low = 0;
+	int high = column->numberOfPieces;
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+		if (column->pieces[middle].pivot < pivot)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if ((low < column->numberOfPieces) && (column->pieces[low].pivot == pivot))
+	{
+		return column->pieces[low].startPosition;
+	}
+
+	// partition the piece between the neighbouring boundaries
+	int start = (low == 0) ? 0 : column->pieces[low - 1].startPosition;
+	int end = (low == column->numberOfPieces) ? column->numberOfValues : column->pieces[low].startPosition;
+	int* values = column->values;
+	int* positions = column->positions;
+	int left = start;
+	int right = end - 1;
+	while (left <= right)
+	{
+		if (values[left] < pivot)
+		{
+			left++;
+		}
+		else
+		{
+			int temp = values[left];
+			values[left] = values[right];
+			values[right] = temp;
+			temp = positions[left];
+			positions[left] = positions[right];
+			positions[right] = temp;
+			right--;
+		}
+	}
+
+	// record the new boundary in the cracker index
+	if (column->numberOfPieces == column->piecesCapacity)
+	{
+		column->piecesCapacity = (column->piecesCapacity == 0) ? 64 : column->piecesCapacity * 2;
+		column->pieces = realloc(column->pieces, column->piecesCapacity * sizeof(crackerPiece));
+	}
+	memmove(&column->pieces[low + 1], &column->pieces[low], (column->numberOfPieces - low) * sizeof(crackerPiece));
+	column->pieces[low].pivot = pivot;
+	column->pieces[low].startPosition = left;
+	column->numberOfPieces++;
+	return left;
+}
+
+// selects the original row ids of every value in [low, high] by cracking the column around the
+// bounds. returns the number of positions written to a newly pooled array (the values themselves
+// are copied to selectedValues if it is not NULL). the column's lock must be held
+int crackerSelect(crackerColumn* column, int low, int high, int** validPositions, int** selectedValues)
+{
+	int start = (low == INT_MIN) ? 0 : crackInTwo(column, low);
+	int end = (high == INT_MAX) ? column->numberOfValues : crackInTwo(column, high + 1);
+	int numberOfValidPositions = (end > start) ? (end - start) : 0;
+	*validPositions = poolAllocate((numberOfValidPositions + 1) * sizeof(int));
+	memcpy(*validPositions, column->positions + start, numberOfValidPositions * sizeof(int));
+	if (selectedValues != NULL)
+	{
+		*selectedValues = malloc((numberOfValidPositions + 1) * sizeof(int));
+		memcpy(*selectedValues, column->values + start, numberOfValidPositions * sizeof(int));
+	}
+	return numberOfValidPositions;
+}
@@ -0,0 +1,694 @@
+// the driver mode of the client opens several connections to the server and replays a query
+// script over each of them, then reports the throughput and latency distribution achieved, e.g.
+//     ./client --driver tests/createTestLarge.txt --connections 8 --mode open --rate 2000 --duration 30
+
+// defaults of the driver's options
+#define DRIVER_DEFAULT_CONNECTIONS 1
+#define DRIVER_DEFAULT_DURATION 10.0
+#define DRIVER_DEFAULT_PORT 5000
+
+// most commands a mix can weigh, and how long to wait for a local server to accept connections
+#define DRIVER_MAX_MIX 16
+#define DRIVER_CONNECT_ATTEMPTS 50
+
+// the response of the server to a query it did not evaluate
+#define DRIVER_ERROR_RESPONSE "Query was not evaluated"
+
+// a query of the script, and the command it starts with (for the mix and the report)
+typedef struct driverQuery
+{
+	char* text;
+	int command;
+}driverQuery;
+
+// the latency of a query and the command it was
+typedef struct driverSample
+{
+	long long nanoseconds;
+	int command;
+}driverSample;
+
+// a variable the script assigns to, and the name it currently has on a connection. every
+// assignment is renamed so that the script can be replayed without reusing a variable name
+typedef struct driverVariable
+{
+	char* name;
+	char* currentName;
+	struct driverVariable* next;
+}driverVariable;
+
+// the state of a connection of the driver
+typedef struct driverConnection
+{
+	int id;
+	int socketfd;
+	pthread_t thread;
+	long long queriesToSend;            // -1 to send until the duration elapses
+	driverSample* samples;
+	long long numberOfSamples;
+	long long sampleCapacity;
+	long long errors;
+	long long versions;                 // renamed variables created so far
+	driverVariable* variables;
+	int scriptPosition;
+	int mixPositions[DRIVER_MAX_MIX];
+	unsigned long long randomState;
+}driverConnection;
+
+// the options and script of a run
+typedef struct driverOptions
+{
+	char* scriptFile;
+	char* host;
+	int port;
+	char* socketPath;                   // connect through this Unix domain socket instead of TCP
+	int connections;
+	bool openLoop;                      // send on a schedule instead of as soon as the last response arrived
+	double rate;                        // queries per second over all connections, open loop only
+	double duration;
+	long long requests;                 // total queries, 0 to run for the duration instead
+	bool local;                         // start a server on this machine for the run
+	driverQuery* queries;
+	int numberOfQueries;
+	char* commands[DRIVER_MAX_MIX + 1]; // commands seen in the script, the last one is "other"
+	int numberOfCommands;
+	int mixCommands[DRIVER_MAX_MIX];    // commands of the mix and their cumulative weights
+	int mixWeights[DRIVER_MAX_MIX];
+	int numberOfMixCommands;
+	long long startNanoseconds;
+	long long endNanoseconds;
+}driverOptions;
+
+driverOptions driver;
+
+// returns the time since an arbitrary point in nanoseconds
+long long driverNanoseconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((long long)now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+// sleeps until a point in time returned by driverNanoseconds()
+void driverSleepUntil(long long nanoseconds)
+{
+	struct timespec until = {nanoseconds / 1000000000LL, nanoseconds % 1000000000LL};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0);
+}
+
+// returns a random number below bound (splitmix64, one generator per connection)
+int driverRandom(driverConnection* connection, int bound)
+{
+	unsigned long long z = (connection->randomState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return (int)((z ^ (z >> 31)) % bound);
+}
+
+// returns the index of a command of the script, adding it if there is room and "other" otherwise
+int driverCommandIndex(char* command)
+{
+	for (int i = 0; i < driver.numberOfCommands; i++)
+	{
+		if (strcmp(driver.commands[i], command) == 0)
+		{
+			return i;
+		}
+	}
+	if (driver.numberOfCommands == DRIVER_MAX_MIX)
+	{
+		return DRIVER_MAX_MIX;
+	}
+	driver.commands[driver.numberOfCommands] = strdup(command);
+	return driver.numberOfCommands++;
+}
+
+// reads the queries of a script, one per line, leaving out empty lines and quit. returns false if
+// the script cannot be read or has no queries
+bool readDriverScript(char* scriptFile)
+{
+	FILE* fp = fopen(scriptFile, "r");
+	if (fp == NULL)
+	{
+		printf("Could not open the script %s\n", scriptFile);
+		return false;
+	}
+	driver.commands[DRIVER_MAX_MIX] = "other";
+	int capacity = 64;
+	driver.queries = malloc(capacity * sizeof(driverQuery));
+	char line[BUFSIZ];
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		if ((line[0] == '\0') || (strcasecmp(line, "quit") == 0))
+		{
+			continue;
+		}
+
+		// the command is the name before the first parenthesis, after the output variable if any
+		char command[BUFSIZ];
+		char* start = strchr(line, '=');
+		char* parenthesis = strchr(line, '(');
+		start = ((start != NULL) && ((parenthesis == NULL) || (start < parenthesis))) ? start + 1 : line;
+		int length = (parenthesis != NULL) ? (int)(parenthesis - start) : (int)strcspn(start, ";");
+		snprintf(command, sizeof(command), "%.*s", length, start);
+
+		if (driver.numberOfQueries == capacity)
+		{
+			capacity *= 2;
+			driver.queries = realloc(driver.queries, capacity * sizeof(driverQuery));
+		}
+		driver.queries[driver.numberOfQueries].text = strdup(line);
+		driver.queries[driver.numberOfQueries++].command = driverCommandIndex(command);
+	}
+	fclose(fp);
+	if (driver.numberOfQueries == 0)
+	{
+		printf("The script %s has no queries\n", scriptFile);
+		return false;
+	}
+	return true;
+}
+
+// parses a mix of the form command=weight,... against the commands of the script. returns false
+// if a command of the mix is not in the script or a weight is not positive
+bool parseDriverMix(char* mix)
+{
+	int totalWeight = 0;
+	for (char* entry = strtok(mix, ","); entry != NULL; entry = strtok(NULL, ","))
+	{
+		char* equals = strchr(entry, '=');
+		int weight = (equals != NULL) ? atoi(equals + 1) : 0;
+		if (equals != NULL)
+			*equals = '\0';
+		int command = -1;
+		for (int i = 0; i < driver.numberOfCommands; i++)
+		{
+			if (strcmp(driver.commands[i], entry) == 0)
+				command = i;
+		}
+		if ((command == -1) || (weight <= 0) || (driver.numberOfMixCommands == DRIVER_MAX_MIX))
+		{
+			printf("The mix entry %s must name a command of the script with a positive weight\n", entry);
+			return false;
+		}
+		totalWeight += weight;
+		driver.mixCommands[driver.numberOfMixCommands] = command;
+		driver.mixWeights[driver.numberOfMixCommands++] = totalWeight;
+	}
+	return driver.numberOfMixCommands > 0;
+}
+
+// returns the next query a connection sends: the script in order, or a query of a command drawn
+// from the mix (the queries of each command are themselves replayed in order)
+driverQuery* nextDriverQuery(driverConnection* connection)
+{
+	if (driver.numberOfMixCommands == 0)
+	{
+		driverQuery* query = &driver.queries[connection->scriptPosition];
+		connection->scriptPosition = (connection->scriptPosition + 1) % driver.numberOfQueries;
+		return query;
+	}
+	int draw = driverRandom(connection, driver.mixWeights[driver.numberOfMixCommands - 1]);
+	int mix = 0;
+	while (driver.mixWeights[mix] <= draw)
+		mix++;
+	int* position = &connection->mixPositions[mix];
+	while (driver.queries[*position].command != driver.mixCommands[mix])
+		*position = (*position + 1) % driver.numberOfQueries;
+	driverQuery* query = &driver.queries[*position];
+	*position = (*position + 1) % driver.numberOfQueries;
+	return query;
+}
+
+// finds a variable of the script on a connection, NULL if the script has not assigned to it yet
+driverVariable* findDriverVariable(driverConnection* connection, char* name, int length)
+{
+	for (driverVariable* trav = connection->variables; trav != NULL; trav = trav->next)
+	{
+		if (((int)strlen(trav->name) == length) && (strncmp(trav->name, name, length) == 0))
+		{
+			return trav;
+		}
+	}
+	return NULL;
+}
+
+// rewrites a query for a connection: an assigned variable gets a new name, and references to a
+// variable use its latest name. the names the query replaces are returned in superseded (on the
+// heap, NULL if none) so they can be dropped once the query is evaluated
+char* renameDriverVariables(driverConnection* connection, char* text, char** superseded)
+{
+	int capacity = strlen(text) * 2 + 64;
+	char* renamed = malloc(capacity);
+	int length = 0;
+	*superseded = NULL;
+	int supersededLength = 0;
+	bool quoted = false;
+	for (char* cursor = text; *cursor != '\0'; )
+	{
+		// copy anything that is not a name as it is, and names in quotes
+		if (*cursor == '"')
+			quoted = !quoted;
+		if (quoted || !(isalnum((unsigned char)*cursor) || (*cursor == '_') || (*cursor == '.')))
+		{
+			renamed[length++] = *cursor++;
+			continue;
+		}
+		char* name = cursor;
+		while (isalnum((unsigned char)*cursor) || (*cursor == '_') || (*cursor == '.'))
+			cursor++;
+		int nameLength = cursor - name;
+		char* after = cursor;
+		while (*after == ' ')
+			after++;
+		driverVariable* variable = findDriverVariable(connection, name, nameLength);
+
+		// an assignment creates a new version of the variable
+		if ((*after == '=') && (!isdigit((unsigned char)*name)))
+		{
+			if (variable == NULL)
+			{
+				variable = calloc(1, sizeof(driverVariable));
+				variable->name = strndup(name, nameLength);
+				variable->next = connection->variables;
+				connection->variables = variable;
+			}
+			else
+			{
+				*superseded = realloc(*superseded, supersededLength + strlen(variable->currentName) + 2);
+				supersededLength += sprintf(*superseded + supersededLength, "%s%s", (supersededLength > 0) ? "," : "", variable->currentName);
+				free(variable->currentName);
+			}
+			variable->currentName = malloc(nameLength + 32);
+			sprintf(variable->currentName, "%s_d%d_%lld", variable->name, connection->id, connection->versions++);
+		}
+		char* replacement = (variable != NULL) ? variable->currentName : NULL;
+		int replacementLength = (replacement != NULL) ? (int)strlen(replacement) : nameLength;
+		if (length + replacementLength + 1 >= capacity)
+		{
+			capacity = (capacity + replacementLength) * 2;
+			renamed = realloc(renamed, capacity);
+		}
+		memcpy(renamed + length, (replacement != NULL) ? replacement : name, replacementLength);
+		length += replacementLength;
+	}
+	renamed[length] = '\0';
+	return renamed;
+}
+
+// receives exactly length bytes from the server. returns false if the connection closed
+bool driverReceive(int socketfd, void* buffer, int length)
+{
+	for (int received = 0, bytes; received < length; received += bytes)
+	{
+		bytes = recv(socketfd, (char*)buffer + received, length - received, 0);
+		if (bytes <= 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// sends a query and returns the response (on the heap), NULL if the connection closed
+char* driverSendQuery(int socketfd, char* query)
+{
+	int queryLength = strlen(query) + 1;
+	bool acknowledgement = true;
+	int responseLength;
+	write(socketfd, &queryLength, sizeof(int));
+	if (!driverReceive(socketfd, &acknowledgement, sizeof(bool)))
+		return NULL;
+	write(socketfd, query, queryLength);
+	if (!driverReceive(socketfd, &responseLength, sizeof(int)))
+		return NULL;
+	write(socketfd, &acknowledgement, sizeof(bool));
+
+	// a binary result is received in full and described instead of returned (a result passed as
+	// a file descriptor is left unread, a compressed one is received frame by frame)
+	if ((responseLength == BINARY_RESPONSE) || (responseLength == BINARY_DESCRIPTOR_RESPONSE) || (responseLength == BINARY_COMPRESSED_RESPONSE))
+	{
+		binaryResultHeader header;
+		int fd;
+		if (!receiveBinaryResultHeader(socketfd, &header, &fd))
+			return NULL;
+		if (fd >= 0)
+			close(fd);
+		char buffer[BUFSIZ];
+		long long remaining = (fd >= 0) ? 0 : header.numberOfValues * header.valueSize;
+		for (long long framed = 0; (responseLength == BINARY_COMPRESSED_RESPONSE) && (framed < header.numberOfValues); )
+		{
+			compressedFrameHeader frame;
+			if (!driverReceive(socketfd, &frame, sizeof(frame)) || (frame.numberOfValues <= 0) || (frame.encodedBytes < 0))
+				return NULL;
+			for (remaining = frame.encodedBytes; remaining > 0; remaining -= sizeof(buffer))
+			{
+				if (!driverReceive(socketfd, buffer, (remaining < (long long)sizeof(buffer)) ? (int)remaining : (int)sizeof(buffer)))
+					return NULL;
+			}
+			framed += frame.numberOfValues;
+		}
+		for (; remaining > 0; remaining -= sizeof(buffer))
+		{
+			if (!driverReceive(socketfd, buffer, (remaining < (long long)sizeof(buffer)) ? (int)remaining : (int)sizeof(buffer)))
+				return NULL;
+		}
+		char* response = malloc(64);
+		snprintf(response, 64, "Received %lld values.", header.numberOfValues);
+		return response;
+	}
+	char* response = malloc(responseLength + 1);
+	if (!driverReceive(socketfd, response, responseLength))
+	{
+		free(response);
+		return NULL;
+	}
+	response[responseLength] = '\0';
+	return response;
+}
+
+// connects to the server, retrying while a local server starts up. returns -1 on failure
+int driverConnect(void)
+{
+	if (driver.socketPath != NULL)
+	{
+		struct sockaddr_un localAddress;
+		memset(&localAddress, 0, sizeof(localAddress));
+		localAddress.sun_family = AF_UNIX;
+		snprintf(localAddress.sun_path, sizeof(localAddress.sun_path), "%s", driver.socketPath);
+		for (int attempt = 0; attempt < DRIVER_CONNECT_ATTEMPTS; attempt++)
+		{
+			int socketfd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connect(socketfd, (struct sockaddr*)&localAddress, sizeof(localAddress)) == 0)
+			{
+				return socketfd;
+			}
+			close(socketfd);
+			usleep(100000);
+		}
+		printf("Could not connect to %s\n", driver.socketPath);
+		return -1;
+	}
+
+	struct sockaddr_in serverAddress;
+	memset(&serverAddress, 0, sizeof(serverAddress));
+	serverAddress.sin_family = AF_INET;
+	serverAddress.sin_port = htons(driver.port);
+	if (inet_pton(AF_INET, driver.host, &serverAddress.sin_addr) <= 0)
+	{
+		printf("%s is not an IPv4 address\n", driver.host);
+		return -1;
+	}
+	for (int attempt = 0; attempt < DRIVER_CONNECT_ATTEMPTS; attempt++)
+	{
+		int socketfd = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(socketfd, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) == 0)
+		{
+			return socketfd;
+		}
+		close(socketfd);
+		usleep(100000);
+	}
+	printf("Could not connect to %s:%d\n", driver.host, driver.port);
+	return -1;
+}
+
+// records the latency of a query
+void recordDriverSample(driverConnection* connection, long long nanoseconds, int command)
+{
+	if (connection->numberOfSamples == connection->sampleCapacity)
+	{
+		connection->sampleCapacity = (connection->sampleCapacity == 0) ? 1024 : connection->sampleCapacity * 2;
+		connection->samples = realloc(connection->samples, connection->sampleCapacity * sizeof(driverSample));
+	}
+	connection->samples[connection->numberOfSamples].nanoseconds = nanoseconds;
+	connection->samples[connection->numberOfSamples++].command = command;
+}
+
+// sends queries over a connection until it has sent its share or the duration elapsed. in an open
+// loop the latency of a query is measured from when it was scheduled to be sent, so the time it
+// waited behind a slow response is counted rather than hidden
+void* runDriverConnection(void* argument)
+{
+	driverConnection* connection = argument;
+	long long interval = driver.openLoop ? (long long)((1e9 * driver.connections) / driver.rate) : 0;
+	long long scheduled = driver.startNanoseconds + ((interval * connection->id) / driver.connections);
+	for (long long sent = 0; (connection->queriesToSend < 0) || (sent < connection->queriesToSend); sent++)
+	{
+		if (driver.openLoop)
+		{
+			driverSleepUntil(scheduled);
+		}
+		long long start = driver.openLoop ? scheduled : driverNanoseconds();
+		if ((connection->queriesToSend < 0) && (start >= driver.endNanoseconds))
+		{
+			break;
+		}
+		scheduled += interval;
+
+		// evaluate the query, then drop the variables it replaced (which is not timed)
+		driverQuery* query = nextDriverQuery(connection);
+		char* superseded;
+		char* text = renameDriverVariables(connection, query->text, &superseded);
+		char* response = driverSendQuery(connection->socketfd, text);
+		long long end = driverNanoseconds();
+		free(text);
+		if (response == NULL)
+		{
+			printf("Connection %d was closed by the server\n", connection->id);
+			connection->errors++;
+			free(superseded);
+			break;
+		}
+		recordDriverSample(connection, end - start, query->command);
+		connection->errors += (strncmp(response, DRIVER_ERROR_RESPONSE, strlen(DRIVER_ERROR_RESPONSE)) == 0);
+		free(response);
+		char* remaining;
+		for (char* name = (superseded != NULL) ? strtok_r(superseded, ",", &remaining) : NULL; name != NULL; name = strtok_r(NULL, ",", &remaining))
+		{
+			char drop[BUFSIZ];
+			snprintf(drop, sizeof(drop), "drop(%s)", name);
+			free(driverSendQuery(connection->socketfd, drop));
+		}
+		free(superseded);
+	}
+	free(driverSendQuery(connection->socketfd, "quit"));
+	close(connection->socketfd);
+	return NULL;
+}
+
+// orders samples by latency
+int compareDriverSamples(const void* a, const void* b)
+{
+	long long difference = ((driverSample*)a)->nanoseconds - ((driverSample*)b)->nanoseconds;
+	return (difference > 0) - (difference < 0);
+}
+
+// returns a percentile (0 to 1) of sorted latencies in microseconds
+double driverPercentile(long long* latencies, long long numberOfLatencies, double percentile)
+{
+	long long rank = (long long)(percentile * numberOfLatencies);
+	rank = (rank >= numberOfLatencies) ? numberOfLatencies - 1 : rank;
+	return latencies[rank] / 1e3;
+}
+
+// prints the throughput and the latency distribution of a run, overall and per command
+void reportDriverRun(driverConnection* connections)
+{
+	long long numberOfSamples = 0;
+	long long errors = 0;
+	for (int i = 0; i < driver.connections; i++)
+	{
+		numberOfSamples += connections[i].numberOfSamples;
+		errors += connections[i].errors;
+	}
+	driverSample* samples = malloc((numberOfSamples + 1) * sizeof(driverSample));
+	long long* latencies = malloc((numberOfSamples + 1) * sizeof(long long));
+	numberOfSamples = 0;
+	for (int i = 0; i < driver.connections; i++)
+	{
+		memcpy(samples + numberOfSamples, connections[i].samples, connections[i].numberOfSamples * sizeof(driverSample));
+		numberOfSamples += connections[i].numberOfSamples;
+	}
+	qsort(samples, numberOfSamples, sizeof(driverSample), compareDriverSamples);
+	double seconds = (driver.endNanoseconds - driver.startNanoseconds) / 1e9;
+
+	printf("connections: %d\n", driver.connections);
+	printf("mode: %s\n", driver.openLoop ? "open" : "closed");
+	if (driver.openLoop)
+		printf("target_qps: %.1f\n", driver.rate);
+	printf("duration_s: %.3f\n", seconds);
+	printf("queries: %lld\n", numberOfSamples);
+	printf("errors: %lld\n", errors);
+	printf("throughput_qps: %.1f\n", numberOfSamples / seconds);
+	if (numberOfSamples == 0)
+	{
+		free(samples);
+		free(latencies);
+		return;
+	}
+	printf("latency_us: command count p50 p90 p99 p999 max\n");
+	for (int command = -1; command <= DRIVER_MAX_MIX; command++)
+	{
+		long long numberOfLatencies = 0;
+		for (long long i = 0; i < numberOfSamples; i++)
+		{
+			if ((command == -1) || (samples[i].command == command))
+				latencies[numberOfLatencies++] = samples[i].nanoseconds;
+		}
+		if ((numberOfLatencies == 0) || ((command >= driver.numberOfCommands) && (command != DRIVER_MAX_MIX)))
+		{
+			continue;
+		}
+		printf("  %s %lld %.1f %.1f %.1f %.1f %.1f\n", (command == -1) ? "all" : driver.commands[command], numberOfLatencies,
+		       driverPercentile(latencies, numberOfLatencies, 0.5), driverPercentile(latencies, numberOfLatencies, 0.9),
+		       driverPercentile(latencies, numberOfLatencies, 0.99), driverPercentile(latencies, numberOfLatencies, 0.999),
+		       latencies[numberOfLatencies - 1] / 1e3);
+	}
+	free(samples);
+	free(latencies);
+}
+
+// prints how to use the driver mode
+void printDriverUsage(void)
+{
+	printf("Usage: ./client --driver scriptFile [--connections n] [--mode closed|open] [--rate queriesPerSecond]\n");
+	printf("                [--duration seconds | --requests n] [--mix command=weight,...] [--host ip] [--port port] [--socket path] [--local]\n");
+}
+
+// runs the driver mode with the client's arguments. returns the exit status of the client
+int runDriver(int argc, char const *argv[])
+{
+	// options
+	driver.scriptFile = (argc > 2) ? (char*)argv[2] : NULL;
+	driver.host = "127.0.0.1";
+	driver.port = DRIVER_DEFAULT_PORT;
+	driver.connections = DRIVER_DEFAULT_CONNECTIONS;
+	driver.duration = DRIVER_DEFAULT_DURATION;
+	char* mix = NULL;
+	for (int i = 3; i < argc; i++)
+	{
+		char* value = (i + 1 < argc) ? (char*)argv[i + 1] : NULL;
+		if (strcmp(argv[i], "--local") == 0)
+			driver.local = true;
+		else if (value == NULL)
+			driver.scriptFile = NULL;
+		else if (strcmp(argv[i], "--connections") == 0)
+			driver.connections = atoi(value);
+		else if ((strcmp(argv[i], "--mode") == 0) && ((strcmp(value, "open") == 0) || (strcmp(value, "closed") == 0)))
+			driver.openLoop = (strcmp(value, "open") == 0);
+		else if (strcmp(argv[i], "--rate") == 0)
+			driver.rate = atof(value);
+		else if (strcmp(argv[i], "--duration") == 0)
+			driver.duration = atof(value);
+		else if (strcmp(argv[i], "--requests") == 0)
+			driver.requests = atoll(value);
+		else if (strcmp(argv[i], "--mix") == 0)
+			mix = value;
+		else if (strcmp(argv[i], "--host") == 0)
+			driver.host = value;
+		else if (strcmp(argv[i], "--port") == 0)
+			driver.port = atoi(value);
+		else if (strcmp(argv[i], "--socket") == 0)
+			driver.socketPath = value;
+		else
+			driver.scriptFile = NULL;
+		i += (strcmp(argv[i], "--local") != 0);
+	}
+	if ((driver.scriptFile == NULL) || (driver.connections <= 0) || (driver.duration <= 0) || (driver.requests < 0))
+	{
+		printDriverUsage();
+		return 1;
+	}
+	if (driver.openLoop != (driver.rate > 0))
+	{
+		printf("An open loop needs a positive --rate, and a closed loop sends as fast as responses arrive\n");
+		return 1;
+	}
+	if (!readDriverScript(driver.scriptFile) || ((mix != NULL) && !parseDriverMix(mix)))
+	{
+		return 1;
+	}
+
+	// start a server on this machine if asked to, which only listens on the loopback address
+	pid_t serverPid = -1;
+	if (driver.local)
+	{
+		driver.host = "127.0.0.1";
+		serverPid = fork();
+		if (serverPid == 0)
+		{
+			freopen("/dev/null", "w", stdout);
+			if (driver.socketPath != NULL)
+				execl("./server", "./server", "--socket-path", driver.socketPath, (char*)NULL);
+			else
+				execl("./server", "./server", (char*)NULL);
+			_exit(127);
+		}
+	}
+
+	// connect every connection before starting the clock
+	signal(SIGPIPE, SIG_IGN);
+	driverConnection* connections = calloc(driver.connections, sizeof(driverConnection));
+	int status = 0;
+	for (int i = 0; i < driver.connections; i++)
+	{
+		connections[i].id = i;
+		connections[i].randomState = i + 1;
+		connections[i].scriptPosition = (i * (long long)driver.numberOfQueries) / driver.connections;
+		connections[i].queriesToSend = (driver.requests == 0) ? -1 : (driver.requests / driver.connections) + (i < driver.requests % driver.connections);
+		connections[i].socketfd = driverConnect();
+		if (connections[i].socketfd < 0)
+		{
+			status = 2;
+			driver.connections = i;
+			break;
+		}
+	}
+
+	// run the connections
+	if (status == 0)
+	{
+		driver.startNanoseconds = driverNanoseconds();
+		driver.endNanoseconds = driver.startNanoseconds + (long long)(driver.duration * 1e9);
+		for (int i = 0; i < driver.connections; i++)
+		{
+			pthread_create(&connections[i].thread, NULL, runDriverConnection, &connections[i]);
+		}
+		for (int i = 0; i < driver.connections; i++)
+		{
+			pthread_join(connections[i].thread, NULL);
+		}
+		driver.endNanoseconds = driverNanoseconds();
+		reportDriverRun(connections);
+	}
+	else
+	{
+		for (int i = 0; i < driver.connections; i++)
+		{
+			close(connections[i].socketfd);
+		}
+	}
+
+	// clean up
+	if (serverPid > 0)
+	{
+		kill(serverPid, SIGTERM);
+		waitpid(serverPid, NULL, 0);
+	}
+	for (int i = 0; i < driver.connections; i++)
+	{
+		free(connections[i].samples);
+		while (connections[i].variables != NULL)
+		{
+			driverVariable* next = connections[i].variables->next;
+			free(connections[i].variables->name);
+			free(connections[i].variables->currentName);
+			free(connections[i].variables);
+			connections[i].variables = next;
+		}
+	}
+	free(connections);
+	return status;
+}
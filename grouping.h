@@ -0,0 +1,359 @@
+// the aggregates a group can compute
+#define GROUP_SUM 0
+#define GROUP_MIN 1
+#define GROUP_MAX 2
+#define GROUP_COUNT 3
+
+// keys whose range is at most this wide (and not much wider than the number of rows) are grouped in
+// an array indexed by key instead of a hash table
+#define DIRECT_GROUP_RANGE (1 << 20)
+
+// at least this many rows are grouped in parallel: each thread pre-aggregates its rows in a small
+// table that stays in cache, spilling it into partitions by hash whenever it fills up, and the
+// partitions are then merged in parallel. few distinct keys never spill, many spill often and are
+// aggregated by the merge
+#define GROUP_PARALLEL_ROWS (1 << 18)
+#define GROUP_LOCAL_SLOTS (1 << 14)
+#define GROUP_PARTITION_BITS 6
+#define GROUP_PARTITIONS (1 << GROUP_PARTITION_BITS)
+
+// an open addressing (linear probing) hash table of groups. each slot holds a key and the state of its
+// group: the number of rows in it, then an accumulator per vector of values. empty slots count 0 rows
+typedef struct groupTable
+{
+	long long* keys;
+	long long* states;
+	int capacity;                   // a power of 2
+	int numberOfGroups;
+	int stride;                     // long longs per state
+}groupTable;
+
+// groups spilled by a thread into a partition: a key and its state, one after another
+typedef struct groupSpill
+{
+	long long* entries;
+	int numberOfEntries;
+	int capacity;
+}groupSpill;
+
+// what a parallel grouping shares between its threads
+typedef struct groupInput
+{
+	long long* keys;
+	long long** values;
+	int numberOfVectors;
+	int function;
+}groupInput;
+
+// a thread's rows to pre-aggregate, and the groups it spilled
+typedef struct groupChunk
+{
+	groupInput* input;
+	int start;
+	int end;
+	groupSpill spills[GROUP_PARTITIONS];
+}groupChunk;
+
+// a partition to merge, and its groups once merged
+typedef struct groupMerge
+{
+	groupChunk* chunks;
+	int numberOfChunks;
+	int partition;
+	groupTable table;
+}groupMerge;
+
+// mixes the bits of a key, so both the high bits (partitions) and the low bits (slots) spread
+unsigned long long groupHash(long long key)
+{
+	unsigned long long hash = key;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// the value an accumulator starts at
+long long groupIdentity(int function)
+{
+	return (function == GROUP_MIN) ? LLONG_MAX : ((function == GROUP_MAX) ? LLONG_MIN : 0);
+}
+
+// folds a value (or the accumulator of another group with the same key) into an accumulator
+long long accumulateGroup(int function, long long accumulator, long long value)
+{
+	if (function == GROUP_MIN)
+		return (value < accumulator) ? value : accumulator;
+	else if (function == GROUP_MAX)
+		return (value > accumulator) ? value : accumulator;
+	return accumulator + value;
+}
+
+// sets up an empty table with room for capacity (a power of 2) slots
+void createGroupTable(groupTable* table, int capacity, int numberOfVectors)
+{
+	table->capacity = capacity;
+	table->numberOfGroups = 0;
+	table->stride = 1 + numberOfVectors;
+	table->keys = malloc(capacity * sizeof(long long));
+	table->states = calloc((size_t)capacity * table->stride, sizeof(long long));
+}
+
+void destroyGroupTable(groupTable* table)
+{
+	free(table->keys);
+	free(table->states);
+}
+
+// returns the state of the group of a key, adding the group (with its accumulators at their identity)
+// if it is new. the table must have a free slot
+long long* findGroup(groupTable* table, long long key, int function)
+{
+	int mask = table->capacity - 1;
+	int slot = groupHash(key) & mask;
+	while ((table->states[(size_t)slot * table->stride] != 0) && (table->keys[slot] != key))
+	{
+		slot = (slot + 1) & mask;
+	}
+	long long* state = &table->states[(size_t)slot * table->stride];
+	if (state[0] == 0)
+	{
+		table->keys[slot] = key;
+		for (int i = 1; i < table->stride; i++)
+			state[i] = groupIdentity(function);
+		table->numberOfGroups++;
+	}
+	return state;
+}
+
+// doubles the slots of a table, rehashing its groups
+void growGroupTable(groupTable* table, int function)
+{
+	groupTable grown;
+	createGroupTable(&grown, table->capacity * 2, table->stride - 1);
+	for (int slot = 0; slot < table->capacity; slot++)
+	{
+		long long* state = &table->states[(size_t)slot * table->stride];
+		if (state[0] != 0)
+			memcpy(findGroup(&grown, table->keys[slot], function), state, table->stride * sizeof(long long));
+	}
+	destroyGroupTable(table);
+	*table = grown;
+}
+
+// merges a group's state (computed elsewhere) into the table, growing it to stay at most half full
+void mergeGroup(groupTable* table, long long key, long long* state, int function)
+{
+	if ((table->numberOfGroups + 1) * 2 > table->capacity)
+		growGroupTable(table, function);
+	long long* merged = findGroup(table, key, function);
+	merged[0] += state[0];
+	for (int i = 1; i < table->stride; i++)
+		merged[i] = accumulateGroup(function, merged[i], state[i]);
+}
+
+// appends the groups of a thread's table to the partitions they hash to, and empties the table
+void spillGroupTable(groupTable* table, groupSpill* spills)
+{
+	int entrySize = 1 + table->stride;
+	for (int slot = 0; slot < table->capacity; slot++)
+	{
+		long long* state = &table->states[(size_t)slot * table->stride];
+		if (state[0] == 0)
+			continue;
+		groupSpill* spill = &spills[groupHash(table->keys[slot]) >> (64 - GROUP_PARTITION_BITS)];
+		if (spill->numberOfEntries == spill->capacity)
+		{
+			spill->capacity = (spill->capacity == 0) ? 256 : spill->capacity * 2;
+			spill->entries = realloc(spill->entries, (size_t)spill->capacity * entrySize * sizeof(long long));
+		}
+		long long* entry = &spill->entries[(size_t)spill->numberOfEntries++ * entrySize];
+		entry[0] = table->keys[slot];
+		memcpy(entry + 1, state, table->stride * sizeof(long long));
+		memset(state, 0, table->stride * sizeof(long long));
+	}
+	table->numberOfGroups = 0;
+}
+
+// pre-aggregates a thread's rows in a table of GROUP_LOCAL_SLOTS slots, spilling it whenever it is
+// half full and once at the end
+void preaggregateGroupChunk(void* task)
+{
+	groupChunk* chunk = task;
+	groupInput* input = chunk->input;
+	groupTable table;
+	createGroupTable(&table, GROUP_LOCAL_SLOTS, input->numberOfVectors);
+	for (int row = chunk->start; row < chunk->end; row++)
+	{
+		if (table.numberOfGroups * 2 >= table.capacity)
+			spillGroupTable(&table, chunk->spills);
+		long long* state = findGroup(&table, input->keys[row], input->function);
+		state[0]++;
+		for (int i = 0; i < input->numberOfVectors; i++)
+			state[i + 1] = accumulateGroup(input->function, state[i + 1], input->values[i][row]);
+	}
+	spillGroupTable(&table, chunk->spills);
+	destroyGroupTable(&table);
+}
+
+// merges what every thread spilled into a partition
+void mergeGroupPartition(void* task)
+{
+	groupMerge* merge = task;
+	int function = merge->chunks[0].input->function;
+	createGroupTable(&merge->table, 1024, merge->chunks[0].input->numberOfVectors);
+	int entrySize = 1 + merge->table.stride;
+	for (int i = 0; i < merge->numberOfChunks; i++)
+	{
+		groupSpill* spill = &merge->chunks[i].spills[merge->partition];
+		for (int entry = 0; entry < spill->numberOfEntries; entry++)
+			mergeGroup(&merge->table, spill->entries[(size_t)entry * entrySize], &spill->entries[(size_t)entry * entrySize + 1], function);
+		free(spill->entries);
+	}
+}
+
+// the distinct keys of a grouping, and per key the number of rows and an aggregate per vector of
+// values (each array malloc'd)
+typedef struct groupResult
+{
+	int numberOfGroups;
+	long long* keys;
+	long long* counts;
+	long long** aggregates;
+}groupResult;
+
+// allocates the arrays of a result
+void createGroupResult(groupResult* result, int numberOfGroups, int numberOfVectors)
+{
+	result->numberOfGroups = 0;
+	result->keys = malloc(((size_t)numberOfGroups + 1) * sizeof(long long));
+	result->counts = malloc(((size_t)numberOfGroups + 1) * sizeof(long long));
+	result->aggregates = malloc((numberOfVectors + 1) * sizeof(long long*));
+	for (int i = 0; i < numberOfVectors; i++)
+		result->aggregates[i] = malloc(((size_t)numberOfGroups + 1) * sizeof(long long));
+}
+
+// appends the groups of a table to a result
+void appendGroupTable(groupResult* result, groupTable* table)
+{
+	for (int slot = 0; slot < table->capacity; slot++)
+	{
+		long long* state = &table->states[(size_t)slot * table->stride];
+		if (state[0] == 0)
+			continue;
+		result->keys[result->numberOfGroups] = table->keys[slot];
+		result->counts[result->numberOfGroups] = state[0];
+		for (int i = 1; i < table->stride; i++)
+			result->aggregates[i - 1][result->numberOfGroups] = state[i];
+		result->numberOfGroups++;
+	}
+}
+
+// groups rows by key in an array indexed by key - minimum, returning the groups in key order
+void groupByDirectIndex(groupInput* input, int numberOfRows, long long minimum, long long range, groupResult* result)
+{
+	int stride = 1 + input->numberOfVectors;
+	long long* states = malloc((size_t)range * stride * sizeof(long long));
+	for (long long slot = 0; slot < range; slot++)
+	{
+		states[slot * stride] = 0;
+		for (int i = 1; i < stride; i++)
+			states[slot * stride + i] = groupIdentity(input->function);
+	}
+	for (int row = 0; row < numberOfRows; row++)
+	{
+		long long* state = &states[(input->keys[row] - minimum) * stride];
+		state[0]++;
+		for (int i = 0; i < input->numberOfVectors; i++)
+			state[i + 1] = accumulateGroup(input->function, state[i + 1], input->values[i][row]);
+	}
+	int numberOfGroups = 0;
+	for (long long slot = 0; slot < range; slot++)
+		numberOfGroups += (states[slot * stride] != 0);
+	createGroupResult(result, numberOfGroups, input->numberOfVectors);
+	for (long long slot = 0; slot < range; slot++)
+	{
+		long long* state = &states[slot * stride];
+		if (state[0] == 0)
+			continue;
+		result->keys[result->numberOfGroups] = minimum + slot;
+		result->counts[result->numberOfGroups] = state[0];
+		for (int i = 1; i < stride; i++)
+			result->aggregates[i - 1][result->numberOfGroups] = state[i];
+		result->numberOfGroups++;
+	}
+	free(states);
+}
+
+// groups rows by key in a single hash table
+void groupByHashTable(groupInput* input, int numberOfRows, groupResult* result)
+{
+	groupTable table;
+	createGroupTable(&table, 1024, input->numberOfVectors);
+	for (int row = 0; row < numberOfRows; row++)
+	{
+		if ((table.numberOfGroups + 1) * 2 > table.capacity)
+			growGroupTable(&table, input->function);
+		long long* group = findGroup(&table, input->keys[row], input->function);
+		group[0]++;
+		for (int i = 0; i < input->numberOfVectors; i++)
+			group[i + 1] = accumulateGroup(input->function, group[i + 1], input->values[i][row]);
+	}
+	createGroupResult(result, table.numberOfGroups, input->numberOfVectors);
+	appendGroupTable(result, &table);
+	destroyGroupTable(&table);
+}
+
+// groups rows by key with thread-local pre-aggregation and a partitioned, parallel merge
+void groupByPartitionedMerge(groupInput* input, int numberOfRows, groupResult* result)
+{
+	groupChunk* chunks = calloc(PARTITION_THREADS, sizeof(groupChunk));
+	int rowsPerChunk = (numberOfRows + PARTITION_THREADS - 1) / PARTITION_THREADS;
+	for (int i = 0; i < PARTITION_THREADS; i++)
+	{
+		chunks[i].input = input;
+		chunks[i].start = (i * rowsPerChunk < numberOfRows) ? i * rowsPerChunk : numberOfRows;
+		chunks[i].end = ((i + 1) * rowsPerChunk < numberOfRows) ? (i + 1) * rowsPerChunk : numberOfRows;
+	}
+	runPartitionTasks(preaggregateGroupChunk, chunks, sizeof(groupChunk), PARTITION_THREADS);
+	groupMerge* merges = calloc(GROUP_PARTITIONS, sizeof(groupMerge));
+	for (int i = 0; i < GROUP_PARTITIONS; i++)
+	{
+		merges[i].chunks = chunks;
+		merges[i].numberOfChunks = PARTITION_THREADS;
+		merges[i].partition = i;
+	}
+	runPartitionTasks(mergeGroupPartition, merges, sizeof(groupMerge), GROUP_PARTITIONS);
+	int numberOfGroups = 0;
+	for (int i = 0; i < GROUP_PARTITIONS; i++)
+		numberOfGroups += merges[i].table.numberOfGroups;
+	createGroupResult(result, numberOfGroups, input->numberOfVectors);
+	for (int i = 0; i < GROUP_PARTITIONS; i++)
+	{
+		appendGroupTable(result, &merges[i].table);
+		destroyGroupTable(&merges[i].table);
+	}
+	free(merges);
+	free(chunks);
+}
+
+// groups the rows of aligned vectors of keys and values by key, computing the number of rows and an
+// aggregate (sum, min, or max) of each vector of values per group. keys in a small dense range are
+// grouped in an array (and come out in key order), others in a hash table, in parallel if there are
+// many rows (in no particular order)
+void groupRows(groupInput* input, int numberOfRows, groupResult* result)
+{
+	long long minimum = LLONG_MAX;
+	long long maximum = LLONG_MIN;
+	long long sum = 0;
+	aggregateKernels[COLUMN_INT64](input->keys, numberOfRows, &sum, &minimum, &maximum);
+	unsigned long long range = (numberOfRows > 0) ? (unsigned long long)maximum - (unsigned long long)minimum + 1 : 0;
+	if ((range > 0) && (range <= DIRECT_GROUP_RANGE) && (range <= 2 * (unsigned long long)numberOfRows + 1024))
+		groupByDirectIndex(input, numberOfRows, minimum, range, result);
+	else if (numberOfRows < GROUP_PARALLEL_ROWS)
+		groupByHashTable(input, numberOfRows, result);
+	else
+		groupByPartitionedMerge(input, numberOfRows, result);
+}
@@ -1,76 +1,235 @@
-// a struct for storing intermediate results
+// intermediate result types
+#define POSITION_LIST 1
+#define VALUE_LIST 2
+#define SCALAR_VALUE 3
+#define AVERAGE_VALUE 4
+// a Bloom filter keeps its words in values (numberOfValues of them) and the number of values it was
+// built from in scalarValue
+#define BLOOM_FILTER 5
+
+// initial number of slots in a session's variable table (must be a power of 2)
+#define VARIABLE_TABLE_INITIAL_SLOTS 64
+
+// a struct for storing intermediate results. results and their lists are allocated from the pool
 typedef struct intermediateResult
 {
 	char* variableName;
+	int resultType;
 	int* validPositions;
 	int numberOfValidPositions;
-	struct intermediateResult* next;
+	void* values;                   // of the width of the column they were fetched from
+	int valueType;
+	int numberOfValues;
+	long long scalarValue;
+	double averageValue;
+	int referenceCount;             // the variable table holds one reference, operators may hold more
+	size_t bytes;                   // memory used by the result, counted against its session
 }intermediateResult;
-intermediateResult* intermediateResultRoot = NULL;
 
-// inserts an intermediate result into a linked list
-void insertIntermediateResultIntoLinkedList(intermediateResult* variable)
+// marks a slot of a variable table whose variable was dropped
+intermediateResult droppedVariable;
+#define DROPPED_SLOT (&droppedVariable)
+
+// a struct for storing the state of a client's session: its connection and its variables,
+// kept in an open addressing hash table keyed on the variable name
+typedef struct session
 {
-	// if list is empty
-	if (intermediateResultRoot == NULL)
+	int connectionfd;
+	bool active;
+	bool localConnection;           // true if the client connected through a Unix domain socket
+	bool compressResults;           // true if the client asked for large results to be compressed
+	intermediateResult** variables;
+	int numberOfSlots;
+	int numberOfVariables;
+	int numberOfUsedSlots;          // variables plus dropped slots
+	size_t memoryInUse;
+	arena queryArena;               // memory for the query currently being evaluated
+	preparedStatement* preparedStatements;
+}session;
+
+// creates an empty intermediate result of the given type
+intermediateResult* createIntermediateResult(char* variableName, int resultType)
+{
+	intermediateResult* variable = poolAllocate(sizeof(intermediateResult));
+	memset(variable, 0, sizeof(intermediateResult));
+	variable->variableName = poolAllocate(strlen(variableName) + 1);
+	strcpy(variable->variableName, variableName);
+	variable->resultType = resultType;
+	variable->referenceCount = 1;
+	return variable;
+}
+
+// takes another reference to an intermediate result
+void retainIntermediateResult(intermediateResult* variable)
+{
+	variable->referenceCount++;
+}
+
+// releases a reference to an intermediate result, freeing it once nothing references it
+void releaseIntermediateResult(intermediateResult* variable)
+{
+	if (--variable->referenceCount > 0)
 	{
-		intermediateResultRoot = variable;
+		return;
 	}
+	poolFree(variable->variableName);
+	poolFree(variable->validPositions);
+	poolFree(variable->values);
+	poolFree(variable);
+}
 
-	// if list is not empty, insert the new element at the head of it
-	else
+// hashes a variable name (FNV-1a)
+unsigned int hashVariableName(char* variableName)
+{
+	unsigned int hash = 2166136261u;
+	for (unsigned char* c = (unsigned char*)variableName; *c != '\0'; c++)
 	{
-		variable->next = intermediateResultRoot;
-		intermediateResultRoot = variable;
+		hash = (hash ^ *c) * 16777619u;
 	}
+	return hash;
 }
 
-// checks if an intermediate result is in a linked list
-intermediateResult* checkForIntermediateResultInLinkedList(char* variableName)
+// creates a session for a client connection
+session* createSession(int connectionfd)
 {
-	intermediateResult* trav = intermediateResultRoot;
-	while (trav != NULL)
+	session* newSession = calloc(1, sizeof(session));
+	newSession->connectionfd = connectionfd;
+	newSession->active = true;
+	struct sockaddr_storage address;
+	socklen_t addressLength = sizeof(address);
+	newSession->localConnection = (getsockname(connectionfd, (struct sockaddr*)&address, &addressLength) == 0) && (address.ss_family == AF_UNIX);
+	newSession->numberOfSlots = VARIABLE_TABLE_INITIAL_SLOTS;
+	newSession->variables = calloc(newSession->numberOfSlots, sizeof(intermediateResult*));
+	return newSession;
+}
+
+// returns the slot holding a variable, or the empty slot where it would be inserted
+int findVariableSlot(session* currentSession, char* variableName)
+{
+	unsigned int mask = currentSession->numberOfSlots - 1;
+	int firstDroppedSlot = -1;
+	for (unsigned int slot = hashVariableName(variableName) & mask; ; slot = (slot + 1) & mask)
 	{
-		// see if names match
-		if (strcmp(variableName, trav->variableName) == 0)
+		intermediateResult* variable = currentSession->variables[slot];
+		if (variable == NULL)
 		{
-			return trav;
+			return (firstDroppedSlot != -1) ? firstDroppedSlot : (int)slot;
+		}
+		else if (variable == DROPPED_SLOT)
+		{
+			firstDroppedSlot = (firstDroppedSlot == -1) ? (int)slot : firstDroppedSlot;
+		}
+		else if (strcmp(variableName, variable->variableName) == 0)
+		{
+			return slot;
 		}
-
-		// update pointer
-		trav = trav->next;
 	}
-	return NULL;
 }
 
-// simply prints a linked list (for debugging purposes)
-void printLinkedListOfIntermediateResults(void)
+// finds an intermediate result in a session, NULL if it does not exist
+intermediateResult* lookupIntermediateResult(session* currentSession, char* variableName)
 {
-	printf("-----\n");
-	printf("Linked list of variables: \n");
-	intermediateResult* trav = intermediateResultRoot;
-	while (trav != NULL)
+	intermediateResult* variable = currentSession->variables[findVariableSlot(currentSession, variableName)];
+	return ((variable == NULL) || (variable == DROPPED_SLOT)) ? NULL : variable;
+}
+
+// doubles the number of slots in a session's variable table, throwing away dropped slots
+void growVariableTable(session* currentSession)
+{
+	intermediateResult** oldVariables = currentSession->variables;
+	int oldNumberOfSlots = currentSession->numberOfSlots;
+	currentSession->numberOfSlots *= 2;
+	currentSession->variables = calloc(currentSession->numberOfSlots, sizeof(intermediateResult*));
+	currentSession->numberOfUsedSlots = currentSession->numberOfVariables;
+	for (int i = 0; i < oldNumberOfSlots; i++)
 	{
-		if (trav != intermediateResultRoot)
+		if ((oldVariables[i] != NULL) && (oldVariables[i] != DROPPED_SLOT))
 		{
-			printf("-----\n");
+			currentSession->variables[findVariableSlot(currentSession, oldVariables[i]->variableName)] = oldVariables[i];
 		}
-		printf("variableName: [%s]\n", trav->variableName);
-		printf("numberOfValidPositions: [%d]\n", trav->numberOfValidPositions);
-		printf("[");
-		for (int i = 0; i < trav->numberOfValidPositions; i++)
+	}
+	free(oldVariables);
+}
+
+// inserts an intermediate result into a session, which takes over the caller's reference.
+// the variable name must not already exist in the session
+void insertIntermediateResult(session* currentSession, intermediateResult* variable)
+{
+	// keep the table at most 3/4 full
+	if ((currentSession->numberOfUsedSlots + 1) * 4 > currentSession->numberOfSlots * 3)
+	{
+		growVariableTable(currentSession);
+	}
+
+	// account for the variable's memory
+	size_t listBytes = (variable->numberOfValidPositions * sizeof(int)) + ((size_t)variable->numberOfValues * columnTypeWidths[variable->valueType]);
+	variable->bytes = sizeof(intermediateResult) + strlen(variable->variableName) + 1 + listBytes;
+	currentSession->memoryInUse += variable->bytes;
+	recordIntermediateMemory(variable->bytes);
+
+	// store the variable
+	int slot = findVariableSlot(currentSession, variable->variableName);
+	if (currentSession->variables[slot] == NULL)
+	{
+		currentSession->numberOfUsedSlots++;
+	}
+	currentSession->variables[slot] = variable;
+	currentSession->numberOfVariables++;
+}
+
+// drops an intermediate result from a session. returns false if it does not exist
+bool dropIntermediateResult(session* currentSession, char* variableName)
+{
+	int slot = findVariableSlot(currentSession, variableName);
+	intermediateResult* variable = currentSession->variables[slot];
+	if ((variable == NULL) || (variable == DROPPED_SLOT))
+	{
+		return false;
+	}
+	currentSession->variables[slot] = DROPPED_SLOT;
+	currentSession->numberOfVariables--;
+	currentSession->memoryInUse -= variable->bytes;
+	recordIntermediateMemory(-(long long)variable->bytes);
+	releaseIntermediateResult(variable);
+	return true;
+}
+
+// releases every intermediate result of a session and frees it. returns the bytes reclaimed
+size_t destroySession(session* currentSession)
+{
+	size_t reclaimed = currentSession->memoryInUse;
+	recordIntermediateMemory(-(long long)reclaimed);
+	for (int i = 0; i < currentSession->numberOfSlots; i++)
+	{
+		if ((currentSession->variables[i] != NULL) && (currentSession->variables[i] != DROPPED_SLOT))
 		{
-			if (i + 1 != trav->numberOfValidPositions)
-			{
-				printf("%d,", trav->validPositions[i]);
-			}
-			else
-			{
-				printf("%d]\n", trav->validPositions[i]);
-			}
+			releaseIntermediateResult(currentSession->variables[i]);
 		}
-		trav = trav->next;
 	}
+	free(currentSession->variables);
+	destroyArena(&currentSession->queryArena);
+	destroyPreparedStatements(currentSession->preparedStatements);
+	free(currentSession);
+	return reclaimed;
+}
+
+// simply prints the variables of a session (for debugging purposes)
+void printIntermediateResults(session* currentSession)
+{
 	printf("-----\n");
-	printf("End of list\n");
-}
\ No newline at end of file
+	printf("Variables (%d, %zu bytes): \n", currentSession->numberOfVariables, currentSession->memoryInUse);
+	for (int i = 0; i < currentSession->numberOfSlots; i++)
+	{
+		intermediateResult* variable = currentSession->variables[i];
+		if ((variable == NULL) || (variable == DROPPED_SLOT))
+		{
+			continue;
+		}
+		printf("variableName: [%s]\n", variable->variableName);
+		printf("resultType: [%d]\n", variable->resultType);
+		printf("numberOfValidPositions: [%d]\n", variable->numberOfValidPositions);
+		printf("numberOfValues: [%d]\n", variable->numberOfValues);
+		printf("-----\n");
+	}
+	printf("End of variables\n");
+}
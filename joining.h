@@ -0,0 +1,180 @@
+// a blocked Bloom filter is split into blocks of 8 32 bit words (a cache line holds two), and a key
+// sets one bit in every word of a single block, so a lookup touches one block and its 8 lanes can be
+// tested at once. about 16 bits per key keeps false positives well under 1%
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_BITS_PER_KEY 16
+
+// join build sides of at least this many rows prefilter the probe side with a Bloom filter of their
+// keys, since the filter fits in cache where the hash table does not
+#define JOIN_BLOOM_ROWS (1 << 16)
+
+// odd constants that pick the bit a key sets in each word of its block
+unsigned int bloomSalts[BLOOM_BLOCK_WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+typedef struct bloomFilter
+{
+	unsigned int* words;
+	int numberOfBlocks;
+}bloomFilter;
+
+// returns the number of blocks a filter of numberOfKeys keys is made of
+int bloomFilterBlocks(int numberOfKeys)
+{
+	long long bits = (long long)numberOfKeys * BLOOM_BITS_PER_KEY;
+	long long blocks = (bits + (32 * BLOOM_BLOCK_WORDS) - 1) / (32 * BLOOM_BLOCK_WORDS);
+	return (blocks < 1) ? 1 : (int)blocks;
+}
+
+// returns the first word of the block of a key (the high half of its hash picks the block, by a
+// multiply rather than a modulo, so the number of blocks needs not be a power of 2)
+unsigned int* bloomBlock(bloomFilter* filter, unsigned long long hash)
+{
+	return filter->words + ((((hash >> 32) * (unsigned long long)filter->numberOfBlocks) >> 32) * BLOOM_BLOCK_WORDS);
+}
+
+void insertBloomKey(bloomFilter* filter, long long key)
+{
+	unsigned long long hash = groupHash(key);
+	unsigned int* block = bloomBlock(filter, hash);
+	for (int i = 0; i < BLOOM_BLOCK_WORDS; i++)
+	{
+		block[i] |= 1U << ((((unsigned int)hash) * bloomSalts[i]) >> 27);
+	}
+}
+
+// returns 1 if the filter may hold the key, 0 if it certainly does not (branch free)
+int mayContainBloomKey(bloomFilter* filter, long long key)
+{
+	unsigned long long hash = groupHash(key);
+	unsigned int* block = bloomBlock(filter, hash);
+	unsigned int missing = 0;
+	for (int i = 0; i < BLOOM_BLOCK_WORDS; i++)
+	{
+		missing |= ~block[i] & (1U << ((((unsigned int)hash) * bloomSalts[i]) >> 27));
+	}
+	return (missing == 0);
+}
+
+// the select kernels again, keeping only the values the filter may hold. they run during the scan,
+// so values that cannot join are dropped before their positions are materialized
+#define DEFINE_BLOOM_KERNEL(name, type, minimum, maximum)                                                  \
+int selectBloomPositions_##name(void* column, int numberOfValues, long long low, long long high,            \
+                                bloomFilter* filter, int* positions)                                       \
+{                                                                                                          \
+	type* values = column;                                                                                 \
+	if ((low > high) || (low > maximum) || (high < minimum))                                               \
+		return 0;                                                                                          \
+	type clampedLow = (low < minimum) ? minimum : low;                                                     \
+	type clampedHigh = (high > maximum) ? maximum : high;                                                  \
+	int selected = 0;                                                                                      \
+	for (int i = 0; i < numberOfValues; i++)                                                               \
+	{                                                                                                      \
+		positions[selected] = i;                                                                           \
+		selected += (values[i] >= clampedLow) & (values[i] <= clampedHigh) & mayContainBloomKey(filter, values[i]); \
+	}                                                                                                      \
+	return selected;                                                                                       \
+}
+
+FOR_EACH_COLUMN_TYPE(DEFINE_BLOOM_KERNEL)
+
+#define BLOOM_KERNEL(name, type, minimum, maximum) selectBloomPositions_##name,
+int (*bloomKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, long long, long long, bloomFilter*, int*) = {FOR_EACH_COLUMN_TYPE(BLOOM_KERNEL)};
+
+// a hash table of the rows of a join's build side: the first row of each bucket, then each row's
+// next row in its bucket (-1 ends a bucket). rows are chained in reverse, so they are inserted in
+// reverse to come out in order
+typedef struct joinTable
+{
+	int* heads;
+	int* next;
+	long long* keys;
+	unsigned long long mask;
+}joinTable;
+
+void createJoinTable(joinTable* table, long long* keys, int numberOfRows)
+{
+	unsigned long long capacity = 16;
+	while (capacity < 2 * (unsigned long long)numberOfRows)
+		capacity *= 2;
+	table->heads = malloc(capacity * sizeof(int));
+	table->next = malloc(((size_t)numberOfRows + 1) * sizeof(int));
+	table->keys = keys;
+	table->mask = capacity - 1;
+	memset(table->heads, -1, capacity * sizeof(int));
+	for (int row = numberOfRows - 1; row >= 0; row--)
+	{
+		unsigned long long bucket = groupHash(keys[row]) & table->mask;
+		table->next[row] = table->heads[bucket];
+		table->heads[bucket] = row;
+	}
+}
+
+void destroyJoinTable(joinTable* table)
+{
+	free(table->heads);
+	free(table->next);
+}
+
+// the rows of both sides that join, as growing arrays
+typedef struct joinMatches
+{
+	int* buildRows;
+	int* probeRows;
+	int numberOfMatches;
+	int capacity;
+}joinMatches;
+
+void addJoinMatch(joinMatches* matches, int buildRow, int probeRow)
+{
+	if (matches->numberOfMatches == matches->capacity)
+	{
+		matches->capacity = (matches->capacity == 0) ? 1024 : 2 * matches->capacity;
+		matches->buildRows = realloc(matches->buildRows, (size_t)matches->capacity * sizeof(int));
+		matches->probeRows = realloc(matches->probeRows, (size_t)matches->capacity * sizeof(int));
+	}
+	matches->buildRows[matches->numberOfMatches] = buildRow;
+	matches->probeRows[matches->numberOfMatches] = probeRow;
+	matches->numberOfMatches++;
+}
+
+// equi-joins the keys of a build side with those of a probe side, in the order of the probe rows
+// (and of equal keys, the order of the build rows). a large build side first builds a Bloom filter of
+// its keys, and the probe rows are run through it, so only those that may match reach the hash table
+void hashJoinRows(long long* buildKeys, int numberOfBuildRows, long long* probeKeys, int numberOfProbeRows, joinMatches* matches)
+{
+	memset(matches, 0, sizeof(joinMatches));
+	joinTable table;
+	createJoinTable(&table, buildKeys, numberOfBuildRows);
+	int* candidates = malloc(((size_t)numberOfProbeRows + 1) * sizeof(int));
+	int numberOfCandidates = numberOfProbeRows;
+	if (numberOfBuildRows >= JOIN_BLOOM_ROWS)
+	{
+		bloomFilter filter;
+		filter.numberOfBlocks = bloomFilterBlocks(numberOfBuildRows);
+		filter.words = calloc((size_t)filter.numberOfBlocks * BLOOM_BLOCK_WORDS, sizeof(unsigned int));
+		for (int row = 0; row < numberOfBuildRows; row++)
+		{
+			insertBloomKey(&filter, buildKeys[row]);
+		}
+		numberOfCandidates = bloomKernels[COLUMN_INT64](probeKeys, numberOfProbeRows, LLONG_MIN, LLONG_MAX, &filter, candidates);
+		free(filter.words);
+	}
+	else
+	{
+		for (int row = 0; row < numberOfProbeRows; row++)
+			candidates[row] = row;
+	}
+	for (int i = 0; i < numberOfCandidates; i++)
+	{
+		int probeRow = candidates[i];
+		long long key = probeKeys[probeRow];
+		for (int row = table.heads[groupHash(key) & table.mask]; row != -1; row = table.next[row])
+		{
+			if (table.keys[row] == key)
+				addJoinMatch(matches, row, probeRow);
+		}
+	}
+	free(candidates);
+	destroyJoinTable(&table);
+}
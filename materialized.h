@@ -0,0 +1,275 @@
+// what a materialized aggregate is over: every value of a column, the values of a column in a range,
+// or the values of a column per key (the value of a key column in the same row)
+#define MATERIALIZED_TOTAL 0
+#define MATERIALIZED_RANGE 1
+#define MATERIALIZED_GROUPS 2
+
+// set in the storage type of the file of a materialized aggregate, db/<name>.mat. it is versioned and
+// published like a column file, so a load publishes its columns and the aggregates over them at once
+#define MATERIALIZED_AGGREGATE (1 << 17)
+#define MATERIALIZED_SUFFIX ".mat"
+
+// identifies a version of a column's file across restarts (segment versions are counted from 1 again
+// by every server): its inode and when it was last written
+typedef struct columnFileStamp
+{
+	unsigned long long inode;
+	long long modified;
+}columnFileStamp;
+
+// the definition of a materialized aggregate and its state: the count, sum, min, and max of the values
+// it is over, or the count and sum of each group (their keys, counts, and sums follow in the file)
+typedef struct materializedDefinition
+{
+	int kind;
+	char column[PARTITION_KEY_LENGTH];
+	char keyColumn[PARTITION_KEY_LENGTH];
+	long long low;
+	long long high;
+	columnFileStamp columnStamp;    // the versions of the columns the state is up to date with
+	columnFileStamp keyStamp;
+	long long count;
+	long long sum;
+	long long min;
+	long long max;
+	int numberOfGroups;
+}materializedDefinition;
+
+typedef struct materializedAggregate
+{
+	materializedDefinition definition;
+	long long* keys;
+	long long* counts;
+	long long* sums;
+}materializedAggregate;
+
+// stamps the file open at fd, returns false if it cannot be
+bool stampColumnFd(int fd, columnFileStamp* stamp)
+{
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+		return false;
+	stamp->inode = status.st_ino;
+	stamp->modified = ((long long)status.st_mtim.tv_sec * 1000000000LL) + status.st_mtim.tv_nsec;
+	return true;
+}
+
+// stamps the file at path, returns false if there is none
+bool stampColumnPath(char* path, columnFileStamp* stamp)
+{
+	struct stat status;
+	if ((path == NULL) || (stat(path, &status) != 0))
+		return false;
+	stamp->inode = status.st_ino;
+	stamp->modified = ((long long)status.st_mtim.tv_sec * 1000000000LL) + status.st_mtim.tv_nsec;
+	return true;
+}
+
+bool sameColumnFileStamp(columnFileStamp* first, columnFileStamp* second)
+{
+	return (first->inode == second->inode) && (first->modified == second->modified);
+}
+
+// writes the name the file of a materialized aggregate is stored under (room for strlen(name) + 5)
+void materializedFileName(char* name, char* fileName)
+{
+	sprintf(fileName, "%s%s", name, MATERIALIZED_SUFFIX);
+}
+
+// empties the state of a materialized aggregate
+void clearMaterializedState(materializedAggregate* aggregate)
+{
+	aggregate->definition.count = 0;
+	aggregate->definition.sum = 0;
+	aggregate->definition.min = LLONG_MAX;
+	aggregate->definition.max = LLONG_MIN;
+	aggregate->definition.numberOfGroups = 0;
+	aggregate->keys = NULL;
+	aggregate->counts = NULL;
+	aggregate->sums = NULL;
+}
+
+void freeMaterializedAggregate(materializedAggregate* aggregate)
+{
+	free(aggregate->keys);
+	free(aggregate->counts);
+	free(aggregate->sums);
+	aggregate->keys = NULL;
+	aggregate->counts = NULL;
+	aggregate->sums = NULL;
+}
+
+// reads the materialized aggregate in the file at path, returns false if there is none or it is invalid
+bool readMaterializedAggregateAt(char* path, materializedAggregate* aggregate)
+{
+	FILE* fp = (path == NULL) ? NULL : fopen(path, "rb");
+	if (fp == NULL)
+		return false;
+	int headerStorageType = 0;
+	int headerStorageSize = 0;
+	bool read = (fread(&headerStorageType, sizeof(int), 1, fp) == 1) && (fread(&headerStorageSize, sizeof(int), 1, fp) == 1) &&
+	            (headerStorageType == MATERIALIZED_AGGREGATE) && (fread(&aggregate->definition, sizeof(materializedDefinition), 1, fp) == 1);
+	int groups = read ? aggregate->definition.numberOfGroups : 0;
+	aggregate->keys = malloc(((size_t)groups + 1) * sizeof(long long));
+	aggregate->counts = malloc(((size_t)groups + 1) * sizeof(long long));
+	aggregate->sums = malloc(((size_t)groups + 1) * sizeof(long long));
+	read = read && (fread(aggregate->keys, sizeof(long long), groups, fp) == (size_t)groups) &&
+	       (fread(aggregate->counts, sizeof(long long), groups, fp) == (size_t)groups) &&
+	       (fread(aggregate->sums, sizeof(long long), groups, fp) == (size_t)groups);
+	fclose(fp);
+	if (!read)
+		freeMaterializedAggregate(aggregate);
+	return read;
+}
+
+// writes a materialized aggregate as a new segment of its file and stages it. the caller holds the
+// writers lock. returns false (discarding the segment) if it cannot be written
+bool stageMaterializedAggregate(char* name, materializedAggregate* aggregate)
+{
+	char fileName[strlen(name) + 5];
+	materializedFileName(name, fileName);
+	int headerStorageType = MATERIALIZED_AGGREGATE;
+	int groups = aggregate->definition.numberOfGroups;
+	int headerStorageSize = sizeof(materializedDefinition) + (3 * groups * sizeof(long long));
+	FILE* fp = createColumnSegment(fileName);
+	bool written = (fp != NULL) && (fwrite(&headerStorageType, sizeof(int), 1, fp) == 1) && (fwrite(&headerStorageSize, sizeof(int), 1, fp) == 1) &&
+	               (fwrite(&aggregate->definition, sizeof(materializedDefinition), 1, fp) == 1) &&
+	               (fwrite(aggregate->keys, sizeof(long long), groups, fp) == (size_t)groups) &&
+	               (fwrite(aggregate->counts, sizeof(long long), groups, fp) == (size_t)groups) &&
+	               (fwrite(aggregate->sums, sizeof(long long), groups, fp) == (size_t)groups);
+	if (!written && (fp != NULL))
+		discardColumnSegment(fileName, fp);
+	return written && stageColumnSegment(fileName, fp);
+}
+
+// folds rows (their values, and for groups their keys) into the state of a materialized aggregate
+void addRowsToMaterializedAggregate(materializedAggregate* aggregate, long long* values, long long* keys, int numberOfRows)
+{
+	materializedDefinition* definition = &aggregate->definition;
+	if (definition->kind == MATERIALIZED_TOTAL)
+	{
+		aggregateKernels[COLUMN_INT64](values, numberOfRows, &definition->sum, &definition->min, &definition->max);
+		definition->count += numberOfRows;
+		return;
+	}
+	else if (definition->kind == MATERIALIZED_RANGE)
+	{
+		int* positions = malloc(((size_t)numberOfRows + 1) * sizeof(int));
+		long long* selected = malloc(((size_t)numberOfRows + 1) * sizeof(long long));
+		int numberOfSelected = selectKernels[COLUMN_INT64](values, numberOfRows, definition->low, definition->high, positions);
+		gatherKernels[COLUMN_INT64](values, numberOfRows, positions, numberOfSelected, selected);
+		aggregateKernels[COLUMN_INT64](selected, numberOfSelected, &definition->sum, &definition->min, &definition->max);
+		definition->count += numberOfSelected;
+		free(positions);
+		free(selected);
+		return;
+	}
+
+	// group the new rows, then merge their groups with the old ones
+	groupInput input = {keys, &values, 1, GROUP_SUM};
+	groupResult added;
+	groupRows(&input, numberOfRows, &added);
+	groupTable table;
+	int capacity = 1024;
+	while (capacity < 2 * (definition->numberOfGroups + added.numberOfGroups))
+		capacity *= 2;
+	createGroupTable(&table, capacity, 1);
+	long long state[2];
+	for (int i = 0; i < definition->numberOfGroups; i++)
+	{
+		state[0] = aggregate->counts[i];
+		state[1] = aggregate->sums[i];
+		mergeGroup(&table, aggregate->keys[i], state, GROUP_SUM);
+	}
+	for (int i = 0; i < added.numberOfGroups; i++)
+	{
+		state[0] = added.counts[i];
+		state[1] = added.aggregates[0][i];
+		mergeGroup(&table, added.keys[i], state, GROUP_SUM);
+	}
+	free(added.keys);
+	free(added.counts);
+	free(added.aggregates[0]);
+	free(added.aggregates);
+
+	groupResult merged;
+	createGroupResult(&merged, table.numberOfGroups, 1);
+	appendGroupTable(&merged, &table);
+	destroyGroupTable(&table);
+	freeMaterializedAggregate(aggregate);
+	aggregate->keys = merged.keys;
+	aggregate->counts = merged.counts;
+	aggregate->sums = merged.aggregates[0];
+	definition->numberOfGroups = merged.numberOfGroups;
+	free(merged.aggregates);
+}
+
+// returns the names of the materialized aggregates in the database (each malloc'd, as is the array)
+char** listMaterializedAggregates(int* numberOfAggregates)
+{
+	char** names = NULL;
+	*numberOfAggregates = 0;
+	DIR* directory = opendir("db");
+	if (directory == NULL)
+		return NULL;
+	struct dirent* entry;
+	size_t suffixLength = strlen(MATERIALIZED_SUFFIX);
+	while ((entry = readdir(directory)) != NULL)
+	{
+		size_t length = strlen(entry->d_name);
+		if ((length > suffixLength) && (strcmp(entry->d_name + length - suffixLength, MATERIALIZED_SUFFIX) == 0))
+		{
+			names = realloc(names, (*numberOfAggregates + 1) * sizeof(char*));
+			names[*numberOfAggregates] = malloc(length - suffixLength + 1);
+			memcpy(names[*numberOfAggregates], entry->d_name, length - suffixLength);
+			names[*numberOfAggregates][length - suffixLength] = '\0';
+			(*numberOfAggregates)++;
+		}
+	}
+	closedir(directory);
+	return names;
+}
+
+void freeMaterializedAggregateNames(char** names, int numberOfAggregates)
+{
+	for (int i = 0; i < numberOfAggregates; i++)
+		free(names[i]);
+	free(names);
+}
+
+// finds a materialized aggregate with the given definition as of the calling thread's snapshot (any
+// column for groups, if column is NULL, since their counts do not depend on it), filling in its name
+// (room for MATERIALIZED_NAME_LENGTH) and whether its state is up to date with the columns it is over.
+// returns false if there is none
+#define MATERIALIZED_NAME_LENGTH 256
+bool findMaterializedAggregate(int kind, char* column, char* keyColumn, long long low, long long high,
+                               char* name, materializedAggregate* aggregate, bool* current)
+{
+	int numberOfAggregates;
+	char** names = listMaterializedAggregates(&numberOfAggregates);
+	bool found = false;
+	for (int i = 0; (i < numberOfAggregates) && !found; i++)
+	{
+		char fileName[strlen(names[i]) + 5];
+		materializedFileName(names[i], fileName);
+		if ((strlen(names[i]) >= MATERIALIZED_NAME_LENGTH) || !readMaterializedAggregateAt(columnSnapshotPath(fileName), aggregate))
+			continue;
+		materializedDefinition* definition = &aggregate->definition;
+		found = (definition->kind == kind) && ((column == NULL) || (strcmp(definition->column, column) == 0)) &&
+		        ((kind != MATERIALIZED_GROUPS) || (strcmp(definition->keyColumn, keyColumn) == 0)) &&
+		        ((kind != MATERIALIZED_RANGE) || ((definition->low == low) && (definition->high == high)));
+		if (!found)
+		{
+			freeMaterializedAggregate(aggregate);
+			continue;
+		}
+		strcpy(name, names[i]);
+		columnFileStamp columnStamp;
+		columnFileStamp keyStamp;
+		*current = stampColumnPath(columnSnapshotPath(definition->column), &columnStamp) && sameColumnFileStamp(&columnStamp, &definition->columnStamp) &&
+		           ((kind != MATERIALIZED_GROUPS) ||
+		            (stampColumnPath(columnSnapshotPath(keyColumn), &keyStamp) && sameColumnFileStamp(&keyStamp, &definition->keyStamp)));
+	}
+	freeMaterializedAggregateNames(names, numberOfAggregates);
+	return found;
+}
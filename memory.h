@@ -0,0 +1,177 @@
+// size of the chunks a query arena allocates from, and the alignment of its allocations
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+// size classes of the intermediate result pool: powers of 2 from 64 bytes to 64MB.
+// bigger blocks come straight from malloc
+#define POOL_SMALLEST_CLASS 6
+#define POOL_NUMBER_OF_CLASSES 21
+#define POOL_HEADER_SIZE 16
+
+// a chunk of a query arena. data starts ARENA_ALIGNMENT bytes into the chunk
+typedef struct arenaChunk
+{
+	struct arenaChunk* next;
+	size_t size;
+}arenaChunk;
+
+// a bump pointer allocator for memory that only lives as long as one query. everything
+// allocated from it is released at once when the query completes
+typedef struct arena
+{
+	arenaChunk* head;
+	size_t used;                    // bytes used in the head chunk
+}arena;
+
+// allocates memory from an arena
+void* arenaAllocate(arena* queryArena, size_t size)
+{
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	if ((queryArena->head == NULL) || (queryArena->used + size > queryArena->head->size))
+	{
+		size_t chunkSize = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+		arenaChunk* chunk = malloc(ARENA_ALIGNMENT + chunkSize);
+		chunk->next = queryArena->head;
+		chunk->size = chunkSize;
+		queryArena->head = chunk;
+		queryArena->used = 0;
+	}
+	void* memory = (char*)queryArena->head + ARENA_ALIGNMENT + queryArena->used;
+	queryArena->used += size;
+	return memory;
+}
+
+// copies a string into an arena
+char* arenaStringCopy(arena* queryArena, char* string)
+{
+	char* copy = arenaAllocate(queryArena, strlen(string) + 1);
+	strcpy(copy, string);
+	return copy;
+}
+
+// releases everything allocated from an arena. one regular sized chunk is kept for the next query
+void resetArena(arena* queryArena)
+{
+	arenaChunk* kept = NULL;
+	arenaChunk* trav = queryArena->head;
+	while (trav != NULL)
+	{
+		arenaChunk* next = trav->next;
+		if ((kept == NULL) && (trav->size == ARENA_CHUNK_SIZE))
+		{
+			kept = trav;
+		}
+		else
+		{
+			free(trav);
+		}
+		trav = next;
+	}
+	if (kept != NULL)
+	{
+		kept->next = NULL;
+	}
+	queryArena->head = kept;
+	queryArena->used = 0;
+}
+
+// frees every chunk of an arena
+void destroyArena(arena* queryArena)
+{
+	resetArena(queryArena);
+	free(queryArena->head);
+	queryArena->head = NULL;
+}
+
+// a free list of pooled blocks of one size class
+typedef struct poolClass
+{
+	void* freeBlocks;
+	pthread_mutex_t lock;
+}poolClass;
+poolClass poolClasses[POOL_NUMBER_OF_CLASSES];
+pthread_once_t poolInitialized = PTHREAD_ONCE_INIT;
+
+// sets up the locks of the pool
+void initializePool(void)
+{
+	for (int i = 0; i < POOL_NUMBER_OF_CLASSES; i++)
+	{
+		poolClasses[i].freeBlocks = NULL;
+		pthread_mutex_init(&poolClasses[i].lock, NULL);
+	}
+}
+
+// returns the size class of an allocation, or POOL_NUMBER_OF_CLASSES if it is too big to pool
+int poolClassOf(size_t size)
+{
+	int sizeClass = 0;
+	while ((sizeClass < POOL_NUMBER_OF_CLASSES) && (((size_t)1 << (sizeClass + POOL_SMALLEST_CLASS)) < size))
+	{
+		sizeClass++;
+	}
+	return sizeClass;
+}
+
+// allocates memory for a long lived intermediate result. blocks are recycled through per size class
+// free lists, with the size class stored in a header in front of the block
+void* poolAllocate(size_t size)
+{
+	pthread_once(&poolInitialized, initializePool);
+	int sizeClass = poolClassOf(size);
+	char* block = NULL;
+	if (sizeClass < POOL_NUMBER_OF_CLASSES)
+	{
+		pthread_mutex_lock(&poolClasses[sizeClass].lock);
+		block = poolClasses[sizeClass].freeBlocks;
+		if (block != NULL)
+		{
+			poolClasses[sizeClass].freeBlocks = *(void**)(block + POOL_HEADER_SIZE);
+		}
+		pthread_mutex_unlock(&poolClasses[sizeClass].lock);
+		if (block == NULL)
+		{
+			block = malloc(POOL_HEADER_SIZE + ((size_t)1 << (sizeClass + POOL_SMALLEST_CLASS)));
+		}
+	}
+	else
+	{
+		block = malloc(POOL_HEADER_SIZE + size);
+	}
+	*(int*)block = sizeClass;
+	return block + POOL_HEADER_SIZE;
+}
+
+// returns a block to the pool
+void poolFree(void* memory)
+{
+	if (memory == NULL)
+	{
+		return;
+	}
+	char* block = (char*)memory - POOL_HEADER_SIZE;
+	int sizeClass = *(int*)block;
+	if (sizeClass == POOL_NUMBER_OF_CLASSES)
+	{
+		free(block);
+		return;
+	}
+	pthread_mutex_lock(&poolClasses[sizeClass].lock);
+	*(void**)memory = poolClasses[sizeClass].freeBlocks;
+	poolClasses[sizeClass].freeBlocks = block;
+	pthread_mutex_unlock(&poolClasses[sizeClass].lock);
+}
+
+// shrinks a pooled block to a smaller size class once the final size of a result is known
+void* poolShrink(void* memory, size_t used, size_t size)
+{
+	int sizeClass = *(int*)((char*)memory - POOL_HEADER_SIZE);
+	if (poolClassOf(size) >= sizeClass)
+	{
+		return memory;
+	}
+	void* smaller = poolAllocate(size);
+	memcpy(smaller, memory, used);
+	poolFree(memory);
+	return smaller;
+}
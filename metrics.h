@@ -0,0 +1,198 @@
+// latency histograms have LATENCY_SUB_BUCKETS buckets for every power of 2 microseconds,
+// which bounds the error of a reported percentile to 1/LATENCY_SUB_BUCKETS of its value
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_BUCKETS (32 * LATENCY_SUB_BUCKETS)
+
+// most commands counters are kept for. the last one counts batches
+#define METRICS_MAX_COMMANDS 32
+#define METRICS_BATCH (METRICS_MAX_COMMANDS - 1)
+
+// a thread's counters. only the owning thread writes them, and readers sum the counters of every
+// thread, so recording a metric is a plain (relaxed) store without any locking
+typedef struct threadMetrics
+{
+	long long latencyHistograms[METRICS_MAX_COMMANDS][LATENCY_BUCKETS];
+	long long queries;
+	long long bytesRead;
+	long long rowsScanned;
+	long long rowsSelected;
+	bool owned;                     // false once the owning thread exited, so another thread can take over
+	struct threadMetrics* next;
+}threadMetrics;
+
+// a snapshot of the counters of every thread
+typedef struct metricsSnapshot
+{
+	long long latencyHistograms[METRICS_MAX_COMMANDS][LATENCY_BUCKETS];
+	long long queries;
+	long long bytesRead;
+	long long rowsScanned;
+	long long rowsSelected;
+}metricsSnapshot;
+
+threadMetrics* threadMetricsRoot = NULL;
+pthread_mutex_t threadMetricsLock = PTHREAD_MUTEX_INITIALIZER;
+__thread threadMetrics* currentThreadMetrics = NULL;
+
+// intermediate memory of every session, and when the server started
+long long intermediateMemoryInUse = 0;
+struct timespec serverStartTime;
+
+// returns the counters of the calling thread, on first use taking over the counters of a thread
+// that exited (the counters are totals, so they carry on) or registering new ones
+threadMetrics* getThreadMetrics(void)
+{
+	if (currentThreadMetrics == NULL)
+	{
+		pthread_mutex_lock(&threadMetricsLock);
+		for (threadMetrics* trav = threadMetricsRoot; (trav != NULL) && (currentThreadMetrics == NULL); trav = trav->next)
+		{
+			currentThreadMetrics = trav->owned ? NULL : trav;
+		}
+		if (currentThreadMetrics == NULL)
+		{
+			currentThreadMetrics = calloc(1, sizeof(threadMetrics));
+			currentThreadMetrics->next = threadMetricsRoot;
+			threadMetricsRoot = currentThreadMetrics;
+		}
+		currentThreadMetrics->owned = true;
+		pthread_mutex_unlock(&threadMetricsLock);
+	}
+	return currentThreadMetrics;
+}
+
+// gives up the counters of the calling thread when it exits
+void releaseThreadMetrics(void)
+{
+	if (currentThreadMetrics != NULL)
+	{
+		pthread_mutex_lock(&threadMetricsLock);
+		currentThreadMetrics->owned = false;
+		pthread_mutex_unlock(&threadMetricsLock);
+		currentThreadMetrics = NULL;
+	}
+}
+
+// adds to a counter of the calling thread
+void addToCounter(long long* counter, long long amount)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+// returns the latency bucket of a duration in microseconds
+int latencyBucket(long long microseconds)
+{
+	if (microseconds < LATENCY_SUB_BUCKETS)
+	{
+		return (microseconds < 0) ? 0 : (int)microseconds;
+	}
+	int power = 63 - __builtin_clzll((unsigned long long)microseconds);
+	int subBucket = (int)((microseconds >> (power - 3)) & (LATENCY_SUB_BUCKETS - 1));
+	int bucket = ((power - 2) * LATENCY_SUB_BUCKETS) + subBucket;
+	return (bucket < LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// returns the largest duration in microseconds that falls in a latency bucket
+long long latencyBucketUpperBound(int bucket)
+{
+	if (bucket < LATENCY_SUB_BUCKETS)
+	{
+		return bucket;
+	}
+	int power = (bucket / LATENCY_SUB_BUCKETS) + 2;
+	long long subBucket = bucket % LATENCY_SUB_BUCKETS;
+	return ((LATENCY_SUB_BUCKETS + subBucket + 1) << (power - 3)) - 1;
+}
+
+// records the latency of a command evaluated by the calling thread
+void recordCommandLatency(int command, long long nanoseconds)
+{
+	addToCounter(&getThreadMetrics()->latencyHistograms[command][latencyBucket(nanoseconds / 1000)], 1);
+}
+
+// records a query received by the calling thread
+void recordQuery(void)
+{
+	addToCounter(&getThreadMetrics()->queries, 1);
+}
+
+// records bytes read from column files by the calling thread
+void recordBytesRead(long long bytes)
+{
+	addToCounter(&getThreadMetrics()->bytesRead, bytes);
+	profileBytes(bytes);
+}
+
+// records rows scanned by a select and how many of them were selected
+void recordRowsSelected(long long rowsScanned, long long rowsSelected)
+{
+	threadMetrics* metrics = getThreadMetrics();
+	addToCounter(&metrics->rowsScanned, rowsScanned);
+	addToCounter(&metrics->rowsSelected, rowsSelected);
+	profileRows(rowsScanned, rowsSelected);
+}
+
+// adds to (or, with a negative amount, subtracts from) the intermediate memory of all sessions
+void recordIntermediateMemory(long long bytes)
+{
+	__atomic_fetch_add(&intermediateMemoryInUse, bytes, __ATOMIC_RELAXED);
+}
+
+// sums the counters of every thread
+void takeMetricsSnapshot(metricsSnapshot* snapshot)
+{
+	memset(snapshot, 0, sizeof(metricsSnapshot));
+	pthread_mutex_lock(&threadMetricsLock);
+	for (threadMetrics* trav = threadMetricsRoot; trav != NULL; trav = trav->next)
+	{
+		for (int command = 0; command < METRICS_MAX_COMMANDS; command++)
+		{
+			for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+			{
+				snapshot->latencyHistograms[command][bucket] += __atomic_load_n(&trav->latencyHistograms[command][bucket], __ATOMIC_RELAXED);
+			}
+		}
+		snapshot->queries += __atomic_load_n(&trav->queries, __ATOMIC_RELAXED);
+		snapshot->bytesRead += __atomic_load_n(&trav->bytesRead, __ATOMIC_RELAXED);
+		snapshot->rowsScanned += __atomic_load_n(&trav->rowsScanned, __ATOMIC_RELAXED);
+		snapshot->rowsSelected += __atomic_load_n(&trav->rowsSelected, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&threadMetricsLock);
+}
+
+// returns the number of latencies recorded in a histogram
+long long latencyCount(long long* histogram)
+{
+	long long count = 0;
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		count += histogram[bucket];
+	}
+	return count;
+}
+
+// returns a percentile (0 to 1) of a latency histogram in microseconds
+long long latencyPercentile(long long* histogram, double percentile)
+{
+	long long count = latencyCount(histogram);
+	long long rank = (long long)(percentile * count);
+	rank = (rank >= count) ? count - 1 : rank;
+	long long seen = 0;
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		seen += histogram[bucket];
+		if (seen > rank)
+		{
+			return latencyBucketUpperBound(bucket);
+		}
+	}
+	return 0;
+}
+
+// returns the seconds since the server started
+double serverUptime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - serverStartTime.tv_sec) + ((now.tv_nsec - serverStartTime.tv_nsec) / 1e9);
+}
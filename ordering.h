@@ -0,0 +1,280 @@
+// vectors of at least this many values are ordered in parallel, in a chunk per thread
+#define PARALLEL_ORDERING_VALUES (1 << 16)
+
+// radix sorts go a byte at a time
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// the k largest values seen so far and their positions, as a min-heap whose root is the one that
+// goes first: the smallest value (and of equal values, the last position)
+typedef struct topHeap
+{
+	long long* values;
+	int* positions;
+	int size;
+	int capacity;
+}topHeap;
+
+// returns whether the entry at first would be dropped from the top values before the one at second
+bool topHeapBefore(topHeap* heap, int first, int second)
+{
+	return (heap->values[first] < heap->values[second]) ||
+	       ((heap->values[first] == heap->values[second]) && (heap->positions[first] > heap->positions[second]));
+}
+
+void swapTopHeapEntries(topHeap* heap, int first, int second)
+{
+	long long value = heap->values[first];
+	int position = heap->positions[first];
+	heap->values[first] = heap->values[second];
+	heap->positions[first] = heap->positions[second];
+	heap->values[second] = value;
+	heap->positions[second] = position;
+}
+
+// moves the root down to where it belongs
+void siftDownTopHeap(topHeap* heap)
+{
+	int parent = 0;
+	while (true)
+	{
+		int child = 2 * parent + 1;
+		if (child >= heap->size)
+			return;
+		if ((child + 1 < heap->size) && topHeapBefore(heap, child + 1, child))
+			child++;
+		if (!topHeapBefore(heap, child, parent))
+			return;
+		swapTopHeapEntries(heap, parent, child);
+		parent = child;
+	}
+}
+
+// offers a value to the heap, keeping it if the heap has room or the value beats the root
+void offerTopValue(topHeap* heap, long long value, int position)
+{
+	if (heap->size < heap->capacity)
+	{
+		int child = heap->size++;
+		heap->values[child] = value;
+		heap->positions[child] = position;
+		while ((child > 0) && topHeapBefore(heap, child, (child - 1) / 2))
+		{
+			swapTopHeapEntries(heap, child, (child - 1) / 2);
+			child = (child - 1) / 2;
+		}
+	}
+	else if ((value > heap->values[0]) || ((value == heap->values[0]) && (position < heap->positions[0])))
+	{
+		heap->values[0] = value;
+		heap->positions[0] = position;
+		siftDownTopHeap(heap);
+	}
+}
+
+// collects the largest values in [start, end) of a vector into a heap. once the heap is full a value is
+// only looked at again if it beats the root, which few do, so this runs at close to the speed of a scan.
+// positions only increase, so a value equal to the root never beats it
+#define DEFINE_TOP_KERNEL(name, type, minimum, maximum)                                                    \
+void collectTopValues_##name(void* vector, int start, int end, topHeap* heap)                              \
+{                                                                                                          \
+	type* values = vector;                                                                                 \
+	int i = start;                                                                                         \
+	for (; (i < end) && (heap->size < heap->capacity); i++)                                                \
+	{                                                                                                      \
+		offerTopValue(heap, values[i], i);                                                                 \
+	}                                                                                                      \
+	type threshold = (heap->size > 0) ? (type)heap->values[0] : minimum;                                   \
+	for (; i < end; i++)                                                                                   \
+	{                                                                                                      \
+		if (values[i] > threshold)                                                                         \
+		{                                                                                                  \
+			offerTopValue(heap, values[i], i);                                                             \
+			threshold = (type)heap->values[0];                                                             \
+		}                                                                                                  \
+	}                                                                                                      \
+}
+
+FOR_EACH_COLUMN_TYPE(DEFINE_TOP_KERNEL)
+
+#define TOP_KERNEL(name, type, minimum, maximum) collectTopValues_##name,
+void (*topKernels[NUMBER_OF_COLUMN_TYPES])(void*, int, int, topHeap*) = {FOR_EACH_COLUMN_TYPE(TOP_KERNEL)};
+
+// a chunk of a vector whose largest values a thread collects
+typedef struct topTask
+{
+	void* values;
+	int valueType;
+	int start;
+	int end;
+	topHeap heap;
+}topTask;
+
+void collectTopTask(void* task)
+{
+	topTask* chunk = task;
+	topKernels[chunk->valueType](chunk->values, chunk->start, chunk->end, &chunk->heap);
+}
+
+// writes the k largest values of a vector (k at most numberOfValues) and their positions, largest
+// first (and of equal values, the first position first). large vectors are split into a chunk per
+// thread, each collecting its own k largest, and the heaps are merged at the end
+void selectTopValues(void* values, int valueType, int numberOfValues, int k, long long* topValues, int* topPositions)
+{
+	int numberOfTasks = ((numberOfValues >= PARALLEL_ORDERING_VALUES) && ((long long)k * PARTITION_THREADS <= numberOfValues)) ? PARTITION_THREADS : 1;
+	topTask* tasks = malloc(numberOfTasks * sizeof(topTask));
+	int valuesPerTask = (numberOfValues + numberOfTasks - 1) / numberOfTasks;
+	for (int i = 0; i < numberOfTasks; i++)
+	{
+		tasks[i].values = values;
+		tasks[i].valueType = valueType;
+		tasks[i].start = (i * valuesPerTask < numberOfValues) ? i * valuesPerTask : numberOfValues;
+		tasks[i].end = ((i + 1) * valuesPerTask < numberOfValues) ? (i + 1) * valuesPerTask : numberOfValues;
+		tasks[i].heap.values = malloc(((size_t)k + 1) * sizeof(long long));
+		tasks[i].heap.positions = malloc(((size_t)k + 1) * sizeof(int));
+		tasks[i].heap.size = 0;
+		tasks[i].heap.capacity = k;
+	}
+	runPartitionTasks(collectTopTask, tasks, sizeof(topTask), numberOfTasks);
+
+	// merge the other heaps into the first
+	topHeap* merged = &tasks[0].heap;
+	for (int i = 1; i < numberOfTasks; i++)
+	{
+		for (int j = 0; j < tasks[i].heap.size; j++)
+		{
+			offerTopValue(merged, tasks[i].heap.values[j], tasks[i].heap.positions[j]);
+		}
+		free(tasks[i].heap.values);
+		free(tasks[i].heap.positions);
+	}
+
+	// pop the root (the one that goes first) into the last free slot until the heap is empty
+	for (int i = merged->size - 1; i >= 0; i--)
+	{
+		topValues[i] = merged->values[0];
+		topPositions[i] = merged->positions[0];
+		merged->size--;
+		merged->values[0] = merged->values[merged->size];
+		merged->positions[0] = merged->positions[merged->size];
+		siftDownTopHeap(merged);
+	}
+	free(merged->values);
+	free(merged->positions);
+	free(tasks);
+}
+
+// a chunk of keys a thread counts the digits of, then scatters to where its digits go
+typedef struct radixTask
+{
+	unsigned long long* keys;
+	int* positions;
+	unsigned long long* sortedKeys;
+	int* sortedPositions;
+	int start;
+	int end;
+	int shift;
+	int counts[RADIX_BUCKETS];
+}radixTask;
+
+void countRadixDigits(void* task)
+{
+	radixTask* chunk = task;
+	memset(chunk->counts, 0, sizeof(chunk->counts));
+	for (int i = chunk->start; i < chunk->end; i++)
+	{
+		chunk->counts[(chunk->keys[i] >> chunk->shift) & (RADIX_BUCKETS - 1)]++;
+	}
+}
+
+// scatters the chunk's keys, in order, to the offsets its counts were turned into
+void scatterRadixDigits(void* task)
+{
+	radixTask* chunk = task;
+	for (int i = chunk->start; i < chunk->end; i++)
+	{
+		int destination = chunk->counts[(chunk->keys[i] >> chunk->shift) & (RADIX_BUCKETS - 1)]++;
+		chunk->sortedKeys[destination] = chunk->keys[i];
+		chunk->sortedPositions[destination] = chunk->positions[i];
+	}
+}
+
+// sorts values in place (stably, so equal values keep their order), ascending or descending, and writes
+// the position every sorted value came from. a least significant digit radix sort: every pass counts
+// a byte of the keys in parallel, then each thread scatters its chunk to the offsets of its digits.
+// passes over a byte every key shares (such as the high bytes of narrow types) are skipped
+void radixSortValues(long long* values, int numberOfValues, bool descending, int* sortedPositions)
+{
+	// flip the sign bit so the keys order as unsigned integers (and every bit for descending)
+	unsigned long long flip = descending ? ~(1ULL << 63) : (1ULL << 63);
+	unsigned long long* keys = (unsigned long long*)values;
+	unsigned long long* otherKeys = malloc(((size_t)numberOfValues + 1) * sizeof(unsigned long long));
+	int* positions = sortedPositions;
+	int* otherPositions = malloc(((size_t)numberOfValues + 1) * sizeof(int));
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		keys[i] ^= flip;
+		positions[i] = i;
+	}
+
+	int numberOfTasks = (numberOfValues >= PARALLEL_ORDERING_VALUES) ? PARTITION_THREADS : 1;
+	radixTask* tasks = malloc(numberOfTasks * sizeof(radixTask));
+	int valuesPerTask = (numberOfValues + numberOfTasks - 1) / numberOfTasks;
+	for (int shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		for (int i = 0; i < numberOfTasks; i++)
+		{
+			tasks[i].keys = keys;
+			tasks[i].positions = positions;
+			tasks[i].sortedKeys = otherKeys;
+			tasks[i].sortedPositions = otherPositions;
+			tasks[i].start = (i * valuesPerTask < numberOfValues) ? i * valuesPerTask : numberOfValues;
+			tasks[i].end = ((i + 1) * valuesPerTask < numberOfValues) ? (i + 1) * valuesPerTask : numberOfValues;
+			tasks[i].shift = shift;
+		}
+		runPartitionTasks(countRadixDigits, tasks, sizeof(radixTask), numberOfTasks);
+
+		// a digit's keys go after those of smaller digits, and a chunk's after those of earlier chunks
+		int offset = 0;
+		bool sharedDigit = false;
+		for (int digit = 0; digit < RADIX_BUCKETS; digit++)
+		{
+			int digitStart = offset;
+			for (int i = 0; i < numberOfTasks; i++)
+			{
+				int count = tasks[i].counts[digit];
+				tasks[i].counts[digit] = offset;
+				offset += count;
+			}
+			sharedDigit |= (offset - digitStart == numberOfValues);
+		}
+		if (sharedDigit)
+			continue;
+		runPartitionTasks(scatterRadixDigits, tasks, sizeof(radixTask), numberOfTasks);
+		unsigned long long* swappedKeys = keys;
+		keys = otherKeys;
+		otherKeys = swappedKeys;
+		int* swappedPositions = positions;
+		positions = otherPositions;
+		otherPositions = swappedPositions;
+	}
+	free(tasks);
+
+	// an odd number of passes leaves the sorted keys in the scratch arrays
+	if (keys != (unsigned long long*)values)
+	{
+		memcpy(values, keys, numberOfValues * sizeof(long long));
+		memcpy(sortedPositions, positions, numberOfValues * sizeof(int));
+		free(keys);
+		free(positions);
+	}
+	else
+	{
+		free(otherKeys);
+		free(otherPositions);
+	}
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		values[i] = (long long)(((unsigned long long)values[i]) ^ flip);
+	}
+}
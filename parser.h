@@ -0,0 +1,276 @@
+// most arguments a command can take
+#define MAX_QUERY_ARGUMENTS 8
+
+// number of slots in the command dispatch table (must be a power of 2)
+#define COMMAND_TABLE_SLOTS 128
+
+// placeholder for a parameter of a prepared statement
+#define PARAMETER_PLACEHOLDER "?"
+
+struct parsedQuery;
+
+// a command of the query language and the operator that evaluates it
+typedef struct commandDefinition
+{
+	char* name;
+	void (*function)(int connectionfd, struct parsedQuery* query);
+	bool storesResult;              // true if the command must assign to a variable, e.g. s=select(...)
+}commandDefinition;
+
+// a query split into its output variable, command, and arguments. the strings point into the
+// query, which the tokenizer splits in place
+typedef struct parsedQuery
+{
+	char* outputVariable;           // NULL if the query does not assign to a variable
+	char* commandName;
+	commandDefinition* command;     // NULL if the command does not exist
+	char* arguments[MAX_QUERY_ARGUMENTS];
+	int numberOfArguments;
+}parsedQuery;
+
+// a statement prepared once and executed many times with different parameters
+typedef struct preparedStatement
+{
+	char* name;
+	char* text;                     // the statement, which the parsed statement points into
+	parsedQuery statement;
+	int parameters[MAX_QUERY_ARGUMENTS + 1];    // argument bound to each parameter, -1 for the output variable
+	int numberOfParameters;
+	struct preparedStatement* next;
+}preparedStatement;
+
+// the command dispatch table is a perfect hash table: the seed is chosen when the table is built
+// so that no two commands share a slot, and a lookup is one hash and one string comparison
+commandDefinition* commandTable[COMMAND_TABLE_SLOTS];
+unsigned int commandTableSeed = 0;
+
+// hashes a command name with a seed (FNV-1a)
+unsigned int hashCommandName(char* commandName, unsigned int seed)
+{
+	unsigned int hash = 2166136261u ^ seed;
+	for (unsigned char* c = (unsigned char*)commandName; *c != '\0'; c++)
+	{
+		hash = (hash ^ *c) * 16777619u;
+	}
+	return hash;
+}
+
+// builds the command dispatch table, trying seeds until every command has a slot of its own
+void buildCommandTable(commandDefinition* commands, int numberOfCommands)
+{
+	for (unsigned int seed = 0; ; seed++)
+	{
+		memset(commandTable, 0, sizeof(commandTable));
+		int i = 0;
+		while (i < numberOfCommands)
+		{
+			unsigned int slot = hashCommandName(commands[i].name, seed) & (COMMAND_TABLE_SLOTS - 1);
+			if (commandTable[slot] != NULL)
+			{
+				break;
+			}
+			commandTable[slot] = &commands[i++];
+		}
+		if (i == numberOfCommands)
+		{
+			commandTableSeed = seed;
+			return;
+		}
+	}
+}
+
+// finds a command by name, NULL if it does not exist
+commandDefinition* findCommand(char* commandName)
+{
+	commandDefinition* command = commandTable[hashCommandName(commandName, commandTableSeed) & (COMMAND_TABLE_SLOTS - 1)];
+	return ((command != NULL) && (strcmp(command->name, commandName) == 0)) ? command : NULL;
+}
+
+// strips the spaces and a pair of surrounding quotes from the token between start and end, in place
+char* trimToken(char* start, char* end)
+{
+	while ((start < end) && (*start == ' '))
+		start++;
+	while ((end > start) && (end[-1] == ' '))
+		end--;
+	if ((end - start >= 2) && (*start == '"') && (end[-1] == '"'))
+	{
+		start++;
+		end--;
+	}
+	*end = '\0';
+	return start;
+}
+
+// splits a query of the form [variable=]command(argument,...) in a single pass. arguments are
+// split at top level commas only, so an argument may itself be a query. returns false if the
+// query is malformed
+bool tokenizeQuery(char* query, parsedQuery* parsed)
+{
+	memset(parsed, 0, sizeof(parsedQuery));
+
+	// output variable and command name
+	char* cursor = query;
+	while ((*cursor != '\0') && (*cursor != '=') && (*cursor != '('))
+		cursor++;
+	if (*cursor == '=')
+	{
+		parsed->outputVariable = trimToken(query, cursor);
+		query = ++cursor;
+		while ((*cursor != '\0') && (*cursor != '('))
+			cursor++;
+	}
+	if ((*cursor == '\0') && (parsed->outputVariable == NULL))
+	{
+		// a command without arguments may leave out the parentheses, e.g. stats
+		parsed->commandName = trimToken(query, cursor);
+		parsed->command = findCommand(parsed->commandName);
+		return true;
+	}
+	else if (*cursor != '(')
+	{
+		return false;
+	}
+	parsed->commandName = trimToken(query, cursor);
+	parsed->command = findCommand(parsed->commandName);
+
+	// arguments, up to the closing parenthesis
+	char* argumentStart = ++cursor;
+	int depth = 0;
+	bool quoted = false;
+	for ( ; *cursor != '\0'; cursor++)
+	{
+		if (*cursor == '"')
+			quoted = !quoted;
+		if (quoted || (*cursor == '"'))
+			continue;
+		if (*cursor == '(')
+			depth++;
+		else if ((*cursor == ')') && (depth > 0))
+			depth--;
+		else if (((*cursor == ',') || (*cursor == ')')) && (depth == 0))
+		{
+			bool closing = (*cursor == ')');
+			char* argument = trimToken(argumentStart, cursor);
+			if ((*argument != '\0') || !closing || (parsed->numberOfArguments > 0))
+			{
+				if (parsed->numberOfArguments == MAX_QUERY_ARGUMENTS)
+				{
+					return false;
+				}
+				parsed->arguments[parsed->numberOfArguments++] = argument;
+			}
+			if (closing)
+			{
+				return true;
+			}
+			argumentStart = cursor + 1;
+		}
+	}
+	return false;
+}
+
+// returns the ';' that ends the first statement of a batch (the first one outside of any quotes and
+// parentheses), or the end of the query if it is a single statement
+char* findStatementEnd(char* query)
+{
+	int depth = 0;
+	bool quoted = false;
+	char* cursor = query;
+	for ( ; *cursor != '\0'; cursor++)
+	{
+		if (*cursor == '"')
+			quoted = !quoted;
+		else if (!quoted && (*cursor == '('))
+			depth++;
+		else if (!quoted && (*cursor == ')'))
+			depth--;
+		else if (!quoted && (*cursor == ';') && (depth <= 0))
+			return cursor;
+	}
+	return cursor;
+}
+
+// returns true if a query is a batch of statements, i.e. has a ';' outside of any parentheses
+bool isBatch(char* query)
+{
+	return *findStatementEnd(query) == ';';
+}
+
+// returns an argument of a query, NULL if the query has fewer arguments
+char* queryArgument(parsedQuery* query, int index)
+{
+	return (index < query->numberOfArguments) ? query->arguments[index] : NULL;
+}
+
+// finds a prepared statement by name, NULL if it does not exist
+preparedStatement* findPreparedStatement(preparedStatement* preparedStatements, char* name)
+{
+	while ((preparedStatements != NULL) && (strcmp(name, preparedStatements->name) != 0))
+	{
+		preparedStatements = preparedStatements->next;
+	}
+	return preparedStatements;
+}
+
+// tokenizes a statement once for repeated execution, recording which of its output variable and
+// arguments are parameters. returns NULL if the statement is malformed
+preparedStatement* createPreparedStatement(char* name, char* text)
+{
+	preparedStatement* prepared = calloc(1, sizeof(preparedStatement));
+	prepared->name = malloc(strlen(name) + 1);
+	strcpy(prepared->name, name);
+	prepared->text = malloc(strlen(text) + 1);
+	strcpy(prepared->text, text);
+	if (!tokenizeQuery(prepared->text, &prepared->statement) || (prepared->statement.command == NULL))
+	{
+		free(prepared->name);
+		free(prepared->text);
+		free(prepared);
+		return NULL;
+	}
+	if ((prepared->statement.outputVariable != NULL) && (strcmp(prepared->statement.outputVariable, PARAMETER_PLACEHOLDER) == 0))
+	{
+		prepared->parameters[prepared->numberOfParameters++] = -1;
+	}
+	for (int i = 0; i < prepared->statement.numberOfArguments; i++)
+	{
+		if (strcmp(prepared->statement.arguments[i], PARAMETER_PLACEHOLDER) == 0)
+		{
+			prepared->parameters[prepared->numberOfParameters++] = i;
+		}
+	}
+	return prepared;
+}
+
+// binds values to the parameters of a prepared statement, in order. returns false if the
+// number of values does not match the number of parameters
+bool bindPreparedStatement(preparedStatement* prepared, char** values, int numberOfValues, parsedQuery* bound)
+{
+	if (numberOfValues != prepared->numberOfParameters)
+	{
+		return false;
+	}
+	*bound = prepared->statement;
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		if (prepared->parameters[i] == -1)
+			bound->outputVariable = values[i];
+		else
+			bound->arguments[prepared->parameters[i]] = values[i];
+	}
+	return true;
+}
+
+// frees a list of prepared statements
+void destroyPreparedStatements(preparedStatement* preparedStatements)
+{
+	while (preparedStatements != NULL)
+	{
+		preparedStatement* next = preparedStatements->next;
+		free(preparedStatements->name);
+		free(preparedStatements->text);
+		free(preparedStatements);
+		preparedStatements = next;
+	}
+}
@@ -0,0 +1,225 @@
+// how a column's rows are split into partitions: not at all, by ranges of a key, or by a hash of it
+#define PARTITION_NONE 0
+#define PARTITION_RANGE 1
+#define PARTITION_HASH 2
+#define MAX_PARTITIONS 64
+#define PARTITION_KEY_LENGTH 64
+
+// set in the storage type of a column file that holds a partition directory instead of values. the
+// values are in one file per partition, db/<column>.part<i>, each an ordinary column file
+#define PARTITIONED_COLUMN (1 << 16)
+
+// partitions are scanned, read, and written by up to this many threads at once
+#define PARTITION_THREADS 8
+
+// what the directory knows about a partition: how many values it holds, and their range (used to
+// prune partitions a predicate cannot match without reading them)
+typedef struct partitionInfo
+{
+	int numberOfValues;
+	long long minimum;
+	long long maximum;
+}partitionInfo;
+
+// the partition directory of a column. rows are routed to partitions by the value of the key column
+// in the same row. a column's positions run through its partitions in order
+typedef struct partitionDirectory
+{
+	int scheme;
+	int numberOfPartitions;
+	char keyColumn[PARTITION_KEY_LENGTH];
+	long long bounds[MAX_PARTITIONS];   // range: partition i holds keys in [bounds[i - 1], bounds[i])
+	partitionInfo partitions[MAX_PARTITIONS];
+}partitionDirectory;
+
+// a partition that holds nothing
+void clearPartitionInfo(partitionInfo* partition)
+{
+	partition->numberOfValues = 0;
+	partition->minimum = LLONG_MAX;
+	partition->maximum = LLONG_MIN;
+}
+
+// reads a partitioning spec, range(key,bound,...) with increasing bounds or hash(key,buckets), into
+// an empty directory. the spec is split in place. returns false if it is malformed
+bool parsePartitionSpec(char* spec, partitionDirectory* directory)
+{
+	parsedQuery parsed;
+	memset(directory, 0, sizeof(partitionDirectory));
+	if (!tokenizeQuery(spec, &parsed) || (parsed.outputVariable != NULL) || (parsed.numberOfArguments < 2) ||
+	    (strlen(parsed.arguments[0]) >= PARTITION_KEY_LENGTH))
+	{
+		return false;
+	}
+	strcpy(directory->keyColumn, parsed.arguments[0]);
+	if (strcmp(parsed.commandName, "range") == 0)
+	{
+		directory->scheme = PARTITION_RANGE;
+		directory->numberOfPartitions = parsed.numberOfArguments;
+		for (int i = 1; i < parsed.numberOfArguments; i++)
+		{
+			directory->bounds[i - 1] = atoll(parsed.arguments[i]);
+			if ((i > 1) && (directory->bounds[i - 1] <= directory->bounds[i - 2]))
+				return false;
+		}
+		directory->bounds[directory->numberOfPartitions - 1] = LLONG_MAX;
+	}
+	else if ((strcmp(parsed.commandName, "hash") == 0) && (parsed.numberOfArguments == 2))
+	{
+		directory->scheme = PARTITION_HASH;
+		directory->numberOfPartitions = atoi(parsed.arguments[1]);
+		if ((directory->numberOfPartitions < 1) || (directory->numberOfPartitions > MAX_PARTITIONS))
+			return false;
+	}
+	else
+	{
+		return false;
+	}
+	for (int i = 0; i < directory->numberOfPartitions; i++)
+	{
+		clearPartitionInfo(&directory->partitions[i]);
+	}
+	return true;
+}
+
+// returns whether two directories split rows the same way, so their columns' positions line up
+bool samePartitioning(partitionDirectory* first, partitionDirectory* second)
+{
+	return (first->scheme == second->scheme) && (first->numberOfPartitions == second->numberOfPartitions) &&
+	       (strcmp(first->keyColumn, second->keyColumn) == 0) &&
+	       (memcmp(first->bounds, second->bounds, first->numberOfPartitions * sizeof(long long)) == 0);
+}
+
+// returns the partition a row with the given key belongs to
+int partitionOfKey(partitionDirectory* directory, long long key)
+{
+	if (directory->scheme == PARTITION_HASH)
+	{
+		return (int)((((unsigned long long)key * 0x9E3779B97F4A7C15ULL) >> 32) % directory->numberOfPartitions);
+	}
+	int partition = 0;
+	while ((partition + 1 < directory->numberOfPartitions) && (key >= directory->bounds[partition]))
+	{
+		partition++;
+	}
+	return partition;
+}
+
+// returns whether a partition of a column may hold values in [low, high]. a partition is pruned if it
+// is empty, if its range of values misses the predicate, or (for a predicate on the key itself) if
+// the predicate's keys are routed elsewhere
+bool partitionMayMatch(partitionDirectory* directory, char* columnName, int partition, long long low, long long high)
+{
+	partitionInfo* info = &directory->partitions[partition];
+	if ((info->numberOfValues == 0) || (info->maximum < low) || (info->minimum > high))
+	{
+		return false;
+	}
+	if (strcmp(directory->keyColumn, columnName) != 0)
+	{
+		return true;
+	}
+	else if (directory->scheme == PARTITION_RANGE)
+	{
+		long long first = (partition == 0) ? LLONG_MIN : directory->bounds[partition - 1];
+		bool last = (partition + 1 == directory->numberOfPartitions);
+		return (high >= first) && (last || (low < directory->bounds[partition]));
+	}
+	return (low != high) || (partitionOfKey(directory, low) == partition);
+}
+
+// writes the name a partition of a column is stored under (room for strlen(columnName) + 16)
+void partitionColumnName(char* columnName, int partition, char* name)
+{
+	sprintf(name, "%s.part%d", columnName, partition);
+}
+
+// reads the partition directory in the column file at path (directory may be NULL to only ask).
+// returns false if the column is not partitioned or path is NULL
+bool readPartitionDirectoryAt(char* path, partitionDirectory* directory)
+{
+	FILE* fp = (path == NULL) ? NULL : fopen(path, "rb");
+	if (fp == NULL)
+	{
+		return false;
+	}
+	int headerStorageType = 0;
+	int headerStorageSize = 0;
+	partitionDirectory read;
+	bool partitioned = (fread(&headerStorageType, sizeof(int), 1, fp) == 1) && (fread(&headerStorageSize, sizeof(int), 1, fp) == 1) &&
+	                   ((headerStorageType & PARTITIONED_COLUMN) != 0) && (headerStorageSize == sizeof(partitionDirectory)) &&
+	                   (fread(&read, sizeof(partitionDirectory), 1, fp) == 1);
+	fclose(fp);
+	if (partitioned && (directory != NULL))
+	{
+		*directory = read;
+	}
+	return partitioned;
+}
+
+// reads the partition directory of a column as of the calling thread's snapshot
+bool readPartitionDirectory(char* columnName, partitionDirectory* directory)
+{
+	return readPartitionDirectoryAt(columnSnapshotPath(columnName), directory);
+}
+
+// returns the position of the first value of every partition, and the number of values of the column
+int partitionOffsets(partitionDirectory* directory, int* offsets)
+{
+	int total = 0;
+	for (int i = 0; i < directory->numberOfPartitions; i++)
+	{
+		offsets[i] = total;
+		total += directory->partitions[i].numberOfValues;
+	}
+	return total;
+}
+
+// tasks over partitions handed out to threads, each task an element of an array
+typedef struct partitionTaskQueue
+{
+	void (*run)(void* task);
+	char* tasks;
+	size_t taskSize;
+	int numberOfTasks;
+	int nextTask;
+}partitionTaskQueue;
+
+// a thread running tasks off the queue until none are left
+void* partitionWorker(void* arguments)
+{
+	partitionTaskQueue* queue = arguments;
+	int task;
+	while ((task = __atomic_fetch_add(&queue->nextTask, 1, __ATOMIC_RELAXED)) < queue->numberOfTasks)
+	{
+		queue->run(queue->tasks + (task * queue->taskSize));
+	}
+	releaseIoRing();
+	return NULL;
+}
+
+// runs a task per partition on up to PARTITION_THREADS threads and waits for all of them. tasks must
+// not use the calling thread's state (its snapshot, session, or profile), so they are given paths
+// resolved in the caller's snapshot
+void runPartitionTasks(void (*run)(void* task), void* tasks, size_t taskSize, int numberOfTasks)
+{
+	partitionTaskQueue queue = {run, tasks, taskSize, numberOfTasks, 0};
+	int numberOfThreads = (numberOfTasks < PARTITION_THREADS) ? numberOfTasks : PARTITION_THREADS;
+	pthread_t threads[PARTITION_THREADS];
+	int started = 0;
+	for (int i = 1; i < numberOfThreads; i++)
+	{
+		started += (pthread_create(&threads[started], NULL, partitionWorker, &queue) == 0);
+	}
+
+	// the calling thread works through the queue as well (and alone if no thread could be started)
+	int task;
+	while ((task = __atomic_fetch_add(&queue.nextTask, 1, __ATOMIC_RELAXED)) < numberOfTasks)
+	{
+		run(queue.tasks + (task * taskSize));
+	}
+	for (int i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+}
@@ -0,0 +1,118 @@
+// phases of a profiled query. whatever is not accounted to one of these is execution
+#define PROFILE_PARSE 0
+#define PROFILE_IO 1
+#define PROFILE_RESPONSE 2
+#define PROFILE_PHASES 3
+
+// hardware counters read while a query is profiled
+#define PROFILE_COUNTERS 4
+
+// a struct for storing the profile of a query as it is evaluated
+typedef struct queryProfile
+{
+	long long phaseNanoseconds[PROFILE_PHASES];
+	long long totalNanoseconds;
+	long long bytesTouched;
+	long long rowsIn;
+	long long rowsOut;
+	bool countersAvailable;         // false if perf_event_open is not permitted or not supported
+	int counterfds[PROFILE_COUNTERS];
+	long long counters[PROFILE_COUNTERS];
+}queryProfile;
+
+// the profile of the query the calling thread is evaluating, NULL if it is not being profiled
+__thread queryProfile* currentQueryProfile = NULL;
+
+// names of the phases in traces
+char* profilePhaseNames[PROFILE_PHASES] = {"parse", "io", "response"};
+
+// names and perf_event_open configurations of the hardware counters
+char* profileCounterNames[PROFILE_COUNTERS] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+unsigned long long profileCounterConfigs[PROFILE_COUNTERS] =
+	{PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+// starts timing a phase. the clock is only read if the query is being profiled or traced
+long long profileStart(void)
+{
+	return ((currentQueryProfile != NULL) || tracingEnabled) ? monotonicNanoseconds() : 0;
+}
+
+// accounts the time since profileStart() to a phase, and traces it
+void profileEnd(int phase, long long start)
+{
+	if ((currentQueryProfile != NULL) && (start != 0))
+	{
+		currentQueryProfile->phaseNanoseconds[phase] += monotonicNanoseconds() - start;
+	}
+	traceEnd(profilePhaseNames[phase], "phase", start, NULL, 0);
+}
+
+// accounts bytes read or written
+void profileBytes(long long bytes)
+{
+	if (currentQueryProfile != NULL)
+	{
+		currentQueryProfile->bytesTouched += bytes;
+	}
+}
+
+// accounts rows consumed and produced by an operator
+void profileRows(long long rowsIn, long long rowsOut)
+{
+	if (currentQueryProfile != NULL)
+	{
+		currentQueryProfile->rowsIn += rowsIn;
+		currentQueryProfile->rowsOut += rowsOut;
+	}
+}
+
+// opens and starts the hardware counters of the calling thread as one group (user space only, so
+// they are permitted without privileges where perf_event_paranoid allows it)
+void startPerformanceCounters(queryProfile* profile)
+{
+	profile->countersAvailable = true;
+	for (int i = 0; i < PROFILE_COUNTERS; i++)
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = profileCounterConfigs[i];
+		attributes.disabled = (i == 0);
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP;
+		profile->counterfds[i] = syscall(SYS_perf_event_open, &attributes, 0, -1, (i == 0) ? -1 : profile->counterfds[0], 0);
+		if (profile->counterfds[i] < 0)
+		{
+			for (int j = 0; j < i; j++)
+			{
+				close(profile->counterfds[j]);
+			}
+			profile->countersAvailable = false;
+			return;
+		}
+	}
+	ioctl(profile->counterfds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(profile->counterfds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// stops the hardware counters and reads them
+void stopPerformanceCounters(queryProfile* profile)
+{
+	if (!profile->countersAvailable)
+	{
+		return;
+	}
+	ioctl(profile->counterfds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	unsigned long long values[PROFILE_COUNTERS + 1];
+	if (read(profile->counterfds[0], values, sizeof(values)) != sizeof(values))
+	{
+		profile->countersAvailable = false;
+	}
+	for (int i = 0; i < PROFILE_COUNTERS; i++)
+	{
+		profile->counters[i] = values[i + 1];
+		close(profile->counterfds[i]);
+	}
+}
@@ -0,0 +1,56 @@
+// a response is normally a NUL-terminated string preceded by its length. a length of
+// BINARY_RESPONSE instead announces a binary result: a binaryResultHeader followed by the raw
+// values, which the client decodes (and renders as text if it wants to) as they arrive
+#define BINARY_RESPONSE -1
+
+// a length of BINARY_DESCRIPTOR_RESPONSE announces a binary result whose header arrives with a
+// file descriptor attached (SCM_RIGHTS, Unix domain sockets only). the values are in the file
+// from the header's offset on, and the client maps them instead of receiving them
+#define BINARY_DESCRIPTOR_RESPONSE -2
+
+// a length of BINARY_COMPRESSED_RESPONSE announces a binary result whose header is followed by its
+// values in compressed frames (see compression.h). it is only sent to clients that asked for it
+// with COMPRESS_QUERY, and only for results large enough to be worth it
+#define BINARY_COMPRESSED_RESPONSE -3
+#define COMPRESS_QUERY "compress(on)"
+
+// kinds of binary results
+#define BINARY_POSITIONS 1
+#define BINARY_VALUES 2
+
+// the query option that asks for a binary result, e.g. print(v,binary)
+#define BINARY_OPTION "binary"
+
+// describes the values of a binary result
+typedef struct binaryResultHeader
+{
+	int resultType;
+	int valueSize;                  // bytes per value
+	long long numberOfValues;
+	long long offset;               // where the values start in a passed file descriptor
+}binaryResultHeader;
+
+// receives the header of a binary result and the file descriptor passed along with it, if any
+// (-1 otherwise). returns false if the connection closed
+bool receiveBinaryResultHeader(int socketfd, binaryResultHeader* header, int* fd)
+{
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec part = {header, sizeof(binaryResultHeader)};
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &part;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	*fd = -1;
+	if (recvmsg(socketfd, &message, MSG_WAITALL) != sizeof(binaryResultHeader))
+	{
+		return false;
+	}
+	struct cmsghdr* descriptor = CMSG_FIRSTHDR(&message);
+	if ((descriptor != NULL) && (descriptor->cmsg_level == SOL_SOCKET) && (descriptor->cmsg_type == SCM_RIGHTS))
+	{
+		memcpy(fd, CMSG_DATA(descriptor), sizeof(int));
+	}
+	return true;
+}
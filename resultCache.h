@@ -0,0 +1,174 @@
+// memory budget of the select result cache, and the largest result worth caching
+#define RESULT_CACHE_BUDGET (64 * 1024 * 1024)
+#define RESULT_CACHE_MAX_ENTRY (RESULT_CACHE_BUDGET / 4)
+
+// a struct for storing the result of a select over a column, with the values at each position
+// so narrower selects can be answered by refining it
+typedef struct cachedResult
+{
+	char* columnName;
+	unsigned long long columnVersion;   // the version of the column's segment the result was computed on
+	int low;
+	int high;
+	int* positions;
+	int* values;
+	int numberOfPositions;
+	size_t bytes;
+	struct cachedResult* previous;
+	struct cachedResult* next;
+}cachedResult;
+
+// the cache is kept in least recently used order (most recently used first)
+cachedResult* cachedResultHead = NULL;
+cachedResult* cachedResultTail = NULL;
+size_t resultCacheBytes = 0;
+long long resultCacheHits = 0;
+long long resultCacheMisses = 0;
+pthread_mutex_t resultCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+// unlinks and frees a cached result (the cache lock must be held)
+void evictCachedResult(cachedResult* entry)
+{
+	if (entry->previous != NULL)
+		entry->previous->next = entry->next;
+	else
+		cachedResultHead = entry->next;
+	if (entry->next != NULL)
+		entry->next->previous = entry->previous;
+	else
+		cachedResultTail = entry->previous;
+	resultCacheBytes -= entry->bytes;
+	free(entry->columnName);
+	free(entry->positions);
+	free(entry->values);
+	free(entry);
+}
+
+// is called whenever a column's data changes (create, load, insert, delete). drops every cached
+// result computed from it (results are keyed on the column's segment version, so those computed on
+// an older segment are never used, this only frees them)
+void invalidateColumnInResultCache(char* columnName)
+{
+	pthread_mutex_lock(&resultCacheLock);
+	cachedResult* trav = cachedResultHead;
+	while (trav != NULL)
+	{
+		cachedResult* next = trav->next;
+		if (strcmp(columnName, trav->columnName) == 0)
+		{
+			evictCachedResult(trav);
+		}
+		trav = next;
+	}
+	pthread_mutex_unlock(&resultCacheLock);
+}
+
+// answers a select over [low, high] against the given version of a column from the cache. an exact
+// match is copied, otherwise the smallest cached result over a wider range is refined into a pooled
+// array. returns NULL on a miss
+int* lookupResultCache(char* columnName, unsigned long long version, int low, int high, int* numberOfPositions)
+{
+	pthread_mutex_lock(&resultCacheLock);
+	cachedResult* best = NULL;
+	for (cachedResult* trav = cachedResultHead; trav != NULL; trav = trav->next)
+	{
+		if ((trav->columnVersion != version) || (trav->low > low) || (trav->high < high) || (strcmp(columnName, trav->columnName) != 0))
+		{
+			continue;
+		}
+		if ((best == NULL) || (trav->numberOfPositions < best->numberOfPositions))
+		{
+			best = trav;
+		}
+		if ((trav->low == low) && (trav->high == high))
+		{
+			best = trav;
+			break;
+		}
+	}
+	if (best == NULL)
+	{
+		resultCacheMisses++;
+		pthread_mutex_unlock(&resultCacheLock);
+		return NULL;
+	}
+
+	// copy or refine the cached positions
+	int* positions = poolAllocate((best->numberOfPositions + 1) * sizeof(int));
+	if ((best->low == low) && (best->high == high))
+	{
+		memcpy(positions, best->positions, best->numberOfPositions * sizeof(int));
+		*numberOfPositions = best->numberOfPositions;
+	}
+	else
+	{
+		int count = 0;
+		for (int i = 0; i < best->numberOfPositions; i++)
+		{
+			positions[count] = best->positions[i];
+			count += (best->values[i] >= low) & (best->values[i] <= high);
+		}
+		*numberOfPositions = count;
+	}
+
+	// move the entry to the front of the list
+	if (best != cachedResultHead)
+	{
+		best->previous->next = best->next;
+		if (best->next != NULL)
+			best->next->previous = best->previous;
+		else
+			cachedResultTail = best->previous;
+		best->previous = NULL;
+		best->next = cachedResultHead;
+		cachedResultHead->previous = best;
+		cachedResultHead = best;
+	}
+	resultCacheHits++;
+	pthread_mutex_unlock(&resultCacheLock);
+	return positions;
+}
+
+// caches the result of a select computed against the given version of a column. the positions are
+// copied and the cache takes ownership of the values (which are freed if the result is not cached)
+void insertIntoResultCache(char* columnName, unsigned long long version, int low, int high, int* positions, int* values, int numberOfPositions)
+{
+	size_t bytes = sizeof(cachedResult) + strlen(columnName) + 1 + (2 * (size_t)numberOfPositions * sizeof(int));
+	pthread_mutex_lock(&resultCacheLock);
+
+	// results computed against an old version of the column, or too big, are not cached
+	if ((bytes > RESULT_CACHE_MAX_ENTRY) || (newestColumnVersion(columnName) != version))
+	{
+		pthread_mutex_unlock(&resultCacheLock);
+		free(values);
+		return;
+	}
+
+	// evict least recently used results until the new one fits
+	while ((cachedResultTail != NULL) && (resultCacheBytes + bytes > RESULT_CACHE_BUDGET))
+	{
+		evictCachedResult(cachedResultTail);
+	}
+
+	// insert the result at the front of the list
+	cachedResult* entry = malloc(sizeof(cachedResult));
+	entry->columnName = malloc(strlen(columnName) + 1);
+	strcpy(entry->columnName, columnName);
+	entry->columnVersion = version;
+	entry->low = low;
+	entry->high = high;
+	entry->positions = malloc((numberOfPositions + 1) * sizeof(int));
+	memcpy(entry->positions, positions, numberOfPositions * sizeof(int));
+	entry->values = values;
+	entry->numberOfPositions = numberOfPositions;
+	entry->bytes = bytes;
+	entry->previous = NULL;
+	entry->next = cachedResultHead;
+	if (cachedResultHead != NULL)
+		cachedResultHead->previous = entry;
+	else
+		cachedResultTail = entry;
+	cachedResultHead = entry;
+	resultCacheBytes += bytes;
+	pthread_mutex_unlock(&resultCacheLock);
+}
@@ -10,8 +10,66 @@
 #include <arpa/inet.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <linux/perf_event.h>
+#include <linux/io_uring.h>
 
+#include "protocol.h"
+#include "compression.h"
+#include "memory.h"
+#include "parser.h"
+#include "tracing.h"
+#include "profiling.h"
+#include "metrics.h"
+#include "columnIO.h"
+#include "snapshots.h"
+#include "columnTypes.h"
+#include "partitions.h"
+#include "grouping.h"
+#include "ordering.h"
+#include "joining.h"
+#include "sketches.h"
+#include "materialized.h"
 #include "intermediateResults.h"
+#include "cracking.h"
+#include "statistics.h"
+#include "resultCache.h"
+
+// the session of the client whose queries the calling thread is evaluating (every
+// connection is served by a thread of its own)
+__thread session* currentSession = NULL;
+
+// when a batch of queries is being evaluated, responses are collected here and
+// sent to the client as a single message once the batch completes
+__thread char* batchResponse = NULL;
+__thread int batchResponseLength = 0;
+
+// file the server's metrics are periodically appended to (NULL if they are not dumped), and how often
+char* metricsFile = NULL;
+int metricsInterval = 10;
+
+// path of the Unix domain socket the server also listens on (NULL if it only listens on TCP)
+char* socketPath = NULL;
+
+// binary results at least this large are passed to clients on the same host as a file descriptor,
+// which the client maps, instead of being copied through the socket
+#define DESCRIPTOR_PASSING_THRESHOLD (64 * 1024)
+
+// results of at least this many values are compressed for clients that asked for it, and sent as
+// binary results (even if printed as text) so they can be
+#define COMPRESSED_RESPONSE_VALUES 4096
 
 // storage (file) types
 #define STORAGE_TYPES 3
@@ -19,36 +77,233 @@
 #define SORTED 2
 #define BTREE 3
 
+// number of values processed at a time by fused operator chains (sized to stay in cache)
+#define FUSED_CHUNK_SIZE 4096
+
+// a single statement of a batch of queries (statements are separated by ';')
+typedef struct batchStatement
+{
+    parsedQuery query;
+    bool executed;                  // true once evaluated (possibly as part of a fused chain)
+    char* deferredResponse;         // the response of a statement evaluated early, written when the batch reaches it
+    char** temporaryVariables;      // internal variables of a reordered chain, dropped once the statement is evaluated
+    int numberOfTemporaryVariables;
+}batchStatement;
+
+// reading a partition of a column (or scanning it for a select's positions) on a thread of its
+// own, into its region of a result covering the whole column
+typedef struct partitionTask
+{
+    char* path;                     // the partition's file, as of the query's snapshot
+    int valueType;
+    int numberOfValues;
+    int offset;                     // position of the partition's first value in the column
+    void* values;                   // read: where the partition's values go
+    long long low;                  // scan: the predicate, and where the positions go (room for
+    long long high;                 // one per value), and the values at them widened to ints
+    int* positions;                 // (if not NULL)
+    int* selectedValues;
+    int numberOfPositions;
+    bool failed;
+}partitionTask;
+
+// writing a partition of a column being loaded as a new segment, on a thread of its own
+typedef struct partitionWrite
+{
+    char* columnName;               // the partition's name
+    int headerStorageType;
+    void* values;                   // the partition's values, narrowed to the column's type
+    long long* parsedValues;        // and as they were parsed (for the partition's range)
+    int numberOfValues;
+    FILE* fp;                       // the written segment, NULL if it could not be written
+    partitionInfo info;
+}partitionWrite;
+
+// running state of an aggregate (min, max, sum, avg)
+typedef struct aggregateState
+{
+    long long sum;
+    long long min;
+    long long max;
+    int count;
+}aggregateState;
+
 // function prototypes
+void* acceptConnections(void* argument);
+void* serveConnection(void* argument);
 void evaluateCommands(int connectionfd);
+bool receiveFromClient(int connectionfd, void* buffer, size_t length);
 void parseQuery(int connectionfd, char* query);
+void executeParsedQuery(int connectionfd, parsedQuery* query);
 void writeResponseToClient(int connectionfd, char* response);
+bool writeBinaryResponse(int connectionfd, int resultType, void* values, int valueSize, long long numberOfValues);
+bool sendColumnToClient(int connectionfd, FILE* fp, int valueSize, int numberOfValues);
+bool passDescriptorToClient(int connectionfd, int resultType, int fd, long long offset, int valueSize, long long numberOfValues);
+bool writeCompressedResponse(int connectionfd, int resultType, void* values, int valueSize, long long numberOfValues);
+bool writePartsToClient(int connectionfd, struct iovec* parts, int numberOfParts);
 char* createCustomMessage(int connectionfd, char* prefix, char* stringToBeInserted, char* suffix);
-void createOperator(int connectionfd, char* query);
-void selectOperator(int connectionfd, char* query);
-void loadOperator(int connectionfd, char* query);
-void printOperator(int connectionfd, char* query);
+void createOperator(int connectionfd, parsedQuery* query);
+void selectOperator(int connectionfd, parsedQuery* query);
+void loadOperator(int connectionfd, parsedQuery* query);
+void printOperator(int connectionfd, parsedQuery* query);
+void fetchOperator(int connectionfd, parsedQuery* query);
+void crackOperator(int connectionfd, parsedQuery* query);
+void dropOperator(int connectionfd, parsedQuery* query);
+int* scanColumnForPositions(int connectionfd, char* column, char* secondArgument, char* thirdArgument, int* numberOfPositions, int** selectedValues);
+char* selectFilterArgument(parsedQuery* query);
+int* scanColumnWithBloomFilter(int connectionfd, char* column, char* secondArgument, char* thirdArgument, intermediateResult* filterVariable, int* numberOfPositions);
+int* selectFromCrackerColumn(int connectionfd, crackerColumn* cracker, char* column, char* secondArgument, char* thirdArgument, int* numberOfValidPositions, int** selectedValues);
+int* refinePositions(int connectionfd, intermediateResult* positions, char* valuesName, char* thirdArgument, char* fourthArgument, int* numberOfPositions);
+void aggregateOperator(int connectionfd, parsedQuery* query);
+void groupOperator(int connectionfd, parsedQuery* query);
+void topkOperator(int connectionfd, parsedQuery* query);
+void sortOperator(int connectionfd, parsedQuery* query);
+int splitOutputVariables(int connectionfd, char* function, char* outputVariable, char** names, int maximumNames);
+void* readValuesArgument(int connectionfd, char* function, char* name, int* numberOfValues, int* valueType, bool* readColumn);
+void storeOrderedResult(char** outputNames, int numberOfOutputs, long long* values, int* positions, int numberOfValues, int valueType);
+void bloomOperator(int connectionfd, parsedQuery* query);
+void joinOperator(int connectionfd, parsedQuery* query);
+void approxOperator(int connectionfd, parsedQuery* query);
+bool sampleColumnBlocks(int connectionfd, char* column, long long low, long long high, double* sums, double* counts, double* sizes,
+                        int* numberOfSamples, int* numberOfBlocks, int* numberOfValues);
+void materializeOperator(int connectionfd, parsedQuery* query);
+bool computeMaterializedAggregate(int connectionfd, char* function, materializedAggregate* aggregate);
+bool storeMaterializedAggregate(char* name, materializedAggregate* aggregate);
+bool lookupMaterializedAggregate(int kind, char* column, char* keyColumn, long long low, long long high, materializedAggregate* aggregate);
+void refreshMaterializedAggregates(char** columnNames, long long** columnData, int numberOfColumns, int numberOfRows, bool append);
+bool answerChainFromMaterialized(int connectionfd, batchStatement* selectStatement, batchStatement* fetchStatement, batchStatement* aggregateStatement);
+void prepareOperator(int connectionfd, parsedQuery* query);
+void executeOperator(int connectionfd, parsedQuery* query);
+void statsOperator(int connectionfd, parsedQuery* query);
+void profileOperator(int connectionfd, parsedQuery* query);
+void traceOperator(int connectionfd, parsedQuery* query);
+void compressOperator(int connectionfd, parsedQuery* query);
+char* createMetricsReport(void);
+void* dumpMetricsPeriodically(void* arguments);
+void batchOperator(int connectionfd, char* query);
+int findNextReference(batchStatement* statements, int numberOfStatements, int start, char* variableName);
+bool isChainIsolated(batchStatement* statements, int first, int last, batchStatement* selectStatement, batchStatement* fetchStatement,
+                     batchStatement* aggregateStatement);
+void deferBatchResponse(batchStatement* statement, int start);
+void orderConjunctiveSelects(int connectionfd, batchStatement* statements, int numberOfStatements);
+double estimateColumnSelectivity(char* column, int low, int high);
+bool executeFusedChain(int connectionfd, batchStatement* selectStatement, batchStatement* fetchStatement,
+                       batchStatement* aggregateStatement, bool materializePositions, bool materializeValues);
+bool isValidColumnHeader(int headerStorageType);
+FILE* openColumnForReading(int connectionfd, char* function, char* columnName, int* numberOfValues, int* valueType);
+void* readColumnFromDisk(int connectionfd, char* function, char* columnName, int* numberOfValues, int* valueType);
+bool readPartitionFile(char* path, void* values, int numberOfValues, int width);
+void readPartitionTask(void* task);
+void scanPartitionTask(void* task);
+void writePartitionTask(void* task);
+bool readPartitionedColumn(char* columnName, partitionDirectory* directory, int valueType, void* values);
+int* scanPartitionedColumn(int connectionfd, char* column, partitionDirectory* directory, long long low, long long high, int* numberOfPositions, int** selectedValues);
+bool createPartitionedColumn(char* column, int storageId, partitionDirectory* directory);
+bool orderRowsByPartition(int connectionfd, char** columnNames, long long** columnData, int numberOfColumns, int numberOfRows,
+                          partitionDirectory* directories, bool* partitioned, int* partitionStarts);
+bool stagePartitionedColumn(char* column, partitionDirectory* directory, int headerStorageType, void* values, long long* parsedValues, int* partitionStarts);
+void dropPartition(int connectionfd, char* column, char* partitionArgument);
+void initializeAggregateState(aggregateState* state);
+void updateAggregateState(aggregateState* state, void* values, int valueType, int numberOfValues);
+bool storeAggregateResult(int connectionfd, char* function, intermediateResult* variable, char* aggregateName, aggregateState* state);
 void createDatabaseDirectoryIfNotPresent(void);
-int* increaseArraySizeByMultiplier(int connectionfd, int* array, int newArraySize);
+void* increaseArraySizeByMultiplier(int connectionfd, void* array, int newArraySize);
 char* increaseStringSizeByMultiplier(int connectionfd, char* array, int newArraySize);
 
 // for error handling and quitting
 void raiseDatabaseException(int connectionfd, char* function, char* exception, char* exception_info);
 void quit(int connectionfd);
 
+// the commands of the query language, dispatched through a perfect hash table built at startup
+commandDefinition commands[] =
+{
+    {"create", createOperator, false},
+    {"load", loadOperator, false},
+    {"select", selectOperator, true},
+    {"fetch", fetchOperator, true},
+    {"min", aggregateOperator, true},
+    {"max", aggregateOperator, true},
+    {"sum", aggregateOperator, true},
+    {"avg", aggregateOperator, true},
+    {"group", groupOperator, true},
+    {"topk", topkOperator, true},
+    {"sort", sortOperator, true},
+    {"bloom", bloomOperator, true},
+    {"join", joinOperator, true},
+    {"approx", approxOperator, true},
+    {"materialize", materializeOperator, false},
+    {"drop", dropOperator, false},
+    {"crack", crackOperator, false},
+    {"print", printOperator, false},
+    {"prepare", prepareOperator, false},
+    {"execute", executeOperator, false},
+    {"stats", statsOperator, false},
+    {"profile", profileOperator, false},
+    {"trace", traceOperator, false},
+    {"compress", compressOperator, false},
+};
+#define NUMBER_OF_COMMANDS ((int)(sizeof(commands) / sizeof(commandDefinition)))
+
 int main(int argc, char const *argv[])
 {
+    // options
+    clock_gettime(CLOCK_MONOTONIC, &serverStartTime);
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--stats-file") == 0)
+            metricsFile = (char*)argv[i + 1];
+        else if (strcmp(argv[i], "--stats-interval") == 0)
+            metricsInterval = (atoi(argv[i + 1]) > 0) ? atoi(argv[i + 1]) : metricsInterval;
+        else if (strcmp(argv[i], "--trace-file") == 0)
+        {
+            traceFile = (char*)argv[i + 1];
+            tracingEnabled = true;
+        }
+        else if (strcmp(argv[i], "--socket-path") == 0)
+            socketPath = (char*)argv[i + 1];
+    }
+
     // socket setup
     int listenfd = 0;  
-    int connectionfd = 0;    
     struct sockaddr_in serv_addr;
     listenfd = socket(AF_INET, SOCK_STREAM, 0);
     memset(&serv_addr, '0', sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     serv_addr.sin_port = htons(5000); 
-    bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)); 
-    listen(listenfd, 10);
+
+    // a restarted server must be able to listen while connections of the last one are in TIME_WAIT
+    int reuseAddress = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+    if (bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0)
+    {
+        printf("Could not bind to port 5000: %s\n", strerror(errno));
+        return 1;
+    }
+    listen(listenfd, 128);
+
+    // clients on the same host may connect through a Unix domain socket instead
+    int localListenfd = -1;
+    if (socketPath != NULL)
+    {
+        struct sockaddr_un localAddress;
+        memset(&localAddress, 0, sizeof(localAddress));
+        localAddress.sun_family = AF_UNIX;
+        if (strlen(socketPath) >= sizeof(localAddress.sun_path))
+        {
+            printf("The socket path %s is too long.\n", socketPath);
+            return 1;
+        }
+        strcpy(localAddress.sun_path, socketPath);
+        localListenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socketPath);
+        if (bind(localListenfd, (struct sockaddr*)&localAddress, sizeof(localAddress)) < 0)
+        {
+            printf("Could not bind to %s: %s\n", socketPath, strerror(errno));
+            return 1;
+        }
+        listen(localListenfd, 128);
+    }
 
     // clear terminal window (for aesthetics)
     printf("\033[2J");
@@ -58,64 +313,180 @@ int main(int argc, char const *argv[])
     printf("=============================== NickDB - Server ===============================\n");
     printf("Waiting for a client to connect....\n");
 
-    // connect to a client
-    connectionfd = accept(listenfd, (struct sockaddr*)NULL, NULL);
-    if (connectionfd == 0)
+    // create a database directory (on first run only) and set up the command dispatch table
+    createDatabaseDirectoryIfNotPresent();
+    buildCommandTable(commands, NUMBER_OF_COMMANDS);
+
+    // a client disconnecting mid-response must not take down the other connections
+    signal(SIGPIPE, SIG_IGN);
+
+    // dump the server's metrics in the background if asked to
+    if (metricsFile != NULL)
     {
-        printf("An error occurred with STDIN, please try restarting the server.\n");
-        close(connectionfd);
-        exit(1);
+        pthread_t metricsThread;
+        pthread_create(&metricsThread, NULL, dumpMetricsPeriodically, NULL);
+        pthread_detach(metricsThread);
     }
 
-    // create a database directory (on first run only)
-    createDatabaseDirectoryIfNotPresent();
+    // serve every client on a thread of its own, each in its own session
+    if (localListenfd != -1)
+    {
+        pthread_t localAcceptThread;
+        pthread_create(&localAcceptThread, NULL, acceptConnections, &localListenfd);
+        pthread_detach(localAcceptThread);
+    }
+    acceptConnections(&listenfd);
+    return 0;
+}
 
-    // print message and begin evaluating queries from the client
-    printf("Connection received from file descriptor %d.\n", connectionfd);
-    printf("Ready to accept queries from client.\n");
-    printf("=====\n");
+/*
+ *  acceptConnections()
+ *  Accepts connections on a listening socket (TCP or Unix domain) and starts a thread
+ *  to serve each of them. Never returns.
+ */
+void* acceptConnections(void* argument)
+{
+    int listenfd = *(int*)argument;
+    while (1)
+    {
+        // connect to a client
+        int connectionfd = accept(listenfd, (struct sockaddr*)NULL, NULL);
+        if (connectionfd == 0)
+        {
+            printf("An error occurred with STDIN, please try restarting the server.\n");
+            close(connectionfd);
+            exit(1);
+        }
+        else if (connectionfd < 0)
+        {
+            printf("Could not accept a connection: %s\n", strerror(errno));
+            continue;
+        }
+
+        // print message and begin evaluating queries from the client
+        printf("Connection received from file descriptor %d.\n", connectionfd);
+        printf("Ready to accept queries from client.\n");
+        printf("=====\n");
+        int* connection = malloc(sizeof(int));
+        *connection = connectionfd;
+        pthread_t connectionThread;
+        if (pthread_create(&connectionThread, NULL, serveConnection, connection) != 0)
+        {
+            printf("Could not create a thread for the connection, closing it.\n");
+            close(connectionfd);
+            free(connection);
+            continue;
+        }
+        pthread_detach(connectionThread);
+    }
+    return NULL;
+}
+
+/*
+ *  serveConnection()
+ *  Evaluates the queries of one client connection. Runs on a thread of its own.
+ */
+void* serveConnection(void* argument)
+{
+    int connectionfd = *(int*)argument;
+    free(argument);
+    char threadName[32];
+    snprintf(threadName, sizeof(threadName), "connection %d", connectionfd);
+    nameTraceThread(threadName);
+    long long start = traceStart();
     evaluateCommands(connectionfd);
+    traceEnd("connection", "connection", start, "fd", connectionfd);
+    releaseTraceBuffer();
+    releaseThreadMetrics();
+    releaseIoRing();
+    releaseSnapshotSlot();
+    printf("Connection on file descriptor %d closed.\n", connectionfd);
+    return NULL;
 }
 
 /*
  *  evaluateCommands()
- *  Receives queries from the client and evaluates them.
+ *  Receives queries from the client and evaluates them until the client quits or
+ *  disconnects, at which point the session's variables are released.
  */
 void evaluateCommands(int connectionfd)
 {
     // variables
     char* query;
     int num_chars;
-    int bytesReceivedFromClientA = 0;
-    int bytesReceivedFromClientB = 0;
     bool storage = 1;
+    currentSession = createSession(connectionfd);
 
     // receive queries
-    while(1)
+    while (currentSession->active)
     {
         // print message
         printf("Query: ");
         fflush(stdout);
 
-        // get query and its length
-        while ((bytesReceivedFromClientA = recv(connectionfd, &num_chars, sizeof(int), 0)) <= 0);
-        query = malloc(num_chars * sizeof(int));
+        // get query and its length, a closed (or broken) connection ends the session
+        if (!receiveFromClient(connectionfd, &num_chars, sizeof(int)) || (num_chars <= 0))
+        {
+            printf("Client disconnected.\n");
+            break;
+        }
+        query = arenaAllocate(&currentSession->queryArena, (size_t)num_chars + 1);
         write(connectionfd, &storage, sizeof(bool));
-        while ((bytesReceivedFromClientB = recv(connectionfd, query, num_chars, 0)) <= 0);
+        if (!receiveFromClient(connectionfd, query, num_chars))
+        {
+            printf("Client disconnected.\n");
+            break;
+        }
+        query[num_chars] = '\0';
         printf("%s\n", query);
+        recordQuery();
 
-        // parse query and call appropriate operator
+        // parse query and call appropriate operator against a snapshot of the columns, then release
+        // the query's memory
+        long long queryStart = traceStart();
+        beginSnapshot();
         parseQuery(connectionfd, query);
-        usleep(10000);
+        endSnapshot();
+        traceEnd("query", "query", queryStart, "bytes", num_chars);
+        resetArena(&currentSession->queryArena);
 
         // aesthetics
         printf("=====\n");
     }
+
+    // close the connection (once the client quit, disconnected, or stopped acknowledging responses)
+    // and reclaim the session's memory
+    close(connectionfd);
+    printf("Session ended, reclaimed %zu bytes of intermediate results.\n", destroySession(currentSession));
+    currentSession = NULL;
+}
+
+/*
+ *  receiveFromClient()
+ *  Receives exactly length bytes from the client, which may take several calls to
+ *  recv. Returns false if the client disconnected or the connection broke.
+ */
+bool receiveFromClient(int connectionfd, void* buffer, size_t length)
+{
+    for (size_t received = 0; received < length; )
+    {
+        ssize_t bytes = recv(connectionfd, (char*)buffer + received, length - received, 0);
+        if ((bytes < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if (bytes <= 0)
+        {
+            return false;
+        }
+        received += bytes;
+    }
+    return true;
 }
 
 /*
  *  parseQuery()
- *  Error checks and if the query is valid, it calls the appropriate
+ *  Error checks and if the query is valid, tokenizes it and calls the appropriate
  *  operator for the query.
  */
 void parseQuery(int connectionfd, char* query)
@@ -134,36 +505,52 @@ void parseQuery(int connectionfd, char* query)
         quit(connectionfd);
     }
 
-    // check for keyword "create"
-    else if (strncmp(query, "create(\0", 7) == 0)
-    {
-        createOperator(connectionfd, query);
-    }
-
-    // check for the keyword load
-    else if (strncmp(query, "load(\0", 5) == 0)
+    // check for a batch of queries
+    else if (isBatch(query))
     {
-        loadOperator(connectionfd, query);
+        long long start = monotonicNanoseconds();
+        batchOperator(connectionfd, query);
+        recordCommandLatency(METRICS_BATCH, monotonicNanoseconds() - start);
+        traceEnd("batch", "operator", start, NULL, 0);
     }
 
-    // check for keyword "select"
-    else if (strstr(query, "=select(\0") != NULL)
+    // otherwise tokenize the query and dispatch it
+    else
     {
-        selectOperator(connectionfd, query);
+        parsedQuery parsed;
+        long long parseStart = profileStart();
+        bool parsedSuccessfully = tokenizeQuery(query, &parsed);
+        profileEnd(PROFILE_PARSE, parseStart);
+        if (!parsedSuccessfully)
+        {
+            raiseDatabaseException(connectionfd, "parseQuery\0", "Query was not a valid command\0", NULL);
+            return;
+        }
+        executeParsedQuery(connectionfd, &parsed);
     }
+}
 
-    // check for keyword "print"
-    else if (strncmp(query, "print(\0", 6) == 0)
+/*
+ *  executeParsedQuery()
+ *  Calls the operator of a tokenized query.
+ */
+void executeParsedQuery(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query->command == NULL)
     {
-        printOperator(connectionfd, query);
+        raiseDatabaseException(connectionfd, "parseQuery\0", "Query was not a valid command\0", NULL);
+        return;
     }
-
-    // if not a valid command
-    else
+    else if (query->command->storesResult && ((query->outputVariable == NULL) || (query->outputVariable[0] == '\0')))
     {
-        raiseDatabaseException(connectionfd, "parseQuery\0", "Query was not a valid command\0", NULL);
+        raiseDatabaseException(connectionfd, "parseQuery\0", "The result of ~ must be stored in an intermediate variable\0", query->commandName);
         return;
     }
+    long long start = monotonicNanoseconds();
+    query->command->function(connectionfd, query);
+    recordCommandLatency(query->command - commands, monotonicNanoseconds() - start);
+    traceEnd(query->command->name, "operator", start, NULL, 0);
 }
 
 /*
@@ -234,21 +621,24 @@ void createDatabaseDirectoryIfNotPresent(void)
     FILE* fp = fopen("db/", "r");
     if (fp == NULL)
     {
-        system("mkdir db");
+        mkdir("db", 0755);
         printf("Created the directory `db/` for storing database files.\n");
+        return;
     }
     fclose(fp);
+
+    // a crash mid-write leaves the old file of the column in place, and maybe the new one unpublished
+    removeUnpublishedColumnSegments();
 }
 
 /*
  *  quit()
- *  Is called anytime the program is correctly quitting.
+ *  Is called anytime a client is correctly quitting. Ends the client's session.
  */
 void quit(int connectionfd)
 {
-    close(connectionfd);
+    currentSession->active = false;
     printf("=====\n");
-    exit(1);
 }
 
 /*
@@ -265,13 +655,270 @@ void writeResponseToClient(int connectionfd, char* response)
         return;
     }
 
-    // write the response to the client
+    // if evaluating a batch, collect the response instead of writing it
+    long long start = profileStart();
+    if (batchResponse != NULL)
+    {
+        int length = strlen(response);
+        batchResponse = realloc(batchResponse, batchResponseLength + length + 2);
+        memcpy(batchResponse + batchResponseLength, response, length);
+        batchResponseLength += length;
+        batchResponse[batchResponseLength++] = '\n';
+        batchResponse[batchResponseLength] = '\0';
+        profileEnd(PROFILE_RESPONSE, start);
+        return;
+    }
+
+    // write the response to the client once it acknowledged the length. a client that disconnected
+    // instead ends the session
     int responseLength = strlen(response) + 1;
-    int bytesReceivedFromClient = 0;
     bool storageBool;
     write(connectionfd, &responseLength, sizeof(int));
-    while ((bytesReceivedFromClient = recv(connectionfd, &storageBool, sizeof(bool), 0)) <= 0);
+    if (!receiveFromClient(connectionfd, &storageBool, sizeof(bool)))
+    {
+        printf("Client disconnected.\n");
+        currentSession->active = false;
+        profileEnd(PROFILE_RESPONSE, start);
+        return;
+    }
     write(connectionfd, response, responseLength);
+    profileEnd(PROFILE_RESPONSE, start);
+}
+
+/*
+ *  writeBinaryResponse()
+ *  Sends a list of values to the client as a binary result instead of a string. The
+ *  header and the values go out together with writev (large results are passed as a
+ *  file descriptor to local clients, and compressed for clients that asked for it).
+ *  Returns false if the client disconnected.
+ */
+bool writeBinaryResponse(int connectionfd, int resultType, void* values, int valueSize, long long numberOfValues)
+{
+    // a large result for a client on the same host goes through shared memory
+    if (currentSession->localConnection && (numberOfValues * valueSize >= DESCRIPTOR_PASSING_THRESHOLD))
+    {
+        int fd = memfd_create("result", MFD_CLOEXEC);
+        if (fd >= 0)
+        {
+            bool passed = false;
+            size_t bytes = numberOfValues * valueSize;
+            if (ftruncate(fd, bytes) == 0)
+            {
+                void* mapped = mmap(NULL, bytes, PROT_WRITE, MAP_SHARED, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    memcpy(mapped, values, bytes);
+                    munmap(mapped, bytes);
+                    passed = passDescriptorToClient(connectionfd, resultType, fd, 0, valueSize, numberOfValues);
+                    close(fd);
+                    return passed;
+                }
+            }
+            close(fd);
+        }
+    }
+
+    // a large result for a client that asked for it is compressed
+    if (currentSession->compressResults && (numberOfValues >= COMPRESSED_RESPONSE_VALUES))
+    {
+        return writeCompressedResponse(connectionfd, resultType, values, valueSize, numberOfValues);
+    }
+
+    // announce the binary result
+    long long start = profileStart();
+    int responseLength = BINARY_RESPONSE;
+    bool storageBool;
+    write(connectionfd, &responseLength, sizeof(int));
+    if (recv(connectionfd, &storageBool, sizeof(bool), MSG_WAITALL) <= 0)
+    {
+        return false;
+    }
+
+    // send the header and the values
+    binaryResultHeader header = {resultType, valueSize, numberOfValues, 0};
+    struct iovec parts[2] = {{&header, sizeof(header)}, {values, numberOfValues * valueSize}};
+    bool written = writePartsToClient(connectionfd, parts, 2);
+    profileEnd(PROFILE_RESPONSE, start);
+    return written;
+}
+
+/*
+ *  writePartsToClient()
+ *  Writes buffers to the client with writev, picking up where a partial write left
+ *  off. The parts are modified. Returns false if the client disconnected.
+ */
+bool writePartsToClient(int connectionfd, struct iovec* parts, int numberOfParts)
+{
+    struct iovec* remaining = parts;
+    while (numberOfParts > 0)
+    {
+        ssize_t written = writev(connectionfd, remaining, numberOfParts);
+        if ((written < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if (written < 0)
+        {
+            return false;
+        }
+        while ((numberOfParts > 0) && ((size_t)written >= remaining->iov_len))
+        {
+            written -= remaining->iov_len;
+            remaining++;
+            numberOfParts--;
+        }
+        if (numberOfParts > 0)
+        {
+            remaining->iov_base = (char*)remaining->iov_base + written;
+            remaining->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+/*
+ *  writeCompressedResponse()
+ *  Sends a list of values to the client as a compressed binary result: the header,
+ *  then frames of up to COMPRESSED_FRAME_VALUES values, each compressed just before
+ *  it is written, so compressing one frame overlaps the client decoding the last.
+ *  Returns false if the client disconnected.
+ */
+bool writeCompressedResponse(int connectionfd, int resultType, void* values, int valueSize, long long numberOfValues)
+{
+    // announce the compressed result
+    long long start = profileStart();
+    int responseLength = BINARY_COMPRESSED_RESPONSE;
+    bool storageBool;
+    write(connectionfd, &responseLength, sizeof(int));
+    if (recv(connectionfd, &storageBool, sizeof(bool), MSG_WAITALL) <= 0)
+    {
+        return false;
+    }
+    binaryResultHeader header = {resultType, valueSize, numberOfValues, 0};
+    send(connectionfd, &header, sizeof(header), MSG_MORE);
+
+    // compress and send the frames
+    unsigned long long* scratch = malloc(COMPRESSED_FRAME_VALUES * sizeof(unsigned long long));
+    unsigned long long* words = malloc((COMPRESSED_FRAME_VALUES + 1) * sizeof(unsigned long long));
+    long long compressedBytes = sizeof(header);
+    bool written = true;
+    for (long long sent = 0; written && (sent < numberOfValues); )
+    {
+        int frameValues = (numberOfValues - sent < COMPRESSED_FRAME_VALUES) ? (int)(numberOfValues - sent) : COMPRESSED_FRAME_VALUES;
+        compressedFrameHeader frame;
+        compressFrame((char*)values + (sent * valueSize), valueSize, frameValues, &frame, scratch, words);
+        struct iovec parts[2] = {{&frame, sizeof(frame)}, {words, frame.encodedBytes}};
+        written = writePartsToClient(connectionfd, parts, 2);
+        compressedBytes += sizeof(frame) + frame.encodedBytes;
+        sent += frameValues;
+    }
+    free(scratch);
+    free(words);
+    profileEnd(PROFILE_RESPONSE, start);
+    printf("Sent %lld values in %lld bytes compressed (%lld raw).\n", numberOfValues, compressedBytes, numberOfValues * valueSize);
+    return written;
+}
+
+/*
+ *  sendColumnToClient()
+ *  Sends the values of a column file (already opened and its header read) to the client
+ *  as a binary result, copied by the kernel with sendfile. Returns false if the client
+ *  disconnected.
+ */
+bool sendColumnToClient(int connectionfd, FILE* fp, int valueSize, int numberOfValues)
+{
+    // a client on the same host maps the column file itself
+    size_t bytes = (size_t)numberOfValues * valueSize;
+    if (currentSession->localConnection && (bytes >= DESCRIPTOR_PASSING_THRESHOLD))
+    {
+        recordBytesRead(bytes);
+        return passDescriptorToClient(connectionfd, BINARY_VALUES, fileno(fp), 2 * sizeof(int), valueSize, numberOfValues);
+    }
+
+    // a large column for a client that asked for it is compressed from a mapping of its file
+    if (currentSession->compressResults && (numberOfValues >= COMPRESSED_RESPONSE_VALUES))
+    {
+        size_t mappedLength = (2 * sizeof(int)) + bytes;
+        char* mapped = mmap(NULL, mappedLength, PROT_READ, MAP_SHARED, fileno(fp), 0);
+        if (mapped != MAP_FAILED)
+        {
+            bool written = writeCompressedResponse(connectionfd, BINARY_VALUES, mapped + (2 * sizeof(int)), valueSize, numberOfValues);
+            munmap(mapped, mappedLength);
+            recordBytesRead(bytes);
+            return written;
+        }
+    }
+
+    // announce the binary result and send its header
+    long long start = profileStart();
+    int responseLength = BINARY_RESPONSE;
+    bool storageBool;
+    write(connectionfd, &responseLength, sizeof(int));
+    if (recv(connectionfd, &storageBool, sizeof(bool), MSG_WAITALL) <= 0)
+    {
+        return false;
+    }
+    binaryResultHeader header = {BINARY_VALUES, valueSize, numberOfValues, 0};
+    send(connectionfd, &header, sizeof(header), MSG_MORE);
+
+    // the values follow the column's header in the file
+    off_t offset = 2 * sizeof(int);
+    size_t remaining = bytes;
+    while (remaining > 0)
+    {
+        ssize_t sent = sendfile(connectionfd, fileno(fp), &offset, remaining);
+        if ((sent < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if (sent <= 0)
+        {
+            return false;
+        }
+        remaining -= sent;
+    }
+    profileEnd(PROFILE_RESPONSE, start);
+    recordBytesRead(bytes);
+    return true;
+}
+
+/*
+ *  passDescriptorToClient()
+ *  Sends a binary result as a file descriptor (passed with SCM_RIGHTS along with the
+ *  header) whose contents hold the values from offset on. The client maps it, so the
+ *  values are never copied through the socket. Returns false if the client disconnected.
+ */
+bool passDescriptorToClient(int connectionfd, int resultType, int fd, long long offset, int valueSize, long long numberOfValues)
+{
+    // announce the binary result
+    long long start = profileStart();
+    int responseLength = BINARY_DESCRIPTOR_RESPONSE;
+    bool storageBool;
+    write(connectionfd, &responseLength, sizeof(int));
+    if (recv(connectionfd, &storageBool, sizeof(bool), MSG_WAITALL) <= 0)
+    {
+        return false;
+    }
+
+    // send the header with the descriptor attached
+    binaryResultHeader header = {resultType, valueSize, numberOfValues, offset};
+    struct iovec part = {&header, sizeof(header)};
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr* descriptor = CMSG_FIRSTHDR(&message);
+    descriptor->cmsg_level = SOL_SOCKET;
+    descriptor->cmsg_type = SCM_RIGHTS;
+    descriptor->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(descriptor), &fd, sizeof(int));
+    bool sent = (sendmsg(connectionfd, &message, 0) == sizeof(header));
+    profileEnd(PROFILE_RESPONSE, start);
+    return sent;
 }
 
 /*
@@ -297,8 +944,8 @@ void writeResponseToClient(int connectionfd, char* response)
         return NULL;
     }
 
-    // create and return the concatenated string
-    char* message = malloc(strlen(prefix) + strlen(stringToBeInserted) + strlen(suffix) + 3);
+    // create and return the concatenated string (it lives until the query completes)
+    char* message = arenaAllocate(&currentSession->queryArena, strlen(prefix) + strlen(stringToBeInserted) + strlen(suffix) + 3);
     strncpy(message, prefix, strlen(prefix) + 1);
     strncpy(message + strlen(prefix), stringToBeInserted, strlen(stringToBeInserted) + 1);
     strncpy(message + strlen(prefix) + strlen(stringToBeInserted), suffix, strlen(suffix) + 1);
@@ -309,7 +956,7 @@ void writeResponseToClient(int connectionfd, char* response)
   *  increaseArraySizeByMultiplier()
   *  Is used to increase an array's size on the heap.
   */
- int* increaseArraySizeByMultiplier(int connectionfd, int* array, int newArraySize)
+ void* increaseArraySizeByMultiplier(int connectionfd, void* array, int newArraySize)
  {
     // error checking
     if (array == NULL)
@@ -318,7 +965,7 @@ void writeResponseToClient(int connectionfd, char* response)
     }
 
     // increase the size of the array and return it
-    int* newArray = realloc(array, newArraySize);
+    void* newArray = realloc(array, newArraySize);
     return newArray;
  }
 
@@ -339,554 +986,3843 @@ void writeResponseToClient(int connectionfd, char* response)
     return newArray;
  }
 
- /*
-  *  printOperator()
-  *  Is used for printing intermediate variables. Useful for debugging
-  */
- void printOperator(int connectionfd, char* query)
- {
-    // error checking
-    if (query == NULL)
+/*
+ *  openColumnForReading()
+ *  Opens the file of a column (as of the query's snapshot) and reads its header,
+ *  leaving the file positioned at the first value. The file of a partitioned column
+ *  holds its partition directory instead, which the number of values is taken from
+ *  (its values are in the files of its partitions). Returns NULL (after raising an
+ *  exception, unless function is NULL) if the column is invalid.
+ */
+FILE* openColumnForReading(int connectionfd, char* function, char* columnName, int* numberOfValues, int* valueType)
+{
+    // open column and see if it's valid
+    char* column = columnSnapshotPath(columnName);
+    FILE* fp = (column == NULL) ? NULL : fopen(column, "rb");
+    if (fp == NULL)
     {
-        raiseDatabaseException(connectionfd, "printOperator\0", "Query was NULL\0", NULL);
-        return;
+        if (function != NULL)
+            raiseDatabaseException(connectionfd, function, "The column ~ does not exist in the database\0", columnName);
+        return NULL;
     }
 
-    // store a copy of the query
-    char* queryCopy = malloc(strlen(query) + 1);
-    strncpy(queryCopy, query, strlen(query) + 1);
-    // queryCopy[strlen(query)] = '\0';
-
-    // parse the query and error check
-    char* lasts;
-    int queryLength = strlen(query);
-    strtok_r(query, "(", &lasts);
-    char* variableName = strtok_r(NULL, ")", &lasts);
-    if (variableName == NULL)
+    // read the header to see what kind of storage the file has
+    int headerStorageType;
+    int headerStorageSize;
+    if ((fread(&headerStorageType, sizeof(int), 1, fp) != 1) || (fread(&headerStorageSize, sizeof(int), 1, fp) != 1) ||
+        !isValidColumnHeader(headerStorageType))
     {
-        raiseDatabaseException(connectionfd, "printOperator\0", "variableName was NULL. Ensure the format of the query is \"print(variableName)\"\0", NULL);
-        return;
+        if (function != NULL)
+            raiseDatabaseException(connectionfd, function, "The column ~ does not have valid header info\0", columnName);
+        fclose(fp);
+        return NULL;
     }
-
-    // fix possible garbage in variable name
-    int variableNameLength = 0;
-    bool validChars = 0;
-    for (int i = 0; (i < queryLength) && (queryCopy[i] != ')'); i++)
+    *valueType = columnValueType(headerStorageType);
+    *numberOfValues = headerStorageSize / columnTypeWidths[*valueType];
+    partitionDirectory directory;
+    if (((headerStorageType & PARTITIONED_COLUMN) != 0) &&
+        ((headerStorageSize != sizeof(partitionDirectory)) || (fread(&directory, sizeof(partitionDirectory), 1, fp) != 1)))
     {
-        if ((validChars == 0) && (queryCopy[i] == '('))
-        {
-            validChars = 1;
-        }
-
-        // count if past the '('
-        if (validChars)
-        {
-            variableNameLength++;
-        }
+        if (function != NULL)
+            raiseDatabaseException(connectionfd, function, "The column ~ does not have a valid partition directory\0", columnName);
+        fclose(fp);
+        return NULL;
     }
-    char* newVariableName = malloc(variableNameLength + 1);
-    strncpy(newVariableName, variableName, variableNameLength);
-    newVariableName[variableNameLength] = '\0';
-
-    // get the variable if it exists
-    intermediateResult* variable = checkForIntermediateResultInLinkedList(newVariableName);
-    if (variable != NULL)
+    else if ((headerStorageType & PARTITIONED_COLUMN) != 0)
     {
-        // create a string for the client
-        // "Variable Name: " + variable->variableName;
-        // "Number of Valid Positions: "
-        // "Valid Positions: " + (string)variable->validPositions;
-
-        // variable name
-        char* variableNameHeader = "Variable Name: \0";
-        char* responseForClient = malloc(strlen(variableNameHeader) + strlen(variable->variableName) + 2);
-        strncpy(responseForClient, variableNameHeader, strlen(variableNameHeader) + 1); // +1 for null terminator
-        strncpy(responseForClient + strlen(variableNameHeader), variable->variableName, strlen(variable->variableName) + 1); // +1 for null termintor
-        responseForClient[strlen(variableNameHeader) + strlen(variable->variableName)] = '\n';
-        responseForClient[strlen(variableNameHeader) + strlen(variable->variableName) + 1] = '\0';
-        for (int i = 0, len = strlen(variableNameHeader) + strlen(variable->variableName) + 2; i < len; i++)
-        {
-            printf("Char: [%c]", responseForClient[i]);
-        }
-
+        int offsets[MAX_PARTITIONS];
+        *numberOfValues = partitionOffsets(&directory, offsets);
     }
+    return fp;
 }
 
 /*
- *  create()
- *  Is used to create a column (represented as a binary file on disk) in the 
- *  database.
+ *  isValidColumnHeader()
+ *  Returns whether the storage type in the header of a column file is valid: one of the
+ *  storage types, the type of the column's values in the bits above it, and whether
+ *  the column is partitioned above those.
  */
-void createOperator(int connectionfd, char* query)
+bool isValidColumnHeader(int headerStorageType)
 {
-    // error checking
-    if (query == NULL)
+    int storage = headerStorageType & STORAGE_TYPE_MASK;
+    int valueType = columnValueType(headerStorageType);
+    int knownBits = PARTITIONED_COLUMN | (COLUMN_TYPE_MASK << COLUMN_TYPE_SHIFT) | STORAGE_TYPE_MASK;
+    return ((storage == UNSORTED) || (storage == SORTED) || (storage == BTREE)) &&
+           (valueType < NUMBER_OF_COLUMN_TYPES) && ((headerStorageType & ~knownBits) == 0);
+}
+
+/*
+ *  readColumnFromDisk()
+ *  Reads every value of a column into a buffer on the heap, with the blocks of the
+ *  file read asynchronously. The values are as wide as the column's type, which is
+ *  returned in valueType. Returns NULL (after raising an exception) if the column
+ *  is invalid.
+ */
+void* readColumnFromDisk(int connectionfd, char* function, char* columnName, int* numberOfValues, int* valueType)
+{
+    long long start = profileStart();
+    FILE* fp = openColumnForReading(connectionfd, function, columnName, numberOfValues, valueType);
+    if (fp == NULL)
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "Query was NULL\0", NULL);
-        return;
+        return NULL;
     }
+    int width = columnTypeWidths[*valueType];
+    void* arrayOfFileData = malloc(((size_t)*numberOfValues + 1) * width);
 
-    // parse the query
-    char* last;
-    strtok_r(query, "(", &last);
-    char* column = strtok_r(NULL, ",", &last);
-    char* storage = strtok_r(NULL, ")", &last);
-    if (column == NULL || storage == NULL)
+    // a partitioned column is read a partition at a time, in parallel, each into its place
+    partitionDirectory directory;
+    if (readPartitionDirectory(columnName, &directory))
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "The specified column or storage was NULL\0", NULL);
-        return;
+        fclose(fp);
+        if (!readPartitionedColumn(columnName, &directory, *valueType, arrayOfFileData))
+        {
+            if (function != NULL)
+                raiseDatabaseException(connectionfd, function, "The partitions of the column ~ could not be read\0", columnName);
+            free(arrayOfFileData);
+            return NULL;
+        }
+        profileEnd(PROFILE_IO, start);
+        recordBytesRead((size_t)*numberOfValues * width);
+        return arrayOfFileData;
     }
-    else if (!((strcmp(storage, "\"unsorted\"") == 0) || (strcmp(storage, "\"sorted\"") == 0) || (strcmp(storage, "\"b+tree\"") == 0)))
+    ssize_t bytesRead = readFileAsync(fileno(fp), arrayOfFileData, (size_t)*numberOfValues * width, 2 * sizeof(int));
+    *numberOfValues = (bytesRead > 0) ? bytesRead / width : 0;
+    fclose(fp);
+    profileEnd(PROFILE_IO, start);
+    recordBytesRead((2 * sizeof(int)) + ((size_t)*numberOfValues * width));
+    return arrayOfFileData;
+}
+
+/*
+ *  readPartitionFile()
+ *  Reads the values of a partition's file (opened at path) into values, checking that
+ *  it holds numberOfValues values of the given width. Safe to call from any thread.
+ *  Returns false if the file cannot be read or does not match.
+ */
+bool readPartitionFile(char* path, void* values, int numberOfValues, int width)
+{
+    FILE* fp = (path == NULL) ? NULL : fopen(path, "rb");
+    if (fp == NULL)
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "The specified storage does not match unsorted, sorted, or b+tree\0", NULL);
-        return;
+        return false;
     }
+    int headerStorageType;
+    int headerStorageSize;
+    size_t bytes = (size_t)numberOfValues * width;
+    bool read = (fread(&headerStorageType, sizeof(int), 1, fp) == 1) && (fread(&headerStorageSize, sizeof(int), 1, fp) == 1) &&
+                ((size_t)headerStorageSize == bytes) && (readFileAsync(fileno(fp), values, bytes, 2 * sizeof(int)) == (ssize_t)bytes);
+    fclose(fp);
+    return read;
+}
 
-    // capture the storage type
-    int storageId = (strcmp(storage, "\"unsorted\"") == 0) ? UNSORTED : 
-                       ((strcmp(storage, "\"sorted\"") == 0)   ? SORTED  :
-                       ((strcmp(storage, "\"b+tree\"") == 0)   ? BTREE   : -1));
-    if ((storageId != UNSORTED) && (storageId != SORTED) && (storageId != BTREE))
+/*
+ *  readPartitionTask()
+ *  Reads a partition into its region of a buffer holding the whole column.
+ */
+void readPartitionTask(void* task)
+{
+    partitionTask* partition = task;
+    partition->failed = !readPartitionFile(partition->path, partition->values, partition->numberOfValues,
+                                           columnTypeWidths[partition->valueType]);
+}
+
+/*
+ *  scanPartitionTask()
+ *  Reads a partition and selects the positions of its values in the predicate's range,
+ *  as positions in the whole column. The values at them are gathered (widened to ints)
+ *  as well if asked for.
+ */
+void scanPartitionTask(void* task)
+{
+    partitionTask* partition = task;
+    int width = columnTypeWidths[partition->valueType];
+    void* values = malloc(((size_t)partition->numberOfValues + 1) * width);
+    partition->failed = !readPartitionFile(partition->path, values, partition->numberOfValues, width);
+    if (!partition->failed)
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "The specified storage does not match the storage id for either unsorted, sorted, or b+tree\0", NULL);
-        return;
+        int selected = selectKernels[partition->valueType](values, partition->numberOfValues, partition->low, partition->high, partition->positions);
+        if (partition->selectedValues != NULL)
+        {
+            void* gathered = malloc(((size_t)selected + 1) * width);
+            gatherKernels[partition->valueType](values, partition->numberOfValues, partition->positions, selected, gathered);
+            widenKernels[partition->valueType](gathered, selected, partition->selectedValues);
+            free(gathered);
+        }
+        for (int i = 0; i < selected; i++)
+        {
+            partition->positions[i] += partition->offset;
+        }
+        partition->numberOfPositions = selected;
     }
+    free(values);
+}
 
-    // error check and create the file
-    char* path = malloc(4 + strlen(column));
-    sprintf(path, "db/%s", column);
-    if (path == NULL)
+/*
+ *  readPartitionedColumn()
+ *  Reads every partition of a column, in parallel, into values (room for the whole
+ *  column), in the order of the column's positions. Returns false on error.
+ */
+bool readPartitionedColumn(char* columnName, partitionDirectory* directory, int valueType, void* values)
+{
+    // the paths of the partitions are resolved in the calling thread's snapshot
+    int offsets[MAX_PARTITIONS];
+    partitionOffsets(directory, offsets);
+    partitionTask tasks[MAX_PARTITIONS];
+    char name[strlen(columnName) + 16];
+    int numberOfTasks = 0;
+    for (int i = 0; i < directory->numberOfPartitions; i++)
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "The path for the column ~ was NULL\0", column);
-        free(path);
-        return;
+        if (directory->partitions[i].numberOfValues == 0)
+            continue;
+        partitionColumnName(columnName, i, name);
+        memset(&tasks[numberOfTasks], 0, sizeof(partitionTask));
+        tasks[numberOfTasks].path = columnSnapshotPath(name);
+        tasks[numberOfTasks].valueType = valueType;
+        tasks[numberOfTasks].numberOfValues = directory->partitions[i].numberOfValues;
+        tasks[numberOfTasks].values = (char*)values + ((size_t)offsets[i] * columnTypeWidths[valueType]);
+        numberOfTasks++;
     }
-    FILE* fp = fopen(path, "wb");
-    if (fp == NULL)
+    runPartitionTasks(readPartitionTask, tasks, sizeof(partitionTask), numberOfTasks);
+    for (int i = 0; i < numberOfTasks; i++)
     {
-        raiseDatabaseException(connectionfd, "createOperator\0", "The filepointer created for the path ~ was NULL\0", path);
-        free(path);
-        return;
+        if (tasks[i].failed)
+            return false;
     }
+    return true;
+}
 
-    // write header data to the file. header consists of storage type and the number of bytes in the file
-    int bytesInFile = 0;
-    fwrite(&storageId, sizeof(int), 1, fp);
-    fwrite(&bytesInFile, sizeof(int), 1, fp);
+/*
+ *  scanPartitionedColumn()
+ *  Selects the positions of the values in [low, high] of a partitioned column. The
+ *  partitions the predicate cannot match are pruned using the partition directory,
+ *  without being read, and the rest are scanned in parallel, each into its region of
+ *  the result. The values at the positions are returned in selectedValues as well, if
+ *  not NULL (NULL for int64 columns). Returns NULL (after raising an exception) on error.
+ */
+int* scanPartitionedColumn(int connectionfd, char* column, partitionDirectory* directory, long long low, long long high, int* numberOfPositions, int** selectedValues)
+{
+    int numberOfValuesInColumn;
+    int valueType;
+    FILE* fp = openColumnForReading(connectionfd, "scanPartitionedColumn\0", column, &numberOfValuesInColumn, &valueType);
+    if (fp == NULL)
+    {
+        return NULL;
+    }
     fclose(fp);
 
-    // create a message and write it to the client
-    char* prefix = "Created column `\0";
-    char* suffix = "` in the database.\0";
-    char* message = createCustomMessage(connectionfd, prefix, column, suffix);
-    if (message == NULL)
+    // scan the partitions that may match
+    long long start = profileStart();
+    int offsets[MAX_PARTITIONS];
+    partitionOffsets(directory, offsets);
+    int* validPositionsInArray = poolAllocate((numberOfValuesInColumn + 1) * sizeof(int));
+    bool gather = (selectedValues != NULL) && (valueType != COLUMN_INT64);
+    int* values = gather ? malloc((numberOfValuesInColumn + 1) * sizeof(int)) : NULL;
+    partitionTask tasks[MAX_PARTITIONS];
+    char name[strlen(column) + 16];
+    int numberOfTasks = 0;
+    long long rowsScanned = 0;
+    for (int i = 0; i < directory->numberOfPartitions; i++)
     {
-        printf("Create operation was aborted due to above database exception.\n");
-        free(path);
-        return;
+        if (!partitionMayMatch(directory, column, i, low, high))
+            continue;
+        partitionColumnName(column, i, name);
+        memset(&tasks[numberOfTasks], 0, sizeof(partitionTask));
+        tasks[numberOfTasks].path = columnSnapshotPath(name);
+        tasks[numberOfTasks].valueType = valueType;
+        tasks[numberOfTasks].numberOfValues = directory->partitions[i].numberOfValues;
+        tasks[numberOfTasks].offset = offsets[i];
+        tasks[numberOfTasks].low = low;
+        tasks[numberOfTasks].high = high;
+        tasks[numberOfTasks].positions = validPositionsInArray + offsets[i];
+        tasks[numberOfTasks].selectedValues = gather ? values + offsets[i] : NULL;
+        rowsScanned += directory->partitions[i].numberOfValues;
+        numberOfTasks++;
     }
-    writeResponseToClient(connectionfd, message);
+    runPartitionTasks(scanPartitionTask, tasks, sizeof(partitionTask), numberOfTasks);
+    profileEnd(PROFILE_IO, start);
+    recordBytesRead(rowsScanned * columnTypeWidths[valueType]);
 
-    // print the message in the server and cleanup
-    printf("%s\n", message);
-    free(message);
+    // move the regions of the partitions together (they are in order, so positions stay sorted)
+    int numberOfValidPositions = 0;
+    for (int i = 0; i < numberOfTasks; i++)
+    {
+        if (tasks[i].failed)
+        {
+            raiseDatabaseException(connectionfd, "scanPartitionedColumn\0", "The partitions of the column ~ could not be read\0", column);
+            poolFree(validPositionsInArray);
+            free(values);
+            return NULL;
+        }
+        memmove(validPositionsInArray + numberOfValidPositions, tasks[i].positions, tasks[i].numberOfPositions * sizeof(int));
+        if (gather)
+            memmove(values + numberOfValidPositions, tasks[i].selectedValues, tasks[i].numberOfPositions * sizeof(int));
+        numberOfValidPositions += tasks[i].numberOfPositions;
+    }
+    printf("Scanned %d of the %d partitions of `%s`.\n", numberOfTasks, directory->numberOfPartitions, column);
+    if (selectedValues != NULL)
+        *selectedValues = values;
+    recordRowsSelected(rowsScanned, numberOfValidPositions);
+    *numberOfPositions = numberOfValidPositions;
+    return validPositionsInArray;
 }
 
 /*
- *  select()
- *  Is used to return the positions of matching data in the query. The result is either
- *  stored in a variable or returned to the user right away. 
+ *  printOperator()
+ *  Is used for printing intermediate variables (or whole columns). Useful for debugging.
+ *  A Bloom filter is printed as its size.
+ *  print(name,binary) sends the values as a binary result instead of as text. Large
+ *  lists are always sent as binary results to clients that asked for compression.
  */
-void selectOperator(int connectionfd, char* query)
+void printOperator(int connectionfd, parsedQuery* query)
 {
     // error checking
     if (query == NULL)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "Query was NULL\0", NULL);
+        raiseDatabaseException(connectionfd, "printOperator\0", "Query was NULL\0", NULL);
         return;
     }
 
-    // make sure the user is storing the result
-    if (strstr(query, "=") == NULL)
+    // error check the arguments
+    char* variableName = queryArgument(query, 0);
+    char* option = queryArgument(query, 1);
+    if ((variableName == NULL) || ((option != NULL) && (strcmp(option, BINARY_OPTION) != 0)))
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "The result of a select must be stored in an intermediate variable\0", NULL);
+        raiseDatabaseException(connectionfd, "printOperator\0", "Ensure the format of the query is \"print(variableName)\" or \"print(variableName,binary)\"\0", NULL);
         return;
     }
 
-    // parse the query
-    char* last;
-    char* variableName = strtok_r(query, "=", &last);
-    strtok_r(NULL, "(", &last);
-    char* firstArgument = strtok_r(NULL, ",)", &last);
-    char* secondArgument = strtok_r(NULL, ",)", &last);
-    char* thirdArgument = strtok_r(NULL, ",)", &last);
-    if (variableName == NULL)
+    // a binary result cannot be collected into the text response of a batch or a profile
+    bool binary = (option != NULL) && (batchResponse == NULL);
+    bool compressed = currentSession->compressResults && (batchResponse == NULL);
+
+    // scalars are printed on their own
+    char* responseForClient;
+    intermediateResult* variable = lookupIntermediateResult(currentSession, variableName);
+    if ((variable != NULL) && ((variable->resultType == SCALAR_VALUE) || (variable->resultType == AVERAGE_VALUE) || (variable->resultType == BLOOM_FILTER)))
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "variableName was NULL\0", NULL);
+        responseForClient = arenaAllocate(&currentSession->queryArena, 64);
+        if (variable->resultType == SCALAR_VALUE)
+            sprintf(responseForClient, "%lld", variable->scalarValue);
+        else if (variable->resultType == BLOOM_FILTER)
+            sprintf(responseForClient, "Bloom filter of %lld values in %zu bytes", variable->scalarValue, variable->numberOfValues * sizeof(unsigned int));
+        else
+            sprintf(responseForClient, "%f", variable->averageValue);
+        writeResponseToClient(connectionfd, responseForClient);
         return;
     }
-    else if (firstArgument == NULL)
+
+    // position and value lists are printed as they are (positions are int32s, values as wide as
+    // their column), a name that is not a variable as the whole column. a column asked for in binary
+    // is sent straight from its file
+    void* list;
+    int listLength;
+    int listType = COLUMN_INT32;
+    int resultType = BINARY_VALUES;
+    void* columnValues = NULL;
+    if (variable != NULL)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "firstArgument of the query was NULL\0", NULL);
+        resultType = (variable->resultType == POSITION_LIST) ? BINARY_POSITIONS : BINARY_VALUES;
+        list = (variable->resultType == POSITION_LIST) ? (void*)variable->validPositions : variable->values;
+        listLength = (variable->resultType == POSITION_LIST) ? variable->numberOfValidPositions : variable->numberOfValues;
+        listType = (variable->resultType == POSITION_LIST) ? COLUMN_INT32 : variable->valueType;
+        binary = binary || (compressed && (listLength >= COMPRESSED_RESPONSE_VALUES));
+    }
+    else
+    {
+        FILE* fp = openColumnForReading(connectionfd, NULL, variableName, &listLength, &listType);
+        if (fp == NULL)
+        {
+            raiseDatabaseException(connectionfd, "printOperator\0", "The variable or column ~ does not exist\0", variableName);
+            return;
+        }
+        binary = binary || (compressed && (listLength >= COMPRESSED_RESPONSE_VALUES));
+        if (binary && !readPartitionDirectory(variableName, NULL))
+        {
+            sendColumnToClient(connectionfd, fp, columnTypeWidths[listType], listLength);
+            fclose(fp);
+            return;
+        }
+        fclose(fp);
+        columnValues = readColumnFromDisk(connectionfd, "printOperator\0", variableName, &listLength, &listType);
+        if (columnValues == NULL)
+        {
+            return;
+        }
+        list = columnValues;
+    }
+    if (binary)
+    {
+        writeBinaryResponse(connectionfd, resultType, list, columnTypeWidths[listType], listLength);
+        free(columnValues);
         return;
     }
 
-    // make sure variable name is unique
-    if (checkForIntermediateResultInLinkedList(variableName) != NULL)
+    // otherwise they are printed as comma separated lists
+    responseForClient = arenaAllocate(&currentSession->queryArena, ((size_t)listLength * columnTypeTextWidths[listType]) + 1);
+    formatKernels[listType](list, listLength, responseForClient);
+    free(columnValues);
+    writeResponseToClient(connectionfd, responseForClient);
+}
+
+/*
+ *  dropOperator()
+ *  Is used to release an intermediate variable and the memory it holds.
+ */
+void dropOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "The variable ~ already exists in memory, please rename the current intermediate result variable\0", variableName);
+        raiseDatabaseException(connectionfd, "dropOperator\0", "Query was NULL\0", NULL);
         return;
     }
 
-    // open column and see if it's valid
-    char* column = malloc(strlen(firstArgument) + 3);
-    sprintf(column, "db/%s",firstArgument);
-    FILE* fp = fopen(column, "rb");
-    if (fp == NULL)
+    // error check the arguments
+    char* variableName = queryArgument(query, 0);
+    if (variableName == NULL)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "Unable to do this selection. The column ~ does not exist in the database\0", firstArgument);
-        free(column);
+        raiseDatabaseException(connectionfd, "dropOperator\0", "variableName was NULL. Ensure the format of the query is \"drop(variableName)\"\0", NULL);
         return;
     }
 
-    // read the header to see what kind of storage the file has
-    int headerStorageType;
-    fread(&headerStorageType, sizeof(int), 1, fp);
-    if ((headerStorageType != UNSORTED) && (headerStorageType != SORTED) && (headerStorageType != BTREE))
+    // drop(column,partition) drops a partition of a column instead
+    if (queryArgument(query, 1) != NULL)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "Unable to do this selection. The column ~ does not have valid header info\0", column);
-        free(column);
-        fclose(fp);
+        dropPartition(connectionfd, variableName, queryArgument(query, 1));
         return;
     }
 
-    // data to fix possible garbange variable name
-    int distanceToEquals = 0;
-    for (int i = 0; (i < strlen(query)) && (query[i] != '='); i++)
+    // drop the variable
+    if (!dropIntermediateResult(currentSession, variableName))
     {
-        distanceToEquals++;
+        raiseDatabaseException(connectionfd, "dropOperator\0", "The variable ~ does not exist\0", variableName);
+        return;
     }
 
-    // read all data from the file into a buffer
-    int headerStorageSize;
-    fread(&headerStorageSize, sizeof(int), 1, fp);
-    int* arrayOfFileData = malloc(headerStorageSize * sizeof(int));
-    fread(arrayOfFileData, headerStorageSize, 1, fp);
-    fclose(fp);
-
-    // variables for position metadata
-    int* validPositionsInArray = malloc(headerStorageSize * sizeof(int));
-    int numberOfValidPositions = 0;
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Dropped `\0", variableName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Drop operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
 
-    // if selecting on the entire column
-    if ((secondArgument == NULL) && (thirdArgument == NULL))
+/*
+ *  dropPartition()
+ *  Drops the values of a partition of a column, e.g. the oldest range of a column
+ *  partitioned by time. Only the partition's (now empty) segment and the column's
+ *  partition directory are written, so this takes the same time however much data
+ *  the partition held. The positions of later partitions move down accordingly, so
+ *  the columns partitioned alongside it should have the same partition dropped.
+ */
+void dropPartition(int connectionfd, char* column, char* partitionArgument)
+{
+    // the directory is read as it is now rather than as of the query's snapshot, since it is replaced
+    beginColumnWrites();
+    partitionDirectory directory;
+    int partition = atoi(partitionArgument);
+    int headerStorageType = 0;
+    char* path = newestColumnPath(column);
+    FILE* fp = (path == NULL) ? NULL : fopen(path, "rb");
+    if (fp != NULL)
     {
-        // add all positions as valid
-        for (int i = 0; i < (headerStorageSize / sizeof(int)); i++)
-            validPositionsInArray[numberOfValidPositions++] = i;
+        fread(&headerStorageType, sizeof(int), 1, fp);
+        fclose(fp);
     }
-    // if selecting the locations of just one value
-    else if ((secondArgument != NULL) && (thirdArgument == NULL))
+    if (!readPartitionDirectoryAt(path, &directory))
     {
-        // add positions that have a value matching the entered number as valid
-        int secondArgumentCastToInteger = atoi(secondArgument);
-        for (int i = 0; i < (headerStorageSize / sizeof(int)); i++)
-        {
-            if (arrayOfFileData[i] == secondArgumentCastToInteger)
-            {
-                validPositionsInArray[numberOfValidPositions++] = i;
-            }
-        }
+        abortColumnWrites();
+        raiseDatabaseException(connectionfd, "dropOperator\0", "The column ~ does not exist or is not partitioned\0", column);
+        return;
     }
-    // if selecting between two values
-    else if ((secondArgument != NULL) && (thirdArgument != NULL))
+    else if ((partition < 0) || (partition >= directory.numberOfPartitions))
     {
-        // add positions that are bound by the two values as valid
-        int secondArgumentCastToInteger = atoi(secondArgument);
-        int thirdArgumentCastToInteger = atoi(thirdArgument);
-        for (int i = 0; i < (headerStorageSize / sizeof(int)); i++)
-        {
-            if (arrayOfFileData[i] >= secondArgumentCastToInteger
-                && arrayOfFileData[i] <= thirdArgumentCastToInteger)
-            {
-                validPositionsInArray[numberOfValidPositions++] = i;
-            }
-        }
+        abortColumnWrites();
+        raiseDatabaseException(connectionfd, "dropOperator\0", "The column ~ does not have that partition\0", column);
+        return;
     }
-    // error checking
+
+    // write the empty partition and the directory without it
+    char name[strlen(column) + 16];
+    partitionColumnName(column, partition, name);
+    int partitionStorageType = headerStorageType & ~PARTITIONED_COLUMN;
+    int bytesInFile = 0;
+    FILE* partitionFp = createColumnSegment(name);
+    bool written = (partitionFp != NULL) && (fwrite(&partitionStorageType, sizeof(int), 1, partitionFp) == 1) &&
+                   (fwrite(&bytesInFile, sizeof(int), 1, partitionFp) == 1);
+    if (!written && (partitionFp != NULL))
+    {
+        discardColumnSegment(name, partitionFp);
+    }
+    bool staged = written && stageColumnSegment(name, partitionFp);
+    clearPartitionInfo(&directory.partitions[partition]);
+    int headerStorageSize = sizeof(partitionDirectory);
+    FILE* directoryFp = staged ? createColumnSegment(column) : NULL;
+    written = (directoryFp != NULL) && (fwrite(&headerStorageType, sizeof(int), 1, directoryFp) == 1) &&
+              (fwrite(&headerStorageSize, sizeof(int), 1, directoryFp) == 1) && (fwrite(&directory, sizeof(partitionDirectory), 1, directoryFp) == 1);
+    if (!written && (directoryFp != NULL))
+    {
+        discardColumnSegment(column, directoryFp);
+    }
+    staged = written && stageColumnSegment(column, directoryFp);
+    bool published = false;
+    if (staged)
+        published = publishColumnWrites();
     else
+        abortColumnWrites();
+    if (!published)
     {
-        raiseDatabaseException(connectionfd, "selectOperator\0", "secondArgument was NULL and thirdArgument was not, which cannot happen in a valid query\0", NULL);
+        raiseDatabaseException(connectionfd, "dropOperator\0", "Could not drop the partition of the column ~\0", column);
         return;
     }
 
-    // store the result in an intermediate variable
-    intermediateResult* variable = malloc(sizeof(intermediateResult));
-    variable->variableName = malloc(distanceToEquals + 1);
-    strncpy(variable->variableName, query, distanceToEquals);
-    variableName[distanceToEquals] = '\0';
-    variable->numberOfValidPositions = numberOfValidPositions;
-    variable->validPositions = malloc(numberOfValidPositions * sizeof(int));
-    memcpy((void*)variable->validPositions, (void*)validPositionsInArray, (numberOfValidPositions * sizeof(int)));
-    variable->next = NULL;
-
-    // store the intermediate variable
-    insertIntermediateResultIntoLinkedList(variable);
-    // printLinkedListOfIntermediateResults();   
+    // what was derived from the column's old values no longer holds (its statistics are only an
+    // estimate, so they are kept rather than gathered again, while its sketches are built again
+    // when next needed since the rows of the partition would still be counted)
+    invalidateCrackerColumn(column);
+    discardColumnSketches(column);
+    invalidateColumnInResultCache(column);
 
     // create a message and write it to the client
-    char* prefix = "Selected valid positions from the column `\0";
-    char* suffix = "`.\0";
-    char* message = createCustomMessage(connectionfd, prefix, firstArgument, suffix);
+    char* message = createCustomMessage(connectionfd, "Dropped a partition of `\0", column, "`.\0");
     if (message == NULL)
     {
-        printf("Select operation was aborted due to above database exception.\n");
-        free(arrayOfFileData);
+        printf("Drop operation was aborted due to above database exception.\n");
         return;
     }
     writeResponseToClient(connectionfd, message);
-
-    // print the message in the server and cleanup
     printf("%s\n", message);
-    free(arrayOfFileData);
 }
 
 /*
- *  loadOperator()
- *  Is used to load .csv files into the database.
+ *  prepareOperator()
+ *  Is used to tokenize a statement once so it can be executed many times, e.g.
+ *  prepare(q,?=select(column,?,?)). Each ? is a parameter bound by execute().
  */
-void loadOperator(int connectionfd, char* query)
+void prepareOperator(int connectionfd, parsedQuery* query)
 {
     // error checking
     if (query == NULL)
     {
-        raiseDatabaseException(connectionfd, "loadOperator\0", "Query was NULL\0", NULL);
+        raiseDatabaseException(connectionfd, "prepareOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* name = queryArgument(query, 0);
+    char* statement = queryArgument(query, 1);
+    if ((name == NULL) || (statement == NULL) || (query->numberOfArguments != 2))
+    {
+        raiseDatabaseException(connectionfd, "prepareOperator\0", "Ensure the format of the query is \"prepare(name,statement)\"\0", NULL);
         return;
     }
-    else if (strstr(query, "\"") == NULL)
+    else if (findPreparedStatement(currentSession->preparedStatements, name) != NULL)
     {
-        raiseDatabaseException(connectionfd, "loadOperator\0", "Filename needs quotations around it\0", NULL);
+        raiseDatabaseException(connectionfd, "prepareOperator\0", "The prepared statement ~ already exists\0", name);
         return;
     }
 
-    // parse the query
-    char* lasts;
-    strtok_r(query, "\"", &lasts);
-    char* fileName = strtok_r(NULL, "\"", &lasts);
+    // tokenize the statement, which may not itself prepare or execute statements
+    preparedStatement* prepared = createPreparedStatement(name, statement);
+    if ((prepared == NULL) || (prepared->statement.command->function == prepareOperator) ||
+        (prepared->statement.command->function == executeOperator))
+    {
+        raiseDatabaseException(connectionfd, "prepareOperator\0", "The statement ~ cannot be prepared\0", statement);
+        destroyPreparedStatements(prepared);
+        return;
+    }
+    prepared->next = currentSession->preparedStatements;
+    currentSession->preparedStatements = prepared;
 
-    // create a path to the csvTables folder with that filename
-    char* filePath = malloc(strlen(fileName) + 11);
-    sprintf(filePath, "csvTables/%s", fileName);
-    filePath[strlen(fileName) + 10] = '\0';
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Prepared the statement `\0", name, "`.\0");
+    if (message == NULL)
+    {
+        printf("Prepare operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
 
-    // try to open the file
-    FILE* fp = fopen(filePath, "r");
-    if (fp == NULL)
+/*
+ *  executeOperator()
+ *  Is used to execute a prepared statement, e.g. execute(q,s1,10,20). The parameters
+ *  are bound in order and the statement is evaluated without being parsed again.
+ */
+void executeOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
     {
-        raiseDatabaseException(connectionfd, "loadOperator\0", "The file ~ does not exist in the database\0", fileName);
-        free(filePath);
+        raiseDatabaseException(connectionfd, "executeOperator\0", "Query was NULL\0", NULL);
         return;
     }
 
-    // get all of the columns in the file
-    char* columnBuffer = malloc(10 * BUFSIZ);
-    int columnBufferIndex = 0;
-    int numberOfColumns = 1;
-    while(!feof(fp))
+    // find the prepared statement
+    char* name = queryArgument(query, 0);
+    if (name == NULL)
     {
-        char character = fgetc(fp);
-        if (character == '\n')
-        {
-            columnBuffer[columnBufferIndex++] = '\0';
-            break;
-        }
-        else if (character == ',')
-        {
-            numberOfColumns++;
-        }
-        columnBuffer[columnBufferIndex++] = character;
+        raiseDatabaseException(connectionfd, "executeOperator\0", "Ensure the format of the query is \"execute(name,parameters...)\"\0", NULL);
+        return;
+    }
+    preparedStatement* prepared = findPreparedStatement(currentSession->preparedStatements, name);
+    if (prepared == NULL)
+    {
+        raiseDatabaseException(connectionfd, "executeOperator\0", "The prepared statement ~ does not exist\0", name);
+        return;
     }
 
-    // create an array of all the column names
-    char** columnNames = malloc(numberOfColumns * sizeof(char*));
-    char* position;
-    for (int i = 0; i < numberOfColumns; i++)
+    // bind the parameters and evaluate the statement
+    parsedQuery bound;
+    if (!bindPreparedStatement(prepared, query->arguments + 1, query->numberOfArguments - 1, &bound))
     {
-        // copy the string
-        char* parsedColumnName = (i == 0) ? strtok_r(columnBuffer, ",", &position) : strtok_r(NULL, ",", &position);
-        char* columnName = malloc(strlen(parsedColumnName) + 1);
-        strncpy(columnName, parsedColumnName, strlen(parsedColumnName));
-        columnNames[i] = columnName;
+        raiseDatabaseException(connectionfd, "executeOperator\0", "The wrong number of parameters was given to the prepared statement ~\0", name);
+        return;
+    }
+    executeParsedQuery(connectionfd, &bound);
+}
 
-        // make sure the column exists in the database
-        char* columnPath = malloc(strlen(columnName) + 4);
-        sprintf(columnPath, "db/%s", columnName);
-        FILE* columnFp = fopen(columnPath, "rb");
-        if (columnFp == NULL)
+/*
+ *  statsOperator()
+ *  Is used to report the server's metrics: latency percentiles of each command,
+ *  throughput, I/O, selectivity, cache hit rates, and intermediate memory.
+ */
+void statsOperator(int connectionfd, parsedQuery* query)
+{
+    char* report = createMetricsReport();
+    writeResponseToClient(connectionfd, report);
+    free(report);
+}
+
+/*
+ *  traceOperator()
+ *  Is used to control tracing: trace(on) and trace(off) start and stop recording, and
+ *  trace() writes the events recorded so far to the trace file as Chrome trace JSON
+ *  (open it in chrome://tracing or Perfetto).
+ */
+void traceOperator(int connectionfd, parsedQuery* query)
+{
+    char* action = queryArgument(query, 0);
+    char message[BUFSIZ];
+    if ((action != NULL) && (strcmp(action, "on") == 0))
+    {
+        tracingEnabled = true;
+        snprintf(message, sizeof(message), "Tracing is on, write the trace to `%s` with trace().", traceFile);
+    }
+    else if ((action != NULL) && (strcmp(action, "off") == 0))
+    {
+        tracingEnabled = false;
+        snprintf(message, sizeof(message), "Tracing is off.");
+    }
+    else if ((action == NULL) || (strcmp(action, "flush") == 0))
+    {
+        long long written = writeTrace(traceFile);
+        if (written < 0)
         {
-            raiseDatabaseException(connectionfd, "loadOperator\0", "Could not load file into database, create a database file for the column ~ first\0", columnName);
-            for (int j = 0; j < i; j++)
-            {
-                free(columnNames[j]);
-            }
-            free(columnNames);
-            free(columnName);
-            free(columnPath);
-            free(columnBuffer);
-            free(filePath);
-            fclose(fp);
+            raiseDatabaseException(connectionfd, "traceOperator\0", "Could not open the trace file ~\0", traceFile);
             return;
         }
+        snprintf(message, sizeof(message), "Wrote %lld trace events to `%s`.", written, traceFile);
+    }
+    else
+    {
+        raiseDatabaseException(connectionfd, "traceOperator\0", "Ensure the format of the query is \"trace(on|off|flush)\"\0", NULL);
+        return;
     }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
 
-    // create the an array for storing the integers
-    int** columnData = malloc(numberOfColumns * sizeof(int*));
-    for (int i = 0; i < numberOfColumns; i++)
+/*
+ *  compressOperator()
+ *  Is how a client negotiates compressed results: compress(on) has large results sent
+ *  to it in compressed frames, which it decodes as they arrive, compress(off) sends
+ *  them raw again.
+ */
+void compressOperator(int connectionfd, parsedQuery* query)
+{
+    char* action = queryArgument(query, 0);
+    char message[BUFSIZ];
+    if ((action != NULL) && (strcmp(action, "on") == 0) && (query->numberOfArguments == 1))
+    {
+        currentSession->compressResults = true;
+        snprintf(message, sizeof(message), "Results of at least %d values are compressed.", COMPRESSED_RESPONSE_VALUES);
+    }
+    else if ((action != NULL) && (strcmp(action, "off") == 0) && (query->numberOfArguments == 1))
     {
-        columnData[i] = malloc(BUFSIZ * sizeof(int));
+        currentSession->compressResults = false;
+        snprintf(message, sizeof(message), "Results are not compressed.");
+    }
+    else
+    {
+        raiseDatabaseException(connectionfd, "compressOperator\0", "Ensure the format of the query is \"compress(on|off)\"\0", NULL);
+        return;
     }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
 
-    // variables for reading
-    int currentArrayIndex = 0;
-    int currentArraySize = BUFSIZ * sizeof(int);
-    size_t sizeForGetline = BUFSIZ * sizeof(int);
-    char* readingBuffer = malloc(BUFSIZ * sizeof(int));
-    char* location = NULL;
+/*
+ *  createMetricsReport()
+ *  Returns a report of the server's metrics (one "name: value" per line, followed by a
+ *  latency table) in a buffer on the heap.
+ */
+char* createMetricsReport(void)
+{
+    // gather the counters
+    metricsSnapshot* snapshot = malloc(sizeof(metricsSnapshot));
+    takeMetricsSnapshot(snapshot);
+    pthread_mutex_lock(&resultCacheLock);
+    long long hits = resultCacheHits;
+    long long misses = resultCacheMisses;
+    size_t cacheBytes = resultCacheBytes;
+    pthread_mutex_unlock(&resultCacheLock);
+    double uptime = serverUptime();
 
-    // read data
-    while (getline(&readingBuffer, &sizeForGetline, fp) != -1)
+    // write the report
+    size_t reportSize = 1024 + ((NUMBER_OF_COMMANDS + 1) * 128);
+    char* report = malloc(reportSize);
+    int reportLength = snprintf(report, reportSize,
+        "uptime_seconds: %.3f\nqueries: %lld\nqueries_per_second: %.3f\nbytes_read: %lld\nrows_scanned: %lld\n"
+        "rows_selected: %lld\nresult_cache_hits: %lld\nresult_cache_misses: %lld\nresult_cache_hit_rate: %.3f\n"
+        "result_cache_bytes: %zu\nintermediate_memory_bytes: %lld\nlatency_us: command count p50 p99 p999",
+        uptime, snapshot->queries, (uptime > 0) ? snapshot->queries / uptime : 0.0, snapshot->bytesRead,
+        snapshot->rowsScanned, snapshot->rowsSelected, hits, misses, (hits + misses > 0) ? (double)hits / (hits + misses) : 0.0,
+        cacheBytes, __atomic_load_n(&intermediateMemoryInUse, __ATOMIC_RELAXED));
+    for (int i = 0; i <= NUMBER_OF_COMMANDS; i++)
     {
-        for (int i = 0; i < numberOfColumns; i++)
+        int command = (i == NUMBER_OF_COMMANDS) ? METRICS_BATCH : i;
+        long long* histogram = snapshot->latencyHistograms[command];
+        long long count = latencyCount(histogram);
+        if (count > 0)
         {
-            // parse and create an integer
-            char* buf = (i == 0) ? strtok_r(readingBuffer, ",\n", &location) : strtok_r(NULL, ",\n", &location);
+            reportLength += snprintf(report + reportLength, reportSize - reportLength, "\n%s %lld %lld %lld %lld",
+                                     (command == METRICS_BATCH) ? "batch" : commands[command].name, count,
+                                     latencyPercentile(histogram, 0.5), latencyPercentile(histogram, 0.99), latencyPercentile(histogram, 0.999));
+        }
+    }
+    free(snapshot);
+    return report;
+}
+
+/*
+ *  dumpMetricsPeriodically()
+ *  Appends a report of the server's metrics to the metrics file every metricsInterval
+ *  seconds. Runs on its own thread.
+ */
+void* dumpMetricsPeriodically(void* arguments)
+{
+    while (1)
+    {
+        sleep(metricsInterval);
+        char* report = createMetricsReport();
+        FILE* fp = fopen(metricsFile, "a");
+        if (fp != NULL)
+        {
+            fprintf(fp, "=====\n%s\n", report);
+            fclose(fp);
+        }
+        free(report);
+    }
+    return NULL;
+}
+
+/*
+ *  profileOperator()
+ *  Is used to evaluate a query, e.g. profile(s=select(a,0,10)), and return its response
+ *  followed by a breakdown of where its time went (parse, I/O, execution, response),
+ *  the bytes and rows it touched, and hardware counters if perf_event_open is available.
+ */
+void profileOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "profileOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+    char* profiledQuery = queryArgument(query, 0);
+    if ((profiledQuery == NULL) || (query->numberOfArguments != 1))
+    {
+        raiseDatabaseException(connectionfd, "profileOperator\0", "Ensure the format of the query is \"profile(query)\"\0", NULL);
+        return;
+    }
+    else if (currentQueryProfile != NULL)
+    {
+        raiseDatabaseException(connectionfd, "profileOperator\0", "Profiles cannot be nested\0", NULL);
+        return;
+    }
+
+    // collect the profiled query's responses
+    char* enclosingResponse = batchResponse;
+    int enclosingResponseLength = batchResponseLength;
+    batchResponse = malloc(1);
+    batchResponse[0] = '\0';
+    batchResponseLength = 0;
+
+    // evaluate the query
+    queryProfile profile;
+    memset(&profile, 0, sizeof(queryProfile));
+    currentQueryProfile = &profile;
+    startPerformanceCounters(&profile);
+    long long start = monotonicNanoseconds();
+    parseQuery(connectionfd, arenaStringCopy(&currentSession->queryArena, profiledQuery));
+    profile.totalNanoseconds = monotonicNanoseconds() - start;
+    stopPerformanceCounters(&profile);
+    currentQueryProfile = NULL;
+    char* profiledResponse = batchResponse;
+    batchResponse = enclosingResponse;
+    batchResponseLength = enclosingResponseLength;
+
+    // write the responses followed by the profile
+    long long executionNanoseconds = profile.totalNanoseconds;
+    for (int phase = 0; phase < PROFILE_PHASES; phase++)
+    {
+        executionNanoseconds -= profile.phaseNanoseconds[phase];
+    }
+    char* response = arenaAllocate(&currentSession->queryArena, strlen(profiledResponse) + 1024);
+    int responseLength = sprintf(response,
+        "%s-----\ntotal_us: %.1f\nparse_us: %.1f\nio_us: %.1f\nexecute_us: %.1f\nresponse_us: %.1f\n"
+        "bytes_touched: %lld\nrows_in: %lld\nrows_out: %lld",
+        profiledResponse, profile.totalNanoseconds / 1000.0, profile.phaseNanoseconds[PROFILE_PARSE] / 1000.0,
+        profile.phaseNanoseconds[PROFILE_IO] / 1000.0, ((executionNanoseconds > 0) ? executionNanoseconds : 0) / 1000.0,
+        profile.phaseNanoseconds[PROFILE_RESPONSE] / 1000.0, profile.bytesTouched, profile.rowsIn, profile.rowsOut);
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        if (profile.countersAvailable)
+            responseLength += sprintf(response + responseLength, "\n%s: %lld", profileCounterNames[i], profile.counters[i]);
+        else
+            responseLength += sprintf(response + responseLength, "\n%s: unavailable", profileCounterNames[i]);
+    }
+    free(profiledResponse);
+    writeResponseToClient(connectionfd, response);
+}
+
+/*
+ *  create()
+ *  Is used to create a column (represented as a binary file on disk) in the 
+ *  database.
+ */
+void createOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    // the value type and the partitioning spec are optional, and either may come first
+    char* column = queryArgument(query, 0);
+    char* storage = queryArgument(query, 1);
+    char* typeName = queryArgument(query, 2);
+    char* partitionSpec = queryArgument(query, 3);
+    if ((typeName != NULL) && (strchr(typeName, '(') != NULL))
+    {
+        partitionSpec = typeName;
+        typeName = queryArgument(query, 3);
+    }
+    if (column == NULL || storage == NULL)
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The specified column or storage was NULL\0", NULL);
+        return;
+    }
+    else if (!((strcmp(storage, "unsorted") == 0) || (strcmp(storage, "sorted") == 0) || (strcmp(storage, "b+tree") == 0)))
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The specified storage does not match unsorted, sorted, or b+tree\0", NULL);
+        return;
+    }
+
+    // capture the storage type
+    int storageId = (strcmp(storage, "unsorted") == 0) ? UNSORTED : 
+                       ((strcmp(storage, "sorted") == 0)   ? SORTED  :
+                       ((strcmp(storage, "b+tree") == 0)   ? BTREE   : -1));
+    if ((storageId != UNSORTED) && (storageId != SORTED) && (storageId != BTREE))
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The specified storage does not match the storage id for either unsorted, sorted, or b+tree\0", NULL);
+        return;
+    }
+
+    // capture the type of the column's values (int32 if none is given), stored above the storage type
+    int valueType = (typeName == NULL) ? COLUMN_INT32 : findColumnType(typeName);
+    if (valueType == -1)
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The type ~ does not match int8, int16, int32, or int64\0", typeName);
+        return;
+    }
+    storageId |= valueType << COLUMN_TYPE_SHIFT;
+
+    // capture how the column is partitioned, if it is: range(key,bound,...) or hash(key,buckets)
+    partitionDirectory directory;
+    if ((partitionSpec != NULL) && !parsePartitionSpec(partitionSpec, &directory))
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The partitioning of the column ~ does not match range(key,bound,...) with increasing bounds or hash(key,buckets)\0", column);
+        return;
+    }
+
+    // error check and create the file
+    char* path = arenaAllocate(&currentSession->queryArena, 4 + strlen(column));
+    sprintf(path, "db/%s", column);
+    if (path == NULL)
+    {
+        raiseDatabaseException(connectionfd, "createOperator\0", "The path for the column ~ was NULL\0", column);
+        return;
+    }
+
+    // the file is written as a new segment of the column, replacing the one readers see once published.
+    // a partitioned column is written as its partition directory and an empty segment per partition
+    beginColumnWrites();
+    if (partitionSpec != NULL)
+    {
+        bool published = false;
+        if (createPartitionedColumn(column, storageId, &directory))
+            published = publishColumnWrites();
+        else
+            abortColumnWrites();
+        if (!published)
+        {
+            raiseDatabaseException(connectionfd, "createOperator\0", "Could not replace the files of the partitioned column ~\0", column);
+            return;
+        }
+    }
+    FILE* fp = (partitionSpec != NULL) ? NULL : createColumnSegment(column);
+    if ((fp == NULL) && (partitionSpec == NULL))
+    {
+        abortColumnWrites();
+        raiseDatabaseException(connectionfd, "createOperator\0", "The filepointer created for the path ~ was NULL\0", path);
+        return;
+    }
+
+    // write header data to the file. header consists of storage type and the number of bytes in the file
+    int bytesInFile = 0;
+    if (fp != NULL)
+    {
+        fwrite(&storageId, sizeof(int), 1, fp);
+        fwrite(&bytesInFile, sizeof(int), 1, fp);
+        bool staged = stageColumnSegment(column, fp);
+        bool published = publishColumnWrites();
+        if (!staged || !published)
+        {
+            raiseDatabaseException(connectionfd, "createOperator\0", "Could not replace the file at the path ~\0", path);
+            return;
+        }
+    }
+    invalidateCrackerColumn(column);
+    updateColumnStatistics(column, NULL, 0);
+    updateColumnSketches(column, NULL, 0);
+    invalidateColumnInResultCache(column);
+
+    // create a message and write it to the client
+    char* prefix = "Created column `\0";
+    char* suffix = "` in the database.\0";
+    char* message = createCustomMessage(connectionfd, prefix, column, suffix);
+    if (message == NULL)
+    {
+        printf("Create operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+
+    // print the message in the server and cleanup
+    printf("%s\n", message);
+}
+
+/*
+ *  createPartitionedColumn()
+ *  Stages the files of a new partitioned column: an empty segment for each of its
+ *  partitions, and its partition directory. The caller holds the writers lock and
+ *  publishes them. Returns false if a file could not be written.
+ */
+bool createPartitionedColumn(char* column, int storageId, partitionDirectory* directory)
+{
+    char name[strlen(column) + 16];
+    int bytesInFile = 0;
+    for (int i = 0; i < directory->numberOfPartitions; i++)
+    {
+        partitionColumnName(column, i, name);
+        FILE* fp = createColumnSegment(name);
+        if ((fp == NULL) || (fwrite(&storageId, sizeof(int), 1, fp) != 1) || (fwrite(&bytesInFile, sizeof(int), 1, fp) != 1))
+        {
+            if (fp != NULL)
+                discardColumnSegment(name, fp);
+            return false;
+        }
+        if (!stageColumnSegment(name, fp))
+        {
+            return false;
+        }
+    }
+
+    // the directory goes in the column's own file
+    int headerStorageType = storageId | PARTITIONED_COLUMN;
+    int headerStorageSize = sizeof(partitionDirectory);
+    FILE* fp = createColumnSegment(column);
+    bool written = (fp != NULL) && (fwrite(&headerStorageType, sizeof(int), 1, fp) == 1) &&
+                   (fwrite(&headerStorageSize, sizeof(int), 1, fp) == 1) && (fwrite(directory, sizeof(partitionDirectory), 1, fp) == 1);
+    if (!written && (fp != NULL))
+    {
+        discardColumnSegment(column, fp);
+    }
+    return written && stageColumnSegment(column, fp);
+}
+
+/*
+ *  select()
+ *  Is used to return the positions of matching data in the query. The result is either
+ *  stored in a variable or returned to the user right away. A select over a column may
+ *  be given a Bloom filter as its last argument, e.g. select(column,low,high,filter),
+ *  to only select the values the filter may hold.
+ */
+void selectOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // make sure the user is storing the result
+    char* variableName = query->outputVariable;
+    if (variableName == NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "The result of a select must be stored in an intermediate variable\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* firstArgument = queryArgument(query, 0);
+    char* secondArgument = queryArgument(query, 1);
+    char* thirdArgument = queryArgument(query, 2);
+    char* fourthArgument = queryArgument(query, 3);
+    if (variableName == NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "variableName was NULL\0", NULL);
+        return;
+    }
+    else if (firstArgument == NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "firstArgument of the query was NULL\0", NULL);
+        return;
+    }
+
+    // make sure variable name is unique
+    if (lookupIntermediateResult(currentSession, variableName) != NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "The variable ~ already exists in memory, please rename the current intermediate result variable\0", variableName);
+        return;
+    }
+
+    // a Bloom filter (e.g. of the keys of the other side of a join) is applied during the scan, so the
+    // rows it rules out are never materialized. such selects bypass the result cache and cracker copies
+    int numberOfValidPositions;
+    int* validPositionsInArray;
+    intermediateResult* basePositions = lookupIntermediateResult(currentSession, firstArgument);
+    char* filterName = selectFilterArgument(query);
+    intermediateResult* filter = (filterName == NULL) ? NULL : lookupIntermediateResult(currentSession, filterName);
+    if ((filterName != NULL) && ((filter == NULL) || (filter->resultType != BLOOM_FILTER)))
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "The variable ~ does not exist or does not hold a Bloom filter\0", filterName);
+        return;
+    }
+    else if ((filter != NULL) && (((basePositions != NULL) && (basePositions->resultType == POSITION_LIST)) || (query->numberOfArguments > 4)))
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "A Bloom filter only prefilters a select over a column, ensure the format of the query is \"select(column,low,high,filter)\"\0", NULL);
+        return;
+    }
+    if (filter != NULL)
+    {
+        char* low = (query->numberOfArguments >= 3) ? secondArgument : NULL;
+        char* high = (query->numberOfArguments == 4) ? thirdArgument : NULL;
+        validPositionsInArray = scanColumnWithBloomFilter(connectionfd, firstArgument, low, high, filter, &numberOfValidPositions);
+    }
+
+    // if selecting on an existing position list, refine it using the values fetched at those positions
+    else if ((basePositions != NULL) && (basePositions->resultType == POSITION_LIST))
+    {
+        validPositionsInArray = refinePositions(connectionfd, basePositions, secondArgument, thirdArgument, fourthArgument, &numberOfValidPositions);
+    }
+    else if (fourthArgument != NULL)
+    {
+        raiseDatabaseException(connectionfd, "selectOperator\0", "The variable ~ does not exist or does not hold positions\0", firstArgument);
+        return;
+    }
+
+    // answer the select from the result cache if possible. the cache and cracker copies hold the
+    // newest version of the column, so a query whose snapshot is older scans its own version instead
+    // (cached results are keyed on the version of the segment in the query's snapshot, so a result
+    // computed on a segment a load just replaced is never used or cached as newer)
+    // (both hold values widened to ints, so bounds outside the range of an int always scan)
+    else
+    {
+        long long lowBound = (secondArgument == NULL) ? INT_MIN : atoll(secondArgument);
+        long long highBound = (secondArgument == NULL) ? INT_MAX : ((thirdArgument == NULL) ? lowBound : atoll(thirdArgument));
+        int low = (int)lowBound;
+        int high = (int)highBound;
+        unsigned long long version = columnSnapshotVersion(firstArgument);
+        bool current = isColumnSnapshotCurrent(firstArgument) && (low == lowBound) && (high == highBound);
+        validPositionsInArray = current ? lookupResultCache(firstArgument, version, low, high, &numberOfValidPositions) : NULL;
+        if (validPositionsInArray != NULL)
+        {
+            profileRows(0, numberOfValidPositions);
+        }
+
+        // otherwise answer it from the column's cracker copy if cracking is enabled for it, or scan it
+        if (validPositionsInArray == NULL)
+        {
+            int* selectedValues = NULL;
+            crackerColumn* cracker = current ? findCrackerColumn(firstArgument) : NULL;
+            validPositionsInArray = (cracker != NULL)
+                ? selectFromCrackerColumn(connectionfd, cracker, firstArgument, secondArgument, thirdArgument, &numberOfValidPositions, &selectedValues)
+                : scanColumnForPositions(connectionfd, firstArgument, secondArgument, thirdArgument, &numberOfValidPositions, &selectedValues);
+            if ((validPositionsInArray != NULL) && current && (selectedValues != NULL))
+            {
+                insertIntoResultCache(firstArgument, version, low, high, validPositionsInArray, selectedValues, numberOfValidPositions);
+            }
+            else if (validPositionsInArray != NULL)
+            {
+                free(selectedValues);
+            }
+        }
+    }
+    if (validPositionsInArray == NULL)
+    {
+        return;
+    }
+
+    // store the result in an intermediate variable
+    intermediateResult* variable = createIntermediateResult(variableName, POSITION_LIST);
+    variable->numberOfValidPositions = numberOfValidPositions;
+    variable->validPositions = poolShrink(validPositionsInArray, numberOfValidPositions * sizeof(int), (numberOfValidPositions + 1) * sizeof(int));
+
+    // store the intermediate variable
+    insertIntermediateResult(currentSession, variable);
+    // printIntermediateResults(currentSession);
+
+    // create a message and write it to the client
+    char* prefix = ((basePositions != NULL) && (basePositions->resultType == POSITION_LIST)) ? "Refined the valid positions in `\0" : "Selected valid positions from the column `\0";
+    char* suffix = "`.\0";
+    char* message = createCustomMessage(connectionfd, prefix, firstArgument, suffix);
+    if (message == NULL)
+    {
+        printf("Select operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+
+    // print the message in the server and cleanup
+    printf("%s\n", message);
+}
+
+/*
+ *  scanColumnForPositions()
+ *  Scans a column and returns the positions of the values matching a select's
+ *  arguments (none, one value, or a range). If selectedValues is not NULL, the values
+ *  at those positions are returned in it as well. Returns NULL on error.
+ */
+int* scanColumnForPositions(int connectionfd, char* column, char* secondArgument, char* thirdArgument, int* numberOfPositions, int** selectedValues)
+{
+    // a partitioned column is scanned a partition at a time, skipping those the predicate cannot match
+    partitionDirectory directory;
+    if (readPartitionDirectory(column, &directory))
+    {
+        long long low = (secondArgument == NULL) ? LLONG_MIN : atoll(secondArgument);
+        long long high = (secondArgument == NULL) ? LLONG_MAX : ((thirdArgument != NULL) ? atoll(thirdArgument) : low);
+        return scanPartitionedColumn(connectionfd, column, &directory, low, high, numberOfPositions, selectedValues);
+    }
+
+    // read all data from the column into a buffer
+    int numberOfValuesInColumn;
+    int valueType;
+    void* arrayOfFileData = readColumnFromDisk(connectionfd, "scanColumnForPositions\0", column, &numberOfValuesInColumn, &valueType);
+    if (arrayOfFileData == NULL)
+    {
+        return NULL;
+    }
+
+    // positions are written straight into the result array, which is shrunk once the scan is done
+    int* validPositionsInArray = poolAllocate((numberOfValuesInColumn + 1) * sizeof(int));
+    int numberOfValidPositions = 0;
+
+    // if selecting on the entire column
+    if ((secondArgument == NULL) && (thirdArgument == NULL))
+    {
+        // add all positions as valid
+        for (int i = 0; i < numberOfValuesInColumn; i++)
+            validPositionsInArray[numberOfValidPositions++] = i;
+    }
+    // if selecting the locations of just one value, or between two values
+    else if (secondArgument != NULL)
+    {
+        long long low = atoll(secondArgument);
+        long long high = (thirdArgument != NULL) ? atoll(thirdArgument) : low;
+        numberOfValidPositions = selectKernels[valueType](arrayOfFileData, numberOfValuesInColumn, low, high, validPositionsInArray);
+    }
+    // error checking
+    else
+    {
+        raiseDatabaseException(connectionfd, "scanColumnForPositions\0", "secondArgument was NULL and thirdArgument was not, which cannot happen in a valid query\0", NULL);
+        poolFree(validPositionsInArray);
+        free(arrayOfFileData);
+        return NULL;
+    }
+
+    // gather the selected values (widened to ints) if asked for. int64 values do not fit, so none
+    // are returned for them
+    if ((selectedValues != NULL) && (valueType == COLUMN_INT64))
+    {
+        *selectedValues = NULL;
+    }
+    else if (selectedValues != NULL)
+    {
+        void* gathered = malloc((size_t)(numberOfValidPositions + 1) * columnTypeWidths[valueType]);
+        gatherKernels[valueType](arrayOfFileData, numberOfValuesInColumn, validPositionsInArray, numberOfValidPositions, gathered);
+        if (valueType == COLUMN_INT32)
+        {
+            *selectedValues = gathered;
+        }
+        else
+        {
+            *selectedValues = malloc((numberOfValidPositions + 1) * sizeof(int));
+            widenKernels[valueType](gathered, numberOfValidPositions, *selectedValues);
+            free(gathered);
+        }
+    }
+    free(arrayOfFileData);
+    recordRowsSelected(numberOfValuesInColumn, numberOfValidPositions);
+    *numberOfPositions = numberOfValidPositions;
+    return validPositionsInArray;
+}
+
+/*
+ *  selectFilterArgument()
+ *  Returns the name of the Bloom filter a select is given as its last argument (its
+ *  bounds are numbers, a filter is a variable), NULL if it is given none.
+ */
+char* selectFilterArgument(parsedQuery* query)
+{
+    if (query->numberOfArguments < 2)
+    {
+        return NULL;
+    }
+    char* last = query->arguments[query->numberOfArguments - 1];
+    char* end;
+    strtoll(last, &end, 10);
+    return ((end == last) || (*end != '\0')) ? last : NULL;
+}
+
+/*
+ *  scanColumnWithBloomFilter()
+ *  Scans a column for the positions of the values matching a select's value or range
+ *  (or of all of them) that a Bloom filter may hold, testing the predicate and the
+ *  filter in the same branch free pass. Returns NULL on error.
+ */
+int* scanColumnWithBloomFilter(int connectionfd, char* column, char* secondArgument, char* thirdArgument, intermediateResult* filterVariable, int* numberOfPositions)
+{
+    int numberOfValuesInColumn;
+    int valueType;
+    void* arrayOfFileData = readColumnFromDisk(connectionfd, "scanColumnWithBloomFilter\0", column, &numberOfValuesInColumn, &valueType);
+    if (arrayOfFileData == NULL)
+    {
+        return NULL;
+    }
+    long long low = (secondArgument == NULL) ? LLONG_MIN : atoll(secondArgument);
+    long long high = (secondArgument == NULL) ? LLONG_MAX : ((thirdArgument != NULL) ? atoll(thirdArgument) : low);
+    bloomFilter filter;
+    filter.words = filterVariable->values;
+    filter.numberOfBlocks = filterVariable->numberOfValues / BLOOM_BLOCK_WORDS;
+    int* validPositionsInArray = poolAllocate((numberOfValuesInColumn + 1) * sizeof(int));
+    int numberOfValidPositions = bloomKernels[valueType](arrayOfFileData, numberOfValuesInColumn, low, high, &filter, validPositionsInArray);
+    free(arrayOfFileData);
+    recordRowsSelected(numberOfValuesInColumn, numberOfValidPositions);
+    *numberOfPositions = numberOfValidPositions;
+    return validPositionsInArray;
+}
+
+/*
+ *  refinePositions()
+ *  Returns the subset of a position list whose fetched values (stored in the variable
+ *  valuesName, aligned with the positions) match a select's value or range. Only the
+ *  qualifying positions are touched. Returns NULL on error.
+ */
+int* refinePositions(int connectionfd, intermediateResult* positions, char* valuesName, char* thirdArgument, char* fourthArgument, int* numberOfPositions)
+{
+    // error checking
+    intermediateResult* values = (valuesName == NULL) ? NULL : lookupIntermediateResult(currentSession, valuesName);
+    if ((values == NULL) || (values->resultType != VALUE_LIST))
+    {
+        raiseDatabaseException(connectionfd, "refinePositions\0", "The variable ~ does not exist or does not hold values\0", (valuesName == NULL) ? "NULL\0" : valuesName);
+        return NULL;
+    }
+    else if (values->numberOfValues != positions->numberOfValidPositions)
+    {
+        raiseDatabaseException(connectionfd, "refinePositions\0", "The values in ~ are not aligned with the position list\0", valuesName);
+        return NULL;
+    }
+    else if (thirdArgument == NULL)
+    {
+        raiseDatabaseException(connectionfd, "refinePositions\0", "Ensure the format of the query is \"variableName=select(positions,values,low,high)\"\0", NULL);
+        return NULL;
+    }
+
+    // keep the positions whose values are bound by the two values (or match the one value)
+    long long low = atoll(thirdArgument);
+    long long high = (fourthArgument != NULL) ? atoll(fourthArgument) : low;
+    int* validPositionsInArray = poolAllocate((positions->numberOfValidPositions + 1) * sizeof(int));
+    int numberOfValidPositions = refineKernels[values->valueType](values->values, positions->validPositions,
+                                                                  positions->numberOfValidPositions, low, high, validPositionsInArray);
+    recordRowsSelected(positions->numberOfValidPositions, numberOfValidPositions);
+    *numberOfPositions = numberOfValidPositions;
+    return validPositionsInArray;
+}
+
+/*
+ *  selectFromCrackerColumn()
+ *  Answers a select from the cracker copy of a column, cracking it around the bounds
+ *  of the predicate. Returns the original row ids of the matching values (and the values
+ *  themselves in selectedValues, if not NULL), NULL on error.
+ */
+int* selectFromCrackerColumn(int connectionfd, crackerColumn* cracker, char* column, char* secondArgument, char* thirdArgument, int* numberOfValidPositions, int** selectedValues)
+{
+    // capture the predicate
+    int low = INT_MIN;
+    int high = INT_MAX;
+    if (secondArgument != NULL)
+    {
+        low = atoi(secondArgument);
+        high = (thirdArgument != NULL) ? atoi(thirdArgument) : low;
+    }
+
+    // concurrent selects on the same column crack it one at a time
+    long long waitStart = traceStart();
+    pthread_mutex_lock(&cracker->lock);
+    traceEnd("cracker_lock", "wait", waitStart, NULL, 0);
+    unsigned long long version = columnSnapshotVersion(column);
+    if (cracker->loaded && (cracker->version != version))
+    {
+        unloadCrackerColumn(cracker);
+    }
+    if (!cracker->loaded)
+    {
+        int numberOfValuesInColumn;
+        int valueType;
+        void* arrayOfFileData = readColumnFromDisk(connectionfd, "selectFromCrackerColumn\0", column, &numberOfValuesInColumn, &valueType);
+        if (arrayOfFileData == NULL)
+        {
+            pthread_mutex_unlock(&cracker->lock);
+            return NULL;
+        }
+
+        // int64 values do not fit the cracker copy (the column was cracked before it was created
+        // again as int64), so the column is scanned instead
+        if (valueType == COLUMN_INT64)
+        {
+            free(arrayOfFileData);
+            pthread_mutex_unlock(&cracker->lock);
+            return scanColumnForPositions(connectionfd, column, secondArgument, thirdArgument, numberOfValidPositions, selectedValues);
+        }
+
+        // the cracker copy holds ints, so narrower values are widened into it
+        if (valueType != COLUMN_INT32)
+        {
+            int* widened = malloc((numberOfValuesInColumn + 1) * sizeof(int));
+            widenKernels[valueType](arrayOfFileData, numberOfValuesInColumn, widened);
+            free(arrayOfFileData);
+            arrayOfFileData = widened;
+        }
+        loadCrackerColumn(cracker, arrayOfFileData, numberOfValuesInColumn, version);
+    }
+    int* validPositionsInArray;
+    *numberOfValidPositions = crackerSelect(cracker, low, high, &validPositionsInArray, selectedValues);
+    pthread_mutex_unlock(&cracker->lock);
+    profileRows(0, *numberOfValidPositions);
+    return validPositionsInArray;
+}
+
+/*
+ *  crackOperator()
+ *  Is used to enable cracking for a column. Selects on a cracked column reorganize a
+ *  copy of it around their bounds, so repeated selects converge toward an index.
+ */
+void crackOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "crackOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* column = queryArgument(query, 0);
+    if (column == NULL)
+    {
+        raiseDatabaseException(connectionfd, "crackOperator\0", "Ensure the format of the query is \"crack(column)\"\0", NULL);
+        return;
+    }
+
+    // make sure the column exists
+    int numberOfValuesInColumn;
+    int valueType;
+    FILE* fp = openColumnForReading(connectionfd, "crackOperator\0", column, &numberOfValuesInColumn, &valueType);
+    if (fp == NULL)
+    {
+        return;
+    }
+    fclose(fp);
+    if (valueType == COLUMN_INT64)
+    {
+        raiseDatabaseException(connectionfd, "crackOperator\0", "The column ~ holds int64 values, which cannot be cracked\0", column);
+        return;
+    }
+    enableCracking(column);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Enabled cracking for the column `\0", column, "`.\0");
+    if (message == NULL)
+    {
+        printf("Crack operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  fetchOperator()
+ *  Is used to fetch the values of a column at the positions stored in an
+ *  intermediate variable. The values are stored in a new intermediate variable.
+ */
+void fetchOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // make sure the user is storing the result
+    char* variableName = query->outputVariable;
+    if (variableName == NULL)
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "The result of a fetch must be stored in an intermediate variable\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* column = queryArgument(query, 0);
+    char* positionsName = queryArgument(query, 1);
+    if (variableName == NULL || column == NULL || positionsName == NULL)
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "Ensure the format of the query is \"variableName=fetch(column,positions)\"\0", NULL);
+        return;
+    }
+
+    // make sure variable name is unique and the positions exist
+    if (lookupIntermediateResult(currentSession, variableName) != NULL)
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "The variable ~ already exists in memory, please rename the current intermediate result variable\0", variableName);
+        return;
+    }
+    intermediateResult* positions = lookupIntermediateResult(currentSession, positionsName);
+    if ((positions == NULL) || (positions->resultType != POSITION_LIST))
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "The variable ~ does not exist or does not hold positions\0", positionsName);
+        return;
+    }
+
+    // read the column
+    int numberOfValuesInColumn;
+    int valueType;
+    void* arrayOfFileData = readColumnFromDisk(connectionfd, "fetchOperator\0", column, &numberOfValuesInColumn, &valueType);
+    if (arrayOfFileData == NULL)
+    {
+        return;
+    }
+
+    // gather the values at each position, as wide as the column's values
+    void* values = poolAllocate((size_t)(positions->numberOfValidPositions + 1) * columnTypeWidths[valueType]);
+    if (!gatherKernels[valueType](arrayOfFileData, numberOfValuesInColumn, positions->validPositions, positions->numberOfValidPositions, values))
+    {
+        raiseDatabaseException(connectionfd, "fetchOperator\0", "A position is out of bounds for the column ~\0", column);
+        poolFree(values);
+        free(arrayOfFileData);
+        return;
+    }
+    free(arrayOfFileData);
+    profileRows(positions->numberOfValidPositions, positions->numberOfValidPositions);
+
+    // store the result in an intermediate variable
+    intermediateResult* variable = createIntermediateResult(variableName, VALUE_LIST);
+    variable->values = values;
+    variable->valueType = valueType;
+    variable->numberOfValues = positions->numberOfValidPositions;
+    insertIntermediateResult(currentSession, variable);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Fetched values from the column `\0", column, "`.\0");
+    if (message == NULL)
+    {
+        printf("Fetch operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  initializeAggregateState()
+ *  Resets the running state of an aggregate.
+ */
+void initializeAggregateState(aggregateState* state)
+{
+    state->sum = 0;
+    state->min = LLONG_MAX;
+    state->max = LLONG_MIN;
+    state->count = 0;
+}
+
+/*
+ *  updateAggregateState()
+ *  Folds a vector of values (of the given type) into the running state of an aggregate.
+ */
+void updateAggregateState(aggregateState* state, void* values, int valueType, int numberOfValues)
+{
+    aggregateKernels[valueType](values, numberOfValues, &state->sum, &state->min, &state->max);
+    state->count += numberOfValues;
+}
+
+/*
+ *  storeAggregateResult()
+ *  Stores the final value of an aggregate (min, max, sum, or avg) in an intermediate
+ *  variable. Returns false if the aggregate is not defined for the values seen.
+ */
+bool storeAggregateResult(int connectionfd, char* function, intermediateResult* variable, char* aggregateName, aggregateState* state)
+{
+    // min, max, and avg are undefined for an empty vector
+    if ((state->count == 0) && (strcmp(aggregateName, "sum") != 0))
+    {
+        raiseDatabaseException(connectionfd, function, "Cannot compute ~ of an empty vector\0", aggregateName);
+        return false;
+    }
+
+    // store the result
+    variable->resultType = SCALAR_VALUE;
+    if (strcmp(aggregateName, "min") == 0)
+        variable->scalarValue = state->min;
+    else if (strcmp(aggregateName, "max") == 0)
+        variable->scalarValue = state->max;
+    else if (strcmp(aggregateName, "sum") == 0)
+        variable->scalarValue = state->sum;
+    else
+    {
+        variable->resultType = AVERAGE_VALUE;
+        variable->averageValue = (double)state->sum / state->count;
+    }
+    return true;
+}
+
+/*
+ *  aggregateOperator()
+ *  Is used to compute the min, max, sum, or avg of a vector of values stored in an
+ *  intermediate variable, or of a column. The result is stored in a new intermediate
+ *  variable. The aggregate of a column is answered from a materialized aggregate of
+ *  it, if there is one.
+ */
+void aggregateOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "aggregateOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* variableName = query->outputVariable;
+    char* aggregateName = query->commandName;
+    char* valuesName = queryArgument(query, 0);
+    if (variableName == NULL || aggregateName == NULL || valuesName == NULL)
+    {
+        raiseDatabaseException(connectionfd, "aggregateOperator\0", "Ensure the format of the query is \"variableName=aggregate(values)\"\0", NULL);
+        return;
+    }
+
+    // make sure variable name is unique and the values exist
+    if (lookupIntermediateResult(currentSession, variableName) != NULL)
+    {
+        raiseDatabaseException(connectionfd, "aggregateOperator\0", "The variable ~ already exists in memory, please rename the current intermediate result variable\0", variableName);
+        return;
+    }
+    aggregateState state;
+    initializeAggregateState(&state);
+    materializedAggregate materialized;
+    if ((lookupIntermediateResult(currentSession, valuesName) == NULL) &&
+        lookupMaterializedAggregate(MATERIALIZED_TOTAL, valuesName, NULL, 0, 0, &materialized))
+    {
+        state.sum = materialized.definition.sum;
+        state.min = materialized.definition.min;
+        state.max = materialized.definition.max;
+        state.count = (int)materialized.definition.count;
+        freeMaterializedAggregate(&materialized);
+        profileRows(0, 1);
+    }
+    else
+    {
+        // compute the aggregate
+        int numberOfValues;
+        int valueType;
+        bool readColumn;
+        void* values = readValuesArgument(connectionfd, "aggregateOperator\0", valuesName, &numberOfValues, &valueType, &readColumn);
+        if (values == NULL)
+        {
+            return;
+        }
+        updateAggregateState(&state, values, valueType, numberOfValues);
+        profileRows(numberOfValues, 1);
+        if (readColumn)
+        {
+            free(values);
+        }
+    }
+    intermediateResult* variable = createIntermediateResult(variableName, SCALAR_VALUE);
+    if (!storeAggregateResult(connectionfd, "aggregateOperator\0", variable, aggregateName, &state))
+    {
+        releaseIntermediateResult(variable);
+        return;
+    }
+    insertIntermediateResult(currentSession, variable);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Computed the aggregate of `\0", valuesName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Aggregate operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  groupOperator()
+ *  Is used to group the values of one or more vectors by the keys in another vector
+ *  (of the same length), computing the sum, min, or max of each vector of values (or
+ *  the number of rows) per distinct key. The vectors are variables or columns. The
+ *  distinct keys and the aggregates of each vector are stored in new intermediate
+ *  variables, in the same order. The sums or counts per key of a column are answered
+ *  from a materialized aggregate of them, if there is one.
+ */
+void groupOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "groupOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* functionName = queryArgument(query, 0);
+    char* keysName = queryArgument(query, 1);
+    int numberOfVectors = query->numberOfArguments - 2;
+    if ((query->outputVariable == NULL) || (functionName == NULL) || (keysName == NULL))
+    {
+        raiseDatabaseException(connectionfd, "groupOperator\0", "Ensure the format of the query is \"keys,aggregates=group(function,keys,values)\"\0", NULL);
+        return;
+    }
+    int function;
+    if (strcmp(functionName, "sum") == 0)
+        function = GROUP_SUM;
+    else if (strcmp(functionName, "min") == 0)
+        function = GROUP_MIN;
+    else if (strcmp(functionName, "max") == 0)
+        function = GROUP_MAX;
+    else if (strcmp(functionName, "count") == 0)
+        function = GROUP_COUNT;
+    else
+    {
+        raiseDatabaseException(connectionfd, "groupOperator\0", "Cannot aggregate groups with ~, the functions are sum, min, max, and count\0", functionName);
+        return;
+    }
+    if ((function == GROUP_COUNT) ? (numberOfVectors != 0) : (numberOfVectors < 1))
+    {
+        raiseDatabaseException(connectionfd, "groupOperator\0", "The function ~ takes a vector of values to aggregate per group (count takes none)\0", functionName);
+        return;
+    }
+
+    // one variable for the keys, then one per vector of values (or one for the counts)
+    int numberOfOutputs = 1 + ((function == GROUP_COUNT) ? 1 : numberOfVectors);
+    char** outputNames = arenaAllocate(&currentSession->queryArena, (numberOfOutputs + 1) * sizeof(char*));
+    int numberOfNames = splitOutputVariables(connectionfd, "groupOperator\0", query->outputVariable, outputNames, numberOfOutputs);
+    if (numberOfNames == -1)
+    {
+        return;
+    }
+    if (numberOfNames != numberOfOutputs)
+    {
+        raiseDatabaseException(connectionfd, "groupOperator\0", "Name a variable for the keys and one per vector of values (or one for the counts) in ~\0", query->outputVariable);
+        return;
+    }
+
+    // the sums or counts per key of a column are answered from a materialized aggregate of them, if
+    // there is one
+    groupResult groups;
+    int keyType = COLUMN_INT32;
+    char* valuesName = (numberOfVectors == 1) ? query->arguments[2] : NULL;
+    materializedAggregate materialized;
+    if (((function == GROUP_SUM) || (function == GROUP_COUNT)) && (numberOfVectors <= 1) &&
+        (lookupIntermediateResult(currentSession, keysName) == NULL) &&
+        ((valuesName == NULL) || (lookupIntermediateResult(currentSession, valuesName) == NULL)) &&
+        lookupMaterializedAggregate(MATERIALIZED_GROUPS, valuesName, keysName, 0, 0, &materialized))
+    {
+        int numberOfKeys;
+        FILE* keysFp = openColumnForReading(-1, NULL, keysName, &numberOfKeys, &keyType);
+        if (keysFp != NULL)
+        {
+            fclose(keysFp);
+        }
+        groups.numberOfGroups = materialized.definition.numberOfGroups;
+        groups.keys = materialized.keys;
+        groups.counts = materialized.counts;
+        groups.aggregates = NULL;
+        if (numberOfVectors > 0)
+        {
+            groups.aggregates = malloc(numberOfVectors * sizeof(long long*));
+            groups.aggregates[0] = materialized.sums;
+        }
+        else
+        {
+            free(materialized.sums);
+        }
+        profileRows(0, groups.numberOfGroups);
+    }
+    else
+    {
+        // make sure the keys and values (of variables or columns) exist and line up
+        int numberOfRows;
+        bool readColumn;
+        void* keys = readValuesArgument(connectionfd, "groupOperator\0", keysName, &numberOfRows, &keyType, &readColumn);
+        if (keys == NULL)
+        {
+            return;
+        }
+        void** vectors = arenaAllocate(&currentSession->queryArena, (numberOfVectors + 1) * sizeof(void*));
+        int* vectorTypes = arenaAllocate(&currentSession->queryArena, (numberOfVectors + 1) * sizeof(int));
+        bool* readColumns = arenaAllocate(&currentSession->queryArena, (numberOfVectors + 1) * sizeof(bool));
+        int numberOfVectorsRead = 0;
+        bool aligned = true;
+        for (int i = 0; (i < numberOfVectors) && aligned; i++)
+        {
+            int numberOfValues;
+            vectors[i] = readValuesArgument(connectionfd, "groupOperator\0", query->arguments[i + 2], &numberOfValues, &vectorTypes[i], &readColumns[i]);
+            if (vectors[i] == NULL)
+            {
+                aligned = false;
+                continue;
+            }
+            numberOfVectorsRead++;
+            if (numberOfValues != numberOfRows)
+            {
+                raiseDatabaseException(connectionfd, "groupOperator\0", "The variable ~ does not hold as many values as the keys\0", query->arguments[i + 2]);
+                aligned = false;
+            }
+        }
+
+        // extend the keys and values to int64s, so a single set of grouping loops handles every type
+        groupInput input;
+        input.keys = malloc(((size_t)numberOfRows + 1) * sizeof(long long));
+        input.values = malloc((numberOfVectors + 1) * sizeof(long long*));
+        input.numberOfVectors = numberOfVectors;
+        input.function = function;
+        extendKernels[keyType](keys, numberOfRows, input.keys);
+        for (int i = 0; aligned && (i < numberOfVectors); i++)
+        {
+            input.values[i] = malloc(((size_t)numberOfRows + 1) * sizeof(long long));
+            extendKernels[vectorTypes[i]](vectors[i], numberOfRows, input.values[i]);
+        }
+        for (int i = 0; i < numberOfVectorsRead; i++)
+        {
+            if (readColumns[i])
+            {
+                free(vectors[i]);
+            }
+        }
+        if (readColumn)
+        {
+            free(keys);
+        }
+        if (!aligned)
+        {
+            free(input.values);
+            free(input.keys);
+            return;
+        }
+
+        // group the rows
+        groupRows(&input, numberOfRows, &groups);
+        for (int i = 0; i < numberOfVectors; i++)
+        {
+            free(input.values[i]);
+        }
+        free(input.values);
+        free(input.keys);
+        profileRows(numberOfRows, groups.numberOfGroups);
+    }
+
+    // store the keys (as the type they were given as) and the aggregates (as int64s, so sums cannot
+    // overflow the type of their values) in intermediate variables
+    intermediateResult* variable = createIntermediateResult(outputNames[0], VALUE_LIST);
+    variable->values = poolAllocate(((size_t)groups.numberOfGroups + 1) * columnTypeWidths[keyType]);
+    variable->valueType = keyType;
+    variable->numberOfValues = groups.numberOfGroups;
+    narrowKernels[keyType](groups.keys, groups.numberOfGroups, variable->values);
+    insertIntermediateResult(currentSession, variable);
+    for (int i = 1; i < numberOfOutputs; i++)
+    {
+        long long* aggregates = (function == GROUP_COUNT) ? groups.counts : groups.aggregates[i - 1];
+        variable = createIntermediateResult(outputNames[i], VALUE_LIST);
+        variable->values = poolAllocate(((size_t)groups.numberOfGroups + 1) * sizeof(long long));
+        variable->valueType = COLUMN_INT64;
+        variable->numberOfValues = groups.numberOfGroups;
+        memcpy(variable->values, aggregates, groups.numberOfGroups * sizeof(long long));
+        insertIntermediateResult(currentSession, variable);
+    }
+    for (int i = 0; i < numberOfVectors; i++)
+    {
+        free(groups.aggregates[i]);
+    }
+    free(groups.aggregates);
+    free(groups.counts);
+    free(groups.keys);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Grouped values by the keys in `\0", keysName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Group operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  splitOutputVariables()
+ *  Splits the comma separated variables an operator with several results stores them
+ *  in, making sure each is new. Returns how many there are (maximumNames + 1 if there
+ *  are more than maximumNames), or -1 after raising an exception if one is not new.
+ */
+int splitOutputVariables(int connectionfd, char* function, char* outputVariable, char** names, int maximumNames)
+{
+    char* outputList = arenaStringCopy(&currentSession->queryArena, outputVariable);
+    char* position;
+    int numberOfNames = 0;
+    for (char* name = strtok_r(outputList, ",", &position); name != NULL; name = strtok_r(NULL, ",", &position))
+    {
+        if (numberOfNames == maximumNames)
+        {
+            return maximumNames + 1;
+        }
+        for (int i = 0; i < numberOfNames; i++)
+        {
+            if (strcmp(name, names[i]) == 0)
+            {
+                raiseDatabaseException(connectionfd, function, "The variable ~ is named twice, please rename one of the intermediate result variables\0", name);
+                return -1;
+            }
+        }
+        if (lookupIntermediateResult(currentSession, name) != NULL)
+        {
+            raiseDatabaseException(connectionfd, function, "The variable ~ already exists in memory, please rename the current intermediate result variable\0", name);
+            return -1;
+        }
+        names[numberOfNames++] = name;
+    }
+    return numberOfNames;
+}
+
+/*
+ *  readValuesArgument()
+ *  Returns the values an operator works on: those of a variable holding values, or else
+ *  those of a column (read into an array the caller frees, flagged by readColumn).
+ *  Returns NULL after raising an exception if there is neither.
+ */
+void* readValuesArgument(int connectionfd, char* function, char* name, int* numberOfValues, int* valueType, bool* readColumn)
+{
+    intermediateResult* variable = lookupIntermediateResult(currentSession, name);
+    *readColumn = (variable == NULL) && (columnSnapshotPath(name) != NULL);
+    if (*readColumn)
+    {
+        return readColumnFromDisk(connectionfd, function, name, numberOfValues, valueType);
+    }
+    else if ((variable == NULL) || (variable->resultType != VALUE_LIST))
+    {
+        raiseDatabaseException(connectionfd, function, "There is no column ~ or variable holding values by that name\0", name);
+        return NULL;
+    }
+    *numberOfValues = variable->numberOfValues;
+    *valueType = variable->valueType;
+    return variable->values;
+}
+
+/*
+ *  storeOrderedResult()
+ *  Stores values (narrowed back to their type) and, if a second variable is named, the
+ *  positions they came from, in new intermediate variables.
+ */
+void storeOrderedResult(char** outputNames, int numberOfOutputs, long long* values, int* positions, int numberOfValues, int valueType)
+{
+    intermediateResult* variable = createIntermediateResult(outputNames[0], VALUE_LIST);
+    variable->values = poolAllocate(((size_t)numberOfValues + 1) * columnTypeWidths[valueType]);
+    variable->valueType = valueType;
+    variable->numberOfValues = numberOfValues;
+    narrowKernels[valueType](values, numberOfValues, variable->values);
+    insertIntermediateResult(currentSession, variable);
+    if (numberOfOutputs == 2)
+    {
+        variable = createIntermediateResult(outputNames[1], POSITION_LIST);
+        variable->validPositions = poolAllocate(((size_t)numberOfValues + 1) * sizeof(int));
+        variable->numberOfValidPositions = numberOfValues;
+        memcpy(variable->validPositions, positions, numberOfValues * sizeof(int));
+        insertIntermediateResult(currentSession, variable);
+    }
+}
+
+/*
+ *  topkOperator()
+ *  Is used to find the k largest values of a vector of values (or of a column), largest
+ *  first, without sorting it. The values and, optionally, the positions they are at in
+ *  the vector (or column) are stored in new intermediate variables.
+ */
+void topkOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "topkOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* valuesName = queryArgument(query, 0);
+    char* kArgument = queryArgument(query, 1);
+    if ((query->outputVariable == NULL) || (valuesName == NULL) || (kArgument == NULL) || (query->numberOfArguments != 2))
+    {
+        raiseDatabaseException(connectionfd, "topkOperator\0", "Ensure the format of the query is \"values[,positions]=topk(values,k)\"\0", NULL);
+        return;
+    }
+    long long k = atoll(kArgument);
+    if (k < 1)
+    {
+        raiseDatabaseException(connectionfd, "topkOperator\0", "The number of values to find must be positive, not ~\0", kArgument);
+        return;
+    }
+    char* outputNames[2];
+    int numberOfOutputs = splitOutputVariables(connectionfd, "topkOperator\0", query->outputVariable, outputNames, 2);
+    if (numberOfOutputs == -1)
+    {
+        return;
+    }
+    if (numberOfOutputs > 2)
+    {
+        raiseDatabaseException(connectionfd, "topkOperator\0", "Name a variable for the values and at most one for their positions in ~\0", query->outputVariable);
+        return;
+    }
+
+    // find the largest values
+    int numberOfValues;
+    int valueType;
+    bool readColumn;
+    void* values = readValuesArgument(connectionfd, "topkOperator\0", valuesName, &numberOfValues, &valueType, &readColumn);
+    if (values == NULL)
+    {
+        return;
+    }
+    int numberOfTopValues = (k < numberOfValues) ? (int)k : numberOfValues;
+    long long* topValues = malloc(((size_t)numberOfTopValues + 1) * sizeof(long long));
+    int* topPositions = malloc(((size_t)numberOfTopValues + 1) * sizeof(int));
+    selectTopValues(values, valueType, numberOfValues, numberOfTopValues, topValues, topPositions);
+    if (readColumn)
+    {
+        free(values);
+    }
+    profileRows(numberOfValues, numberOfTopValues);
+    storeOrderedResult(outputNames, numberOfOutputs, topValues, topPositions, numberOfTopValues, valueType);
+    free(topValues);
+    free(topPositions);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Found the largest values of `\0", valuesName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Top-k operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  sortOperator()
+ *  Is used to sort a vector of values (or a column), ascending unless asked for desc.
+ *  Equal values keep their order. The sorted values and, optionally, the positions they
+ *  came from (the permutation that sorts the vector) are stored in new intermediate
+ *  variables.
+ */
+void sortOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "sortOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* valuesName = queryArgument(query, 0);
+    char* order = queryArgument(query, 1);
+    if ((query->outputVariable == NULL) || (valuesName == NULL) || (query->numberOfArguments > 2) ||
+        ((order != NULL) && (strcmp(order, "asc") != 0) && (strcmp(order, "desc") != 0)))
+    {
+        raiseDatabaseException(connectionfd, "sortOperator\0", "Ensure the format of the query is \"values[,positions]=sort(values[,asc|desc])\"\0", NULL);
+        return;
+    }
+    char* outputNames[2];
+    int numberOfOutputs = splitOutputVariables(connectionfd, "sortOperator\0", query->outputVariable, outputNames, 2);
+    if (numberOfOutputs == -1)
+    {
+        return;
+    }
+    if (numberOfOutputs > 2)
+    {
+        raiseDatabaseException(connectionfd, "sortOperator\0", "Name a variable for the values and at most one for their positions in ~\0", query->outputVariable);
+        return;
+    }
+
+    // sort the values, extended to int64s
+    int numberOfValues;
+    int valueType;
+    bool readColumn;
+    void* values = readValuesArgument(connectionfd, "sortOperator\0", valuesName, &numberOfValues, &valueType, &readColumn);
+    if (values == NULL)
+    {
+        return;
+    }
+    long long* sortedValues = malloc(((size_t)numberOfValues + 1) * sizeof(long long));
+    int* sortedPositions = malloc(((size_t)numberOfValues + 1) * sizeof(int));
+    extendKernels[valueType](values, numberOfValues, sortedValues);
+    if (readColumn)
+    {
+        free(values);
+    }
+    radixSortValues(sortedValues, numberOfValues, (order != NULL) && (strcmp(order, "desc") == 0), sortedPositions);
+    profileRows(numberOfValues, numberOfValues);
+    storeOrderedResult(outputNames, numberOfOutputs, sortedValues, sortedPositions, numberOfValues, valueType);
+    free(sortedValues);
+    free(sortedPositions);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Sorted the values of `\0", valuesName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Sort operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  sampleColumnBlocks()
+ *  Reads a random sample of the blocks of a column (of its partitions' files if it is
+ *  partitioned) and finds the size of each sampled block and the count and sum of its
+ *  values in [low, high]. Returns false (after raising an exception) if the column
+ *  cannot be read.
+ */
+bool sampleColumnBlocks(int connectionfd, char* column, long long low, long long high, double* sums, double* counts, double* sizes,
+                        int* numberOfSamples, int* numberOfBlocks, int* numberOfValues)
+{
+    // find the files the values are in: the column's own, or one per partition
+    int valueType;
+    FILE* fp = openColumnForReading(connectionfd, "approxOperator\0", column, numberOfValues, &valueType);
+    if (fp == NULL)
+    {
+        return false;
+    }
+    int width = columnTypeWidths[valueType];
+    FILE* segments[MAX_PARTITIONS];
+    int segmentValues[MAX_PARTITIONS];
+    int numberOfSegments = 1;
+    bool opened = true;
+    partitionDirectory directory;
+    segments[0] = fp;
+    segmentValues[0] = *numberOfValues;
+    if (readPartitionDirectory(column, &directory))
+    {
+        fclose(fp);
+        numberOfSegments = directory.numberOfPartitions;
+        char* partitionName = arenaAllocate(&currentSession->queryArena, strlen(column) + 16);
+        for (int i = 0; i < numberOfSegments; i++)
+        {
+            partitionColumnName(column, i, partitionName);
+            char* path = columnSnapshotPath(partitionName);
+            segments[i] = (path == NULL) ? NULL : fopen(path, "rb");
+            segmentValues[i] = directory.partitions[i].numberOfValues;
+            opened &= (segments[i] != NULL);
+        }
+    }
+
+    // pick the blocks, numbered through the segments in order
+    *numberOfBlocks = 0;
+    for (int i = 0; i < numberOfSegments; i++)
+    {
+        *numberOfBlocks += (segmentValues[i] + SAMPLE_BLOCK_VALUES - 1) / SAMPLE_BLOCK_VALUES;
+    }
+    *numberOfSamples = (*numberOfBlocks < SAMPLE_BLOCKS) ? *numberOfBlocks : SAMPLE_BLOCKS;
+    int* blocks = arenaAllocate(&currentSession->queryArena, (*numberOfSamples + 1) * sizeof(int));
+    unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)pthread_self();
+    chooseSampleBlocks(*numberOfBlocks, *numberOfSamples, &seed, blocks);
+
+    // read each block and aggregate the values of it in the range
+    void* values = malloc((size_t)SAMPLE_BLOCK_VALUES * width);
+    void* gathered = malloc((size_t)SAMPLE_BLOCK_VALUES * width);
+    int* positions = malloc(SAMPLE_BLOCK_VALUES * sizeof(int));
+    int segment = 0;
+    int firstBlockOfSegment = 0;
+    long long valuesRead = 0;
+    for (int i = 0; opened && (i < *numberOfSamples); i++)
+    {
+        while (blocks[i] >= firstBlockOfSegment + (segmentValues[segment] + SAMPLE_BLOCK_VALUES - 1) / SAMPLE_BLOCK_VALUES)
+        {
+            firstBlockOfSegment += (segmentValues[segment] + SAMPLE_BLOCK_VALUES - 1) / SAMPLE_BLOCK_VALUES;
+            segment++;
+        }
+        int start = (blocks[i] - firstBlockOfSegment) * SAMPLE_BLOCK_VALUES;
+        int count = (segmentValues[segment] - start < SAMPLE_BLOCK_VALUES) ? segmentValues[segment] - start : SAMPLE_BLOCK_VALUES;
+        size_t bytes = (size_t)count * width;
+        if (readFileAsync(fileno(segments[segment]), values, bytes, (2 * sizeof(int)) + ((size_t)start * width)) != (ssize_t)bytes)
+        {
+            opened = false;
+            break;
+        }
+        int selected = selectKernels[valueType](values, count, low, high, positions);
+        gatherKernels[valueType](values, count, positions, selected, gathered);
+        long long sum = 0;
+        long long min = LLONG_MAX;
+        long long max = LLONG_MIN;
+        aggregateKernels[valueType](gathered, selected, &sum, &min, &max);
+        sums[i] = sum;
+        counts[i] = selected;
+        sizes[i] = count;
+        valuesRead += count;
+    }
+    free(values);
+    free(gathered);
+    free(positions);
+    for (int i = 0; i < numberOfSegments; i++)
+    {
+        if (segments[i] != NULL)
+            fclose(segments[i]);
+    }
+    profileRows(valuesRead, *numberOfSamples);
+    recordBytesRead(valuesRead * width);
+    if (!opened)
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "The blocks of the column ~ could not be read\0", column);
+    }
+    return opened;
+}
+
+/*
+ *  bloomOperator()
+ *  Is used to build a blocked Bloom filter of the values of a variable or a column,
+ *  e.g. of the keys of the build side of a join. A select over the other side's
+ *  column given the filter as its last argument only selects values the filter may
+ *  hold, so most rows that cannot join are dropped during the scan.
+ */
+void bloomOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "bloomOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* variableName = query->outputVariable;
+    char* valuesName = queryArgument(query, 0);
+    if ((variableName == NULL) || (valuesName == NULL) || (query->numberOfArguments != 1))
+    {
+        raiseDatabaseException(connectionfd, "bloomOperator\0", "Ensure the format of the query is \"filter=bloom(values)\"\0", NULL);
+        return;
+    }
+    if (lookupIntermediateResult(currentSession, variableName) != NULL)
+    {
+        raiseDatabaseException(connectionfd, "bloomOperator\0", "The variable ~ already exists in memory, please rename the current intermediate result variable\0", variableName);
+        return;
+    }
+    int numberOfValues;
+    int valueType;
+    bool readColumn;
+    void* values = readValuesArgument(connectionfd, "bloomOperator\0", valuesName, &numberOfValues, &valueType, &readColumn);
+    if (values == NULL)
+    {
+        return;
+    }
+
+    // insert every value into a filter sized for them, kept in the variable's values
+    long long* keys = malloc(((size_t)numberOfValues + 1) * sizeof(long long));
+    extendKernels[valueType](values, numberOfValues, keys);
+    if (readColumn)
+    {
+        free(values);
+    }
+    bloomFilter filter;
+    filter.numberOfBlocks = bloomFilterBlocks(numberOfValues);
+    filter.words = poolAllocate((size_t)filter.numberOfBlocks * BLOOM_BLOCK_WORDS * sizeof(unsigned int));
+    memset(filter.words, 0, (size_t)filter.numberOfBlocks * BLOOM_BLOCK_WORDS * sizeof(unsigned int));
+    for (int i = 0; i < numberOfValues; i++)
+    {
+        insertBloomKey(&filter, keys[i]);
+    }
+    free(keys);
+    profileRows(numberOfValues, numberOfValues);
+    intermediateResult* variable = createIntermediateResult(variableName, BLOOM_FILTER);
+    variable->values = filter.words;
+    variable->valueType = COLUMN_INT32;
+    variable->numberOfValues = filter.numberOfBlocks * BLOOM_BLOCK_WORDS;
+    variable->scalarValue = numberOfValues;
+    insertIntermediateResult(currentSession, variable);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Built a Bloom filter of `\0", valuesName, "`.\0");
+    if (message == NULL)
+    {
+        printf("Bloom operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  joinOperator()
+ *  Is used to equi-join two vectors of values (each fetched at a list of positions):
+ *  positions1,positions2=join(values1,positions1,values2,positions2,hash) stores the
+ *  positions of every pair of rows with equal values, in the order of the rows of the
+ *  side probed. The smaller side is built into a hash table and the other probes it.
+ */
+void joinOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "joinOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* method = queryArgument(query, 4);
+    if ((query->outputVariable == NULL) || (query->numberOfArguments < 4) || (query->numberOfArguments > 5) ||
+        ((method != NULL) && (strcmp(method, "hash") != 0)))
+    {
+        raiseDatabaseException(connectionfd, "joinOperator\0", "Ensure the format of the query is \"positions1,positions2=join(values1,positions1,values2,positions2,hash)\"\0", NULL);
+        return;
+    }
+    char* outputNames[3];
+    int numberOfNames = splitOutputVariables(connectionfd, "joinOperator\0", query->outputVariable, outputNames, 2);
+    if (numberOfNames == -1)
+    {
+        return;
+    }
+    if (numberOfNames != 2)
+    {
+        raiseDatabaseException(connectionfd, "joinOperator\0", "Name a variable for the positions of each side of the join in ~\0", query->outputVariable);
+        return;
+    }
+
+    // make sure the values and positions of both sides exist and line up
+    intermediateResult* values[2];
+    intermediateResult* positions[2];
+    for (int side = 0; side < 2; side++)
+    {
+        values[side] = lookupIntermediateResult(currentSession, query->arguments[2 * side]);
+        positions[side] = lookupIntermediateResult(currentSession, query->arguments[(2 * side) + 1]);
+        if ((values[side] == NULL) || (values[side]->resultType != VALUE_LIST))
+        {
+            raiseDatabaseException(connectionfd, "joinOperator\0", "The variable ~ does not exist or does not hold values\0", query->arguments[2 * side]);
+            return;
+        }
+        else if ((positions[side] == NULL) || (positions[side]->resultType != POSITION_LIST))
+        {
+            raiseDatabaseException(connectionfd, "joinOperator\0", "The variable ~ does not exist or does not hold positions\0", query->arguments[(2 * side) + 1]);
+            return;
+        }
+        else if (values[side]->numberOfValues != positions[side]->numberOfValidPositions)
+        {
+            raiseDatabaseException(connectionfd, "joinOperator\0", "The values in ~ are not aligned with the position list\0", query->arguments[2 * side]);
+            return;
+        }
+    }
+
+    // extend the values to int64s, so sides of different types join, and build on the smaller side
+    long long* keys[2];
+    for (int side = 0; side < 2; side++)
+    {
+        keys[side] = malloc(((size_t)values[side]->numberOfValues + 1) * sizeof(long long));
+        extendKernels[values[side]->valueType](values[side]->values, values[side]->numberOfValues, keys[side]);
+    }
+    int build = (values[0]->numberOfValues <= values[1]->numberOfValues) ? 0 : 1;
+    int probe = 1 - build;
+    joinMatches matches;
+    hashJoinRows(keys[build], values[build]->numberOfValues, keys[probe], values[probe]->numberOfValues, &matches);
+    free(keys[0]);
+    free(keys[1]);
+    profileRows(values[0]->numberOfValues + values[1]->numberOfValues, matches.numberOfMatches);
+
+    // store the positions the matching rows came from
+    int* rows[2];
+    rows[build] = matches.buildRows;
+    rows[probe] = matches.probeRows;
+    for (int side = 0; side < 2; side++)
+    {
+        intermediateResult* variable = createIntermediateResult(outputNames[side], POSITION_LIST);
+        variable->validPositions = poolAllocate(((size_t)matches.numberOfMatches + 1) * sizeof(int));
+        variable->numberOfValidPositions = matches.numberOfMatches;
+        for (int i = 0; i < matches.numberOfMatches; i++)
+        {
+            variable->validPositions[i] = positions[side]->validPositions[rows[side][i]];
+        }
+        insertIntermediateResult(currentSession, variable);
+    }
+    free(matches.buildRows);
+    free(matches.probeRows);
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Joined `\0", query->arguments[0], "`.\0");
+    if (message == NULL)
+    {
+        printf("Join operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  approxOperator()
+ *  Is used to estimate an aggregate of a column instead of computing it: the count,
+ *  sum, or avg of its values (in an optional range) from a sample of its blocks, the
+ *  number of distinct values from its HyperLogLog sketch, or a quantile from its
+ *  quantile sketch. The estimate and, optionally, the half width of its ~95%
+ *  confidence interval are stored in new intermediate variables.
+ */
+void approxOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* functionName = queryArgument(query, 0);
+    char* column = queryArgument(query, 1);
+    if ((query->outputVariable == NULL) || (functionName == NULL) || (column == NULL))
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "Ensure the format of the query is \"estimate[,bound]=approx(function,column[,low,high])\"\0", NULL);
+        return;
+    }
+    bool sampled = (strcmp(functionName, "count") == 0) || (strcmp(functionName, "sum") == 0) || (strcmp(functionName, "avg") == 0);
+    bool distinct = (strcmp(functionName, "distinct") == 0);
+    bool quantile = (strcmp(functionName, "quantile") == 0);
+    if ((sampled && (query->numberOfArguments != 2) && (query->numberOfArguments != 4)) || (distinct && (query->numberOfArguments != 2)) ||
+        (quantile && (query->numberOfArguments != 3)))
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "Ensure the format of the query is \"estimate[,bound]=approx(count|sum|avg,column[,low,high])\", \"approx(distinct,column)\", or \"approx(quantile,column,fraction)\"\0", NULL);
+        return;
+    }
+    else if (!sampled && !distinct && !quantile)
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "Cannot estimate ~, the functions are count, sum, avg, distinct, and quantile\0", functionName);
+        return;
+    }
+    double fraction = quantile ? atof(query->arguments[2]) : 0.0;
+    if (quantile && ((fraction < 0.0) || (fraction > 1.0)))
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "The quantile ~ is not a fraction between 0 and 1\0", query->arguments[2]);
+        return;
+    }
+    char* outputNames[2];
+    int numberOfOutputs = splitOutputVariables(connectionfd, "approxOperator\0", query->outputVariable, outputNames, 2);
+    if (numberOfOutputs == -1)
+    {
+        return;
+    }
+    if (numberOfOutputs > 2)
+    {
+        raiseDatabaseException(connectionfd, "approxOperator\0", "Name a variable for the estimate and at most one for its bound in ~\0", query->outputVariable);
+        return;
+    }
+
+    // the sketches of a column are built when it is loaded, or from its values if the server has not
+    // loaded it since it started
+    double estimate = 0.0;
+    double bound = 0.0;
+    long long quantileEstimate = 0;
+    long long quantileBound = 0;
+    bool empty = false;
+    if (distinct || quantile)
+    {
+        bool sketched = distinct ? estimateDistinctValues(column, &estimate, &bound) : estimateQuantile(column, fraction, &quantileEstimate, &quantileBound, &empty);
+        if (!sketched)
+        {
+            int numberOfValues;
+            int valueType;
+            void* values = readColumnFromDisk(connectionfd, "approxOperator\0", column, &numberOfValues, &valueType);
+            if (values == NULL)
+            {
+                return;
+            }
+            long long* extended = malloc(((size_t)numberOfValues + 1) * sizeof(long long));
+            extendKernels[valueType](values, numberOfValues, extended);
+            free(values);
+            updateColumnSketches(column, extended, numberOfValues);
+            free(extended);
+            if (distinct)
+                estimateDistinctValues(column, &estimate, &bound);
+            else
+                estimateQuantile(column, fraction, &quantileEstimate, &quantileBound, &empty);
+        }
+        if (empty)
+        {
+            raiseDatabaseException(connectionfd, "approxOperator\0", "Cannot estimate a quantile of the empty column ~\0", column);
+            return;
+        }
+    }
+    else
+    {
+        // estimate from the totals of the values in the range in each sampled block
+        long long low = (query->numberOfArguments == 4) ? atoll(query->arguments[2]) : LLONG_MIN;
+        long long high = (query->numberOfArguments == 4) ? atoll(query->arguments[3]) : LLONG_MAX;
+        double* sums = arenaAllocate(&currentSession->queryArena, (SAMPLE_BLOCKS + 1) * sizeof(double));
+        double* counts = arenaAllocate(&currentSession->queryArena, (SAMPLE_BLOCKS + 1) * sizeof(double));
+        double* sizes = arenaAllocate(&currentSession->queryArena, (SAMPLE_BLOCKS + 1) * sizeof(double));
+        int numberOfSamples;
+        int numberOfBlocks;
+        int numberOfValues;
+        if (!sampleColumnBlocks(connectionfd, column, low, high, sums, counts, sizes, &numberOfSamples, &numberOfBlocks, &numberOfValues))
+        {
+            return;
+        }
+        double sampledCount = 0.0;
+        for (int i = 0; i < numberOfSamples; i++)
+        {
+            sampledCount += counts[i];
+        }
+        if (strcmp(functionName, "avg") == 0)
+        {
+            if (sampledCount == 0.0)
+            {
+                raiseDatabaseException(connectionfd, "approxOperator\0", "Cannot estimate the avg of ~, no sampled value is in the range\0", column);
+                return;
+            }
+            estimateRatioFromBlocks(sums, counts, numberOfSamples, numberOfBlocks, &estimate, &bound);
+        }
+        else
+        {
+            estimateTotalFromBlocks((strcmp(functionName, "sum") == 0) ? sums : counts, sizes, numberOfSamples, numberOfBlocks, numberOfValues, &estimate, &bound);
+        }
+    }
+
+    // store the estimate (and its bound)
+    intermediateResult* variable = createIntermediateResult(outputNames[0], SCALAR_VALUE);
+    if (strcmp(functionName, "avg") == 0)
+    {
+        variable->resultType = AVERAGE_VALUE;
+        variable->averageValue = estimate;
+    }
+    else
+    {
+        variable->scalarValue = quantile ? quantileEstimate : llround(estimate);
+    }
+    insertIntermediateResult(currentSession, variable);
+    if (numberOfOutputs == 2)
+    {
+        variable = createIntermediateResult(outputNames[1], AVERAGE_VALUE);
+        variable->averageValue = quantile ? (double)quantileBound : bound;
+        insertIntermediateResult(currentSession, variable);
+    }
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Estimated an aggregate of `\0", column, "`.\0");
+    if (message == NULL)
+    {
+        printf("Approximate operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  materializeOperator()
+ *  Defines a materialized aggregate, kept up to date as its columns are loaded:
+ *  materialize(name,column) keeps the count, sum, min, and max of the column,
+ *  materialize(name,column,low,high) those of its values in [low, high], and
+ *  materialize(name,column,keyColumn) the count and sum of the column per key. Queries
+ *  of the same aggregate are answered from it rather than from the column. Defining an
+ *  aggregate under a name already in use replaces it.
+ */
+void materializeOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "materializeOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* name = queryArgument(query, 0);
+    char* column = queryArgument(query, 1);
+    char* keyColumn = (query->numberOfArguments == 3) ? queryArgument(query, 2) : NULL;
+    if ((name == NULL) || (column == NULL) || (query->numberOfArguments == 1) || (query->numberOfArguments > 4))
+    {
+        raiseDatabaseException(connectionfd, "materializeOperator\0", "Ensure the format of the query is \"materialize(name,column[,low,high|,keyColumn])\"\0", NULL);
+        return;
+    }
+    else if ((name[0] == '\0') || (strchr(name, '/') != NULL) || (strlen(name) >= MATERIALIZED_NAME_LENGTH))
+    {
+        raiseDatabaseException(connectionfd, "materializeOperator\0", "~ cannot name a materialized aggregate\0", name);
+        return;
+    }
+    else if ((strlen(column) >= PARTITION_KEY_LENGTH) || ((keyColumn != NULL) && (strlen(keyColumn) >= PARTITION_KEY_LENGTH)))
+    {
+        raiseDatabaseException(connectionfd, "materializeOperator\0", "The name of the column ~ is too long to materialize an aggregate of\0", column);
+        return;
+    }
+
+    // compute the aggregate from the columns as they are and store it
+    materializedAggregate aggregate;
+    memset(&aggregate, 0, sizeof(materializedAggregate));
+    materializedDefinition* definition = &aggregate.definition;
+    definition->kind = (query->numberOfArguments == 2) ? MATERIALIZED_TOTAL : ((keyColumn != NULL) ? MATERIALIZED_GROUPS : MATERIALIZED_RANGE);
+    strcpy(definition->column, column);
+    strcpy(definition->keyColumn, (keyColumn != NULL) ? keyColumn : "");
+    definition->low = (definition->kind == MATERIALIZED_RANGE) ? atoll(query->arguments[2]) : 0;
+    definition->high = (definition->kind == MATERIALIZED_RANGE) ? atoll(query->arguments[3]) : 0;
+    if (!computeMaterializedAggregate(connectionfd, "materializeOperator\0", &aggregate))
+    {
+        return;
+    }
+    bool stored = storeMaterializedAggregate(name, &aggregate);
+    freeMaterializedAggregate(&aggregate);
+    if (!stored)
+    {
+        raiseDatabaseException(connectionfd, "materializeOperator\0", "Could not write the materialized aggregate ~\0", name);
+        return;
+    }
+
+    // create a message and write it to the client
+    char* message = createCustomMessage(connectionfd, "Materialized `\0", name, "`.\0");
+    if (message == NULL)
+    {
+        printf("Materialize operation was aborted due to above database exception.\n");
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+    printf("%s\n", message);
+}
+
+/*
+ *  computeMaterializedAggregate()
+ *  Computes the state of a materialized aggregate from every value of the columns it
+ *  is over, as of the query's snapshot, and stamps it with their versions. Returns false
+ *  if the columns cannot be read (after raising an exception, unless function is NULL).
+ */
+bool computeMaterializedAggregate(int connectionfd, char* function, materializedAggregate* aggregate)
+{
+    materializedDefinition* definition = &aggregate->definition;
+    bool grouped = (definition->kind == MATERIALIZED_GROUPS);
+    int numberOfValues = 0;
+    int numberOfKeys = 0;
+    int valueType = COLUMN_INT32;
+    int keyType = COLUMN_INT32;
+    void* values = readColumnFromDisk(connectionfd, function, definition->column, &numberOfValues, &valueType);
+    void* keys = ((values == NULL) || !grouped) ? NULL : readColumnFromDisk(connectionfd, function, definition->keyColumn, &numberOfKeys, &keyType);
+    if ((values == NULL) || (grouped && (keys == NULL)))
+    {
+        free(values);
+        return false;
+    }
+    if (grouped && (numberOfKeys != numberOfValues))
+    {
+        if (function != NULL)
+        {
+            raiseDatabaseException(connectionfd, function, "The column ~ does not hold as many values as the key column\0", definition->column);
+        }
+        free(values);
+        free(keys);
+        return false;
+    }
+
+    // the stamps are of the files the values were read from, so the state matches them even if a load
+    // has published newer ones since
+    bool stamped = stampColumnPath(columnSnapshotPath(definition->column), &definition->columnStamp) &&
+                   (!grouped || stampColumnPath(columnSnapshotPath(definition->keyColumn), &definition->keyStamp));
+    long long* extendedValues = malloc(((size_t)numberOfValues + 1) * sizeof(long long));
+    long long* extendedKeys = grouped ? malloc(((size_t)numberOfValues + 1) * sizeof(long long)) : NULL;
+    extendKernels[valueType](values, numberOfValues, extendedValues);
+    if (grouped)
+    {
+        extendKernels[keyType](keys, numberOfValues, extendedKeys);
+    }
+    free(values);
+    free(keys);
+    clearMaterializedState(aggregate);
+    addRowsToMaterializedAggregate(aggregate, extendedValues, extendedKeys, numberOfValues);
+    free(extendedValues);
+    free(extendedKeys);
+    profileRows(numberOfValues, 1);
+    if (!stamped && (function != NULL))
+    {
+        raiseDatabaseException(connectionfd, function, "The column ~ does not exist in the database\0", definition->column);
+    }
+    if (!stamped)
+    {
+        freeMaterializedAggregate(aggregate);
+    }
+    return stamped;
+}
+
+/*
+ *  storeMaterializedAggregate()
+ *  Writes the state of a materialized aggregate and publishes it on its own. Returns
+ *  false if it could not be written.
+ */
+bool storeMaterializedAggregate(char* name, materializedAggregate* aggregate)
+{
+    beginColumnWrites();
+    bool staged = stageMaterializedAggregate(name, aggregate);
+    bool published = publishColumnWrites();
+    return staged && published;
+}
+
+/*
+ *  lookupMaterializedAggregate()
+ *  Finds the materialized aggregate with the given definition, for a query to be answered
+ *  from. If its columns changed in a way it could not follow (a load of only some of
+ *  them, a dropped partition) it is computed again and stored. Returns false if there is
+ *  none or it could not be brought up to date, the query is answered from the columns then.
+ */
+bool lookupMaterializedAggregate(int kind, char* column, char* keyColumn, long long low, long long high, materializedAggregate* aggregate)
+{
+    char name[MATERIALIZED_NAME_LENGTH];
+    bool current = false;
+    if (!findMaterializedAggregate(kind, column, keyColumn, low, high, name, aggregate, &current))
+    {
+        return false;
+    }
+    else if (current)
+    {
+        printf("Answered from the materialized aggregate `%s`.\n", name);
+        return true;
+    }
+    freeMaterializedAggregate(aggregate);
+    if (!computeMaterializedAggregate(-1, NULL, aggregate))
+    {
+        return false;
+    }
+    if (storeMaterializedAggregate(name, aggregate))
+    {
+        printf("Recomputed the stale materialized aggregate `%s`.\n", name);
+    }
+    return true;
+}
+
+/*
+ *  refreshMaterializedAggregates()
+ *  Brings the materialized aggregates over the columns of a load up to date with it,
+ *  staging their new state to be published along with the columns. An append folds in
+ *  just the appended rows, a load that replaces the columns computes the state from the
+ *  loaded rows alone. Aggregates the load cannot bring up to date (over a column not in
+ *  it, or stale already) are left as they are, and are computed again when next used.
+ *  The caller holds the writers lock, with every column of the load staged.
+ */
+void refreshMaterializedAggregates(char** columnNames, long long** columnData, int numberOfColumns, int numberOfRows, bool append)
+{
+    int numberOfAggregates;
+    char** names = listMaterializedAggregates(&numberOfAggregates);
+    for (int i = 0; i < numberOfAggregates; i++)
+    {
+        char fileName[strlen(names[i]) + 5];
+        materializedFileName(names[i], fileName);
+        materializedAggregate aggregate;
+        if (!readMaterializedAggregateAt(newestColumnPath(fileName), &aggregate))
+        {
+            continue;
+        }
+
+        // find the loaded rows of the columns it is over
+        materializedDefinition* definition = &aggregate.definition;
+        bool grouped = (definition->kind == MATERIALIZED_GROUPS);
+        int valueIndex = -1;
+        int keyIndex = -1;
+        for (int j = 0; j < numberOfColumns; j++)
+        {
+            valueIndex = (strcmp(columnNames[j], definition->column) == 0) ? j : valueIndex;
+            keyIndex = (grouped && (strcmp(columnNames[j], definition->keyColumn) == 0)) ? j : keyIndex;
+        }
+        FILE* columnSegment = (valueIndex == -1) ? NULL : findStagedColumnSegment(definition->column);
+        FILE* keySegment = (keyIndex == -1) ? NULL : findStagedColumnSegment(definition->keyColumn);
+        if ((columnSegment == NULL) || (grouped && (keySegment == NULL)))
+        {
+            freeMaterializedAggregate(&aggregate);
+            continue;
+        }
+
+        // appended rows can only be folded into a state that is up to date with the rows before them
+        columnFileStamp columnStamp;
+        columnFileStamp keyStamp;
+        bool current = stampColumnPath(newestColumnPath(definition->column), &columnStamp) && sameColumnFileStamp(&columnStamp, &definition->columnStamp) &&
+                       (!grouped || (stampColumnPath(newestColumnPath(definition->keyColumn), &keyStamp) && sameColumnFileStamp(&keyStamp, &definition->keyStamp)));
+        if (append && !current)
+        {
+            freeMaterializedAggregate(&aggregate);
+            continue;
+        }
+        if (!append)
+        {
+            freeMaterializedAggregate(&aggregate);
+            clearMaterializedState(&aggregate);
+        }
+        addRowsToMaterializedAggregate(&aggregate, columnData[valueIndex], grouped ? columnData[keyIndex] : NULL, numberOfRows);
+        bool stamped = stampColumnFd(fileno(columnSegment), &definition->columnStamp) &&
+                       (!grouped || stampColumnFd(fileno(keySegment), &definition->keyStamp));
+        if (stamped && stageMaterializedAggregate(names[i], &aggregate))
+        {
+            printf("Refreshed the materialized aggregate `%s`.\n", names[i]);
+        }
+        freeMaterializedAggregate(&aggregate);
+    }
+    freeMaterializedAggregateNames(names, numberOfAggregates);
+}
+
+/*
+ *  loadOperator()
+ *  Is used to load .csv files into the database. A load replaces the values of its
+ *  columns, unless it is given as load("file",append), which adds its rows after them.
+ */
+void loadOperator(int connectionfd, parsedQuery* query)
+{
+    // error checking
+    if (query == NULL)
+    {
+        raiseDatabaseException(connectionfd, "loadOperator\0", "Query was NULL\0", NULL);
+        return;
+    }
+
+    // error check the arguments
+    char* fileName = queryArgument(query, 0);
+    char* mode = queryArgument(query, 1);
+    bool append = (mode != NULL) && (strcmp(mode, "append") == 0);
+    if ((fileName == NULL) || (fileName[0] == '\0') || ((mode != NULL) && !append) || (query->numberOfArguments > 2))
+    {
+        raiseDatabaseException(connectionfd, "loadOperator\0", "Ensure the format of the query is \"load(\"file\"[,append])\"\0", NULL);
+        return;
+    }
+
+    // create a path to the csvTables folder with that filename
+    char* filePath = arenaAllocate(&currentSession->queryArena, strlen(fileName) + 11);
+    sprintf(filePath, "csvTables/%s", fileName);
+    filePath[strlen(fileName) + 10] = '\0';
+
+    // try to open the file
+    FILE* fp = fopen(filePath, "r");
+    if (fp == NULL)
+    {
+        raiseDatabaseException(connectionfd, "loadOperator\0", "The file ~ does not exist in the database\0", fileName);
+        return;
+    }
+
+    // get all of the columns in the file
+    char* columnBuffer = arenaAllocate(&currentSession->queryArena, 10 * BUFSIZ);
+    int columnBufferIndex = 0;
+    int numberOfColumns = 1;
+    while(!feof(fp))
+    {
+        char character = fgetc(fp);
+        if (character == '\n')
+        {
+            columnBuffer[columnBufferIndex++] = '\0';
+            break;
+        }
+        else if (character == ',')
+        {
+            numberOfColumns++;
+        }
+        columnBuffer[columnBufferIndex++] = character;
+    }
+
+    // create an array of all the column names
+    char** columnNames = arenaAllocate(&currentSession->queryArena, numberOfColumns * sizeof(char*));
+    char* position;
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        // copy the string
+        char* parsedColumnName = (i == 0) ? strtok_r(columnBuffer, ",", &position) : strtok_r(NULL, ",", &position);
+        char* columnName = arenaStringCopy(&currentSession->queryArena, parsedColumnName);
+        columnNames[i] = columnName;
+
+        // make sure the column exists in the database
+        if (columnSnapshotPath(columnName) == NULL)
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Could not load file into database, create a database file for the column ~ first\0", columnName);
+            fclose(fp);
+            return;
+        }
+    }
+
+    // create the an array for storing the integers. they are parsed as int64s and narrowed to the
+    // type of each column once it is known
+    long long** columnData = arenaAllocate(&currentSession->queryArena, numberOfColumns * sizeof(long long*));
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        columnData[i] = malloc(BUFSIZ * sizeof(long long));
+    }
+
+    // variables for reading
+    int currentArrayIndex = 0;
+    int currentArraySize = BUFSIZ * sizeof(long long);
+    size_t sizeForGetline = BUFSIZ * sizeof(int);
+    char* readingBuffer = malloc(BUFSIZ * sizeof(int));
+    char* location = NULL;
+
+    // read data
+    while (getline(&readingBuffer, &sizeForGetline, fp) != -1)
+    {
+        for (int i = 0; i < numberOfColumns; i++)
+        {
+            // parse and create an integer
+            char* buf = (i == 0) ? strtok_r(readingBuffer, ",\n", &location) : strtok_r(NULL, ",\n", &location);
             assert(buf != NULL);
-            int intToStore = atoi(buf);
+            long long intToStore = atoll(buf);
+
+            // store the integer
+            columnData[i][currentArrayIndex] = intToStore;
+        }
+        currentArrayIndex++;
+
+        // increase array sizes if needed
+        if ((currentArrayIndex + 1) == (currentArraySize / sizeof(long long)))
+        {
+            int newArraySize = currentArraySize + (BUFSIZ * sizeof(long long));
+            for (int i = 0; i < numberOfColumns; i++)
+            {
+                columnData[i] = increaseArraySizeByMultiplier(connectionfd, columnData[i], newArraySize);
+                if (columnData[i] == NULL)
+                {
+                    // clean up
+                    raiseDatabaseException(connectionfd, "loadOperator\0", "increaseArraySizeByMultiplier returned NULL\0", NULL);
+                    for (int j = 0; j < numberOfColumns; j++)
+                    {
+                        free(columnData[j]);
+                    }
+                    free(readingBuffer);
+                    fclose(fp);
+                    return;
+                }
+            }
+
+            // update the current array size
+            currentArraySize = newArraySize;
+        }
+    }
+
+    // a load into partitioned columns orders its rows by partition, and every column of the load is
+    // written in that order so their positions stay aligned (the partitioned ones a file per partition)
+    partitionDirectory* directories = arenaAllocate(&currentSession->queryArena, numberOfColumns * sizeof(partitionDirectory));
+    bool* partitioned = arenaAllocate(&currentSession->queryArena, numberOfColumns * sizeof(bool));
+    int partitionStarts[MAX_PARTITIONS + 1];
+    if (!orderRowsByPartition(connectionfd, columnNames, columnData, numberOfColumns, currentArrayIndex, directories, partitioned, partitionStarts))
+    {
+        for (int j = 0; j < numberOfColumns; j++)
+        {
+            free(columnData[j]);
+        }
+        free(readingBuffer);
+        fclose(fp);
+        return;
+    }
+    for (int i = 0; append && (i < numberOfColumns); i++)
+    {
+        if (partitioned[i])
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Rows cannot be appended to the partitioned column ~, load all of its rows instead\0", columnNames[i]);
+            for (int j = 0; j < numberOfColumns; j++)
+            {
+                free(columnData[j]);
+            }
+            free(readingBuffer);
+            fclose(fp);
+            return;
+        }
+    }
+
+    // write data to files, each column as a new segment. the segments are synced and published
+    // together once every column is written, so readers see either the whole load or none of it
+    // and a crash leaves each column either as it was or fully loaded
+    beginColumnWrites();
+    int columnsWritten = 0;
+    void* narrowedData = malloc(((size_t)currentArrayIndex + 1) * sizeof(long long));
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        // read the header info of the column's current file
+        char* columnPath = columnSnapshotPath(columnNames[i]);
+        FILE* columnFp = (columnPath == NULL) ? NULL : fopen(columnPath, "rb");
+        if (columnFp == NULL)
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "columnFp was a NULL pointer. Could not find a file for the column ~ in the database\0", columnNames[i]);
+            break;
+        }
+        int headerStorageType = 0;
+        int headerStorageSize = 0;
+        fread(&headerStorageType, sizeof(int), 1, columnFp);
+        fread(&headerStorageSize, sizeof(int), 1, columnFp);
+        fclose(columnFp);
+        if (!isValidColumnHeader(headerStorageType))
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. The column ~ does not have valid header info\0", columnNames[i]);
+            break;
+        }
+
+        // narrow the values to the type of the column, rejecting the load if one does not fit
+        int valueType = columnValueType(headerStorageType);
+        if (narrowKernels[valueType](columnData[i], currentArrayIndex, narrowedData) != -1)
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. A value is out of the range of the type of the column ~\0", columnNames[i]);
+            break;
+        }
+
+        // the partitions of a partitioned column are written in parallel
+        if (partitioned[i])
+        {
+            long long writeStart = profileStart();
+            if (!stagePartitionedColumn(columnNames[i], &directories[i], headerStorageType, narrowedData, columnData[i], partitionStarts))
+            {
+                raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. Could not write the partitions of the column ~\0", columnNames[i]);
+                break;
+            }
+            profileEnd(PROFILE_IO, writeStart);
+            profileBytes((long long)currentArrayIndex * columnTypeWidths[valueType]);
+            profileRows(currentArrayIndex, currentArrayIndex);
+            columnsWritten++;
+            continue;
+        }
+
+        // an append copies the values the column has ahead of the new ones, from its newest version
+        // (which holding the writers lock keeps from changing)
+        long long writeStart = profileStart();
+        int existingBytes = 0;
+        FILE* existingFp = NULL;
+        if (append)
+        {
+            char* newestPath = newestColumnPath(columnNames[i]);
+            existingFp = (newestPath == NULL) ? NULL : fopen(newestPath, "rb");
+            int existingStorageType = 0;
+            bool readable = (existingFp != NULL) && (fread(&existingStorageType, sizeof(int), 1, existingFp) == 1) &&
+                            (fread(&existingBytes, sizeof(int), 1, existingFp) == 1) && (existingStorageType == headerStorageType);
+            if (!readable || ((long long)existingBytes + ((long long)currentArrayIndex * columnTypeWidths[valueType]) > INT_MAX))
+            {
+                raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. Could not append to the values of the column ~\0", columnNames[i]);
+                if (existingFp != NULL)
+                {
+                    fclose(existingFp);
+                }
+                break;
+            }
+        }
+
+        // write the header and then the values to the new segment in large asynchronous blocks
+        int newBytes = currentArrayIndex * columnTypeWidths[valueType];
+        headerStorageSize = existingBytes + newBytes;
+        FILE* segmentFp = createColumnSegment(columnNames[i]);
+        bool written = (segmentFp != NULL) && (fwrite(&headerStorageType, sizeof(int), 1, segmentFp) == 1) &&
+                       (fwrite(&headerStorageSize, sizeof(int), 1, segmentFp) == 1) && (fflush(segmentFp) == 0) &&
+                       ((existingBytes == 0) || copyFileRange(fileno(existingFp), 2 * sizeof(int), fileno(segmentFp), 2 * sizeof(int), existingBytes)) &&
+                       writeFileAsync(fileno(segmentFp), narrowedData, newBytes, (2 * sizeof(int)) + existingBytes);
+        if (existingFp != NULL)
+        {
+            fclose(existingFp);
+        }
+        if (!written && (segmentFp != NULL))
+        {
+            discardColumnSegment(columnNames[i], segmentFp);
+        }
+        if (!written || !stageColumnSegment(columnNames[i], segmentFp))
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. Could not write the values of the column ~\0", columnNames[i]);
+            break;
+        }
+        profileEnd(PROFILE_IO, writeStart);
+        profileBytes(headerStorageSize + (2 * sizeof(int)));
+        profileRows(currentArrayIndex, currentArrayIndex);
+        columnsWritten++;
+    }
+    // a load that failed at some column discards the columns staged before it
+    bool published = false;
+    if (columnsWritten == numberOfColumns)
+    {
+        refreshMaterializedAggregates(columnNames, columnData, numberOfColumns, currentArrayIndex, append);
+        long long syncStart = profileStart();
+        published = publishColumnWrites();
+        profileEnd(PROFILE_IO, syncStart);
+        if (!published)
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. Could not publish the new data of the columns in ~\0", fileName);
+        }
+    }
+    else
+    {
+        abortColumnWrites();
+    }
+
+    // drop what was derived from the old data of the columns (statistics are kept over the values
+    // widened to ints). the sketches take appended rows as they are, while statistics over only the
+    // appended rows would be wrong, so they are gathered again when next needed
+    for (int i = 0; published && (i < numberOfColumns); i++)
+    {
+        widenKernels[COLUMN_INT64](columnData[i], currentArrayIndex, narrowedData);
+        invalidateCrackerColumn(columnNames[i]);
+        if (append)
+        {
+            markColumnStatisticsStale(columnNames[i]);
+            appendColumnSketches(columnNames[i], columnData[i], currentArrayIndex);
+        }
+        else
+        {
+            updateColumnStatistics(columnNames[i], narrowedData, currentArrayIndex);
+            updateColumnSketches(columnNames[i], columnData[i], currentArrayIndex);
+        }
+        invalidateColumnInResultCache(columnNames[i]);
+    }
+
+    // clean up
+    for (int j = 0; j < numberOfColumns; j++)
+    {
+        free(columnData[j]);
+    }
+    free(narrowedData);
+    free(readingBuffer);
+    fclose(fp);
+    if (!published)
+    {
+        return;
+    }
+
+    // create a message and write it to the client
+    char* prefix = "Loaded `\0";
+    char* suffix = "` into the database.\0";
+    char* message = createCustomMessage(connectionfd, prefix, fileName, suffix);
+    if (message == NULL)
+    {
+        raiseDatabaseException(connectionfd, "loadOperator\0", "createCustomMessage() returned a NULL pointer\0", NULL);
+        return;
+    }
+    writeResponseToClient(connectionfd, message);
+}
+
+/*
+ *  orderRowsByPartition()
+ *  Finds the partitioning of the partitioned columns among those of a load (filling in
+ *  their directories, as of the query's snapshot) and reorders the rows of every column
+ *  by partition, the rows of partition i starting at partitionStarts[i]. The columns
+ *  partitioned must all be partitioned the same way, and their key must be loaded with
+ *  them. Returns false (after raising an exception) if they are not.
+ */
+bool orderRowsByPartition(int connectionfd, char** columnNames, long long** columnData, int numberOfColumns, int numberOfRows,
+                          partitionDirectory* directories, bool* partitioned, int* partitionStarts)
+{
+    // find how the load is partitioned, if at all
+    partitionDirectory* directory = NULL;
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        partitioned[i] = readPartitionDirectory(columnNames[i], &directories[i]);
+        if (partitioned[i] && (directory == NULL))
+        {
+            directory = &directories[i];
+        }
+        else if (partitioned[i] && !samePartitioning(&directories[i], directory))
+        {
+            raiseDatabaseException(connectionfd, "loadOperator\0", "The columns of a load must be partitioned the same way, ~ is not\0", columnNames[i]);
+            return false;
+        }
+    }
+    if (directory == NULL)
+    {
+        return true;
+    }
+    int key = -1;
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        key = (strcmp(columnNames[i], directory->keyColumn) == 0) ? i : key;
+    }
+    if (key == -1)
+    {
+        raiseDatabaseException(connectionfd, "loadOperator\0", "The partition key ~ must be loaded along with the columns partitioned by it\0", directory->keyColumn);
+        return false;
+    }
 
-            // store the integer
-            columnData[i][currentArrayIndex] = intToStore;
+    // route every row by its key and order the rows by partition (stably, so rows of a partition keep
+    // the order they were loaded in)
+    int* rowPartitions = malloc((numberOfRows + 1) * sizeof(int));
+    int* rowOrder = malloc((numberOfRows + 1) * sizeof(int));
+    int nextRow[MAX_PARTITIONS + 1];
+    memset(nextRow, 0, sizeof(nextRow));
+    for (int row = 0; row < numberOfRows; row++)
+    {
+        rowPartitions[row] = partitionOfKey(directory, columnData[key][row]);
+        nextRow[rowPartitions[row] + 1]++;
+    }
+    for (int i = 0; i < directory->numberOfPartitions; i++)
+    {
+        nextRow[i + 1] += nextRow[i];
+    }
+    memcpy(partitionStarts, nextRow, (directory->numberOfPartitions + 1) * sizeof(int));
+    for (int row = 0; row < numberOfRows; row++)
+    {
+        rowOrder[nextRow[rowPartitions[row]]++] = row;
+    }
+    for (int i = 0; i < numberOfColumns; i++)
+    {
+        long long* reordered = malloc((numberOfRows + 1) * sizeof(long long));
+        for (int row = 0; row < numberOfRows; row++)
+        {
+            reordered[row] = columnData[i][rowOrder[row]];
         }
-        currentArrayIndex++;
+        free(columnData[i]);
+        columnData[i] = reordered;
+    }
+    free(rowPartitions);
+    free(rowOrder);
+    return true;
+}
 
-        // increase array sizes if needed
-        if ((currentArrayIndex + 1) == (currentArraySize / sizeof(int)))
+/*
+ *  writePartitionTask()
+ *  Writes a partition of a column being loaded as a new segment of its own, and notes
+ *  the range of its values for the partition directory.
+ */
+void writePartitionTask(void* task)
+{
+    partitionWrite* partition = task;
+    clearPartitionInfo(&partition->info);
+    partition->info.numberOfValues = partition->numberOfValues;
+    for (int i = 0; i < partition->numberOfValues; i++)
+    {
+        long long value = partition->parsedValues[i];
+        partition->info.minimum = (value < partition->info.minimum) ? value : partition->info.minimum;
+        partition->info.maximum = (value > partition->info.maximum) ? value : partition->info.maximum;
+    }
+    int headerStorageSize = partition->numberOfValues * columnTypeWidths[columnValueType(partition->headerStorageType)];
+    FILE* fp = createColumnSegment(partition->columnName);
+    bool written = (fp != NULL) && (fwrite(&partition->headerStorageType, sizeof(int), 1, fp) == 1) &&
+                   (fwrite(&headerStorageSize, sizeof(int), 1, fp) == 1) && (fflush(fp) == 0) &&
+                   writeFileAsync(fileno(fp), partition->values, headerStorageSize, 2 * sizeof(int));
+    if (!written && (fp != NULL))
+    {
+        discardColumnSegment(partition->columnName, fp);
+    }
+    partition->fp = written ? fp : NULL;
+}
+
+/*
+ *  stagePartitionedColumn()
+ *  Writes the values of a partitioned column being loaded (ordered by partition, the
+ *  partitions starting at partitionStarts) as a new segment per partition, in parallel,
+ *  and then its new partition directory. The segments are staged only if all of them
+ *  were written. The caller holds the writers lock. Returns false on error.
+ */
+bool stagePartitionedColumn(char* column, partitionDirectory* directory, int headerStorageType, void* values, long long* parsedValues, int* partitionStarts)
+{
+    int width = columnTypeWidths[columnValueType(headerStorageType)];
+    size_t nameLength = strlen(column) + 16;
+    char* names = malloc(directory->numberOfPartitions * nameLength);
+    partitionWrite writes[MAX_PARTITIONS];
+    for (int i = 0; i < directory->numberOfPartitions; i++)
+    {
+        writes[i].columnName = names + (i * nameLength);
+        partitionColumnName(column, i, writes[i].columnName);
+        writes[i].headerStorageType = headerStorageType & ~PARTITIONED_COLUMN;
+        writes[i].values = (char*)values + ((size_t)partitionStarts[i] * width);
+        writes[i].parsedValues = parsedValues + partitionStarts[i];
+        writes[i].numberOfValues = partitionStarts[i + 1] - partitionStarts[i];
+    }
+    runPartitionTasks(writePartitionTask, writes, sizeof(partitionWrite), directory->numberOfPartitions);
+
+    // stage the partitions, or none of them
+    bool written = true;
+    for (int i = 0; i < directory->numberOfPartitions; i++)
+    {
+        written = written && (writes[i].fp != NULL);
+    }
+    bool staged = written;
+    for (int i = 0; i < directory->numberOfPartitions; i++)
+    {
+        if (!written && (writes[i].fp != NULL))
+            discardColumnSegment(writes[i].columnName, writes[i].fp);
+        else if (written)
+            staged = stageColumnSegment(writes[i].columnName, writes[i].fp) && staged;
+        directory->partitions[i] = writes[i].info;
+    }
+    free(names);
+    if (!staged)
+    {
+        return false;
+    }
+
+    // then the directory, which the new partitions are read through
+    int headerStorageSize = sizeof(partitionDirectory);
+    FILE* fp = createColumnSegment(column);
+    written = (fp != NULL) && (fwrite(&headerStorageType, sizeof(int), 1, fp) == 1) &&
+              (fwrite(&headerStorageSize, sizeof(int), 1, fp) == 1) && (fwrite(directory, sizeof(partitionDirectory), 1, fp) == 1);
+    if (!written && (fp != NULL))
+    {
+        discardColumnSegment(column, fp);
+    }
+    return written && stageColumnSegment(column, fp);
+}
+
+/*
+ *  findNextReference()
+ *  Returns the index of the first statement after `start` that takes `variableName`
+ *  as an argument, or -1 if there is none.
+ */
+int findNextReference(batchStatement* statements, int numberOfStatements, int start, char* variableName)
+{
+    for (int i = start + 1; i < numberOfStatements; i++)
+    {
+        for (int j = 0; j < statements[i].query.numberOfArguments; j++)
         {
-            int newArraySize = currentArraySize + (BUFSIZ * sizeof(int));
-            for (int i = 0; i < numberOfColumns; i++)
+            if (strcmp(statements[i].query.arguments[j], variableName) == 0)
             {
-                columnData[i] = increaseArraySizeByMultiplier(connectionfd, columnData[i], newArraySize);
-                if (columnData[i] == NULL)
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+/*
+ *  isChainIsolated()
+ *  Returns true if the statements strictly between first and last (other than those of
+ *  the chain) can be evaluated after a fused chain spanning them without changing what
+ *  either computes: they only read, and do not assign to the chain's variables.
+ */
+bool isChainIsolated(batchStatement* statements, int first, int last, batchStatement* selectStatement, batchStatement* fetchStatement,
+                     batchStatement* aggregateStatement)
+{
+    for (int i = first + 1; i < last; i++)
+    {
+        parsedQuery* query = &statements[i].query;
+        if ((&statements[i] == fetchStatement) || (query->command == NULL))
+        {
+            continue;
+        }
+        bool reads = query->command->storesResult || (strcmp(query->commandName, "print") == 0);
+        bool assignsToChain = (query->outputVariable != NULL) &&
+            ((strcmp(query->outputVariable, selectStatement->query.outputVariable) == 0) ||
+             (strcmp(query->outputVariable, fetchStatement->query.outputVariable) == 0) ||
+             ((aggregateStatement != NULL) && (strcmp(query->outputVariable, aggregateStatement->query.outputVariable) == 0)));
+        if (!reads || assignsToChain)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ *  deferBatchResponse()
+ *  Moves the responses written to the batch since start into a statement of the batch,
+ *  to be written when the batch reaches it, so a fused chain evaluated early still
+ *  responds in the order of its statements.
+ */
+void deferBatchResponse(batchStatement* statement, int start)
+{
+    int length = batchResponseLength - start;
+    statement->deferredResponse = arenaAllocate(&currentSession->queryArena, length + 1);
+    memcpy(statement->deferredResponse, batchResponse + start, length);
+    statement->deferredResponse[length] = '\0';
+    batchResponseLength = start;
+    batchResponse[batchResponseLength] = '\0';
+}
+
+/*
+ *  batchOperator()
+ *  Evaluates a batch of ';' separated statements. Chains of the form
+ *  s=select(c,lo,hi); v=fetch(d,s); m=sum(v) are recognized and evaluated as a single
+ *  pass over the columns, and the variables in the middle of a chain are only
+ *  materialized if a later statement of the batch (e.g. a print) uses them. A chain
+ *  is only fused if nothing between its statements writes, and its responses are
+ *  written in the order of its statements.
+ */
+void batchOperator(int connectionfd, char* query)
+{
+    // split the batch into statements (at the ';'s outside of quotes and parentheses, as isBatch()
+    // finds them, so e.g. profile(a;b) stays one statement)
+    int numberOfStatements = 1;
+    for (char* end = findStatementEnd(query); *end == ';'; end = findStatementEnd(end + 1))
+    {
+        numberOfStatements++;
+    }
+    batchStatement* statements = arenaAllocate(&currentSession->queryArena, numberOfStatements * sizeof(batchStatement));
+    int parsedStatements = 0;
+    long long parseStart = profileStart();
+    for (char* text = query, *next; text != NULL; text = next)
+    {
+        char* end = findStatementEnd(text);
+        next = (*end == ';') ? end + 1 : NULL;
+        *end = '\0';
+        while (*text == ' ')
+            text++;
+        if (*text == '\0')
+            continue;
+
+        // malformed statements are kept (without a command) so they report an error in order
+        batchStatement* statement = &statements[parsedStatements++];
+        statement->executed = false;
+        statement->deferredResponse = NULL;
+        statement->temporaryVariables = NULL;
+        statement->numberOfTemporaryVariables = 0;
+        if (!tokenizeQuery(text, &statement->query))
+        {
+            memset(&statement->query, 0, sizeof(parsedQuery));
+        }
+    }
+    numberOfStatements = parsedStatements;
+    profileEnd(PROFILE_PARSE, parseStart);
+    orderConjunctiveSelects(connectionfd, statements, numberOfStatements);
+
+    // collect the responses of the batch (a batch evaluated inside another query, e.g. a
+    // profile, adds its responses to the enclosing ones)
+    char* enclosingResponse = batchResponse;
+    int enclosingResponseLength = batchResponseLength;
+    batchResponse = malloc(1);
+    batchResponse[0] = '\0';
+    batchResponseLength = 0;
+
+    // evaluate each statement, fusing chains where possible
+    for (int i = 0; i < numberOfStatements; i++)
+    {
+        batchStatement* statement = &statements[i];
+        if (statement->executed)
+        {
+            // a statement of a fused chain responds in its place
+            if ((statement->deferredResponse != NULL) && (*statement->deferredResponse != '\0'))
+            {
+                int length = strlen(statement->deferredResponse);
+                batchResponse = realloc(batchResponse, batchResponseLength + length + 1);
+                memcpy(batchResponse + batchResponseLength, statement->deferredResponse, length + 1);
+                batchResponseLength += length;
+            }
+            continue;
+        }
+
+        // look for a select over a column that feeds a fetch (and possibly an aggregate)
+        if ((statement->query.commandName != NULL) && (strcmp(statement->query.commandName, "select") == 0) &&
+            (statement->query.outputVariable != NULL) && (statement->query.numberOfArguments >= 1) && (statement->query.numberOfArguments <= 3) &&
+            (selectFilterArgument(&statement->query) == NULL))
+        {
+            int fetchIndex = findNextReference(statements, numberOfStatements, i, statement->query.outputVariable);
+            batchStatement* fetchStatement = (fetchIndex == -1) ? NULL : &statements[fetchIndex];
+            if ((fetchStatement != NULL) && (fetchStatement->query.commandName != NULL) && (strcmp(fetchStatement->query.commandName, "fetch") == 0) &&
+                (fetchStatement->query.outputVariable != NULL) && (fetchStatement->query.numberOfArguments == 2) &&
+                (strcmp(fetchStatement->query.arguments[1], statement->query.outputVariable) == 0) &&
+                isChainIsolated(statements, i, fetchIndex, statement, fetchStatement, NULL))
+            {
+                // an aggregate may consume the fetched values
+                int aggregateIndex = findNextReference(statements, numberOfStatements, fetchIndex, fetchStatement->query.outputVariable);
+                batchStatement* aggregateStatement = (aggregateIndex == -1) ? NULL : &statements[aggregateIndex];
+                if ((aggregateStatement != NULL) && ((aggregateStatement->query.outputVariable == NULL) ||
+                    ((strcmp(aggregateStatement->query.commandName, "min") != 0) && (strcmp(aggregateStatement->query.commandName, "max") != 0) &&
+                     (strcmp(aggregateStatement->query.commandName, "sum") != 0) && (strcmp(aggregateStatement->query.commandName, "avg") != 0)) ||
+                    !isChainIsolated(statements, i, aggregateIndex, statement, fetchStatement, aggregateStatement)))
                 {
-                    // clean up
-                    raiseDatabaseException(connectionfd, "loadOperator\0", "increaseArraySizeByMultiplier returned NULL\0", NULL);
-                    for (int j = 0; j < numberOfColumns; j++)
-                    {
-                        free(columnNames[j]);
-                        free(columnData[j]);
-                    }
-                    free(columnNames);
-                    free(columnBuffer);
-                    free(filePath);
-                    free(readingBuffer);
-                    fclose(fp);
-                    return;
+                    aggregateStatement = NULL;
+                }
+
+                // intermediates are materialized only if something else in the batch uses them
+                bool materializePositions = (findNextReference(statements, numberOfStatements, fetchIndex, statement->query.outputVariable) != -1);
+                bool materializeValues = (aggregateStatement == NULL) ||
+                    (findNextReference(statements, numberOfStatements, aggregateIndex, fetchStatement->query.outputVariable) != -1);
+                if (executeFusedChain(connectionfd, statement, fetchStatement, aggregateStatement, materializePositions, materializeValues))
+                {
+                    continue;
                 }
             }
+        }
 
-            // update the current array size
-            currentArraySize = newArraySize;
+        // otherwise evaluate the statement on its own
+        statement->executed = true;
+        executeParsedQuery(connectionfd, &statement->query);
+
+        // the last statement of a reordered chain of selects drops the chain's internal variables
+        for (int j = 0; j < statement->numberOfTemporaryVariables; j++)
+        {
+            dropIntermediateResult(currentSession, statement->temporaryVariables[j]);
         }
     }
 
-    // write data to files
-    for (int i = 0; i < numberOfColumns; i++)
+    // write all of the responses to the client at once
+    char* response = batchResponse;
+    if (batchResponseLength > 0)
     {
-        // open the file
-        char* columnPath = malloc(strlen(columnNames[i] + 4));
-        sprintf(columnPath, "db/%s", columnNames[i]);
-        columnPath[strlen(columnPath)] = '\0';
-        FILE* columnFp = fopen(columnPath, "rb+");
-        if (columnFp == NULL)
+        response[batchResponseLength - 1] = '\0';
+    }
+    batchResponse = enclosingResponse;
+    batchResponseLength = enclosingResponseLength;
+    writeResponseToClient(connectionfd, response);
+
+    // clean up
+    free(response);
+}
+
+/*
+ *  estimateColumnSelectivity()
+ *  Estimates the fraction of a column's values in [low, high] from its statistics,
+ *  gathering the statistics first if needed. Returns 1.0 if the column is invalid.
+ */
+double estimateColumnSelectivity(char* column, int low, int high)
+{
+    columnStatistics statistics;
+    if (!findColumnStatistics(column, &statistics))
+    {
+        int numberOfValuesInColumn;
+        int valueType;
+        void* arrayOfFileData = readColumnFromDisk(0, NULL, column, &numberOfValuesInColumn, &valueType);
+        if (arrayOfFileData == NULL)
         {
-            // clean up
-            raiseDatabaseException(connectionfd, "loadOperator\0", "columnFp was a NULL pointer. Could not find a file for the column ~ in the database\0", columnNames[i]);
-            for (int j = 0; j < numberOfColumns; j++)
+            return 1.0;
+        }
+
+        // statistics are kept over values widened to ints
+        if (valueType != COLUMN_INT32)
+        {
+            int* widened = malloc((numberOfValuesInColumn + 1) * sizeof(int));
+            widenKernels[valueType](arrayOfFileData, numberOfValuesInColumn, widened);
+            free(arrayOfFileData);
+            arrayOfFileData = widened;
+        }
+        updateColumnStatistics(column, arrayOfFileData, numberOfValuesInColumn);
+        free(arrayOfFileData);
+
+        // an append may have made them stale again in the meantime
+        if (!findColumnStatistics(column, &statistics))
+        {
+            return 1.0;
+        }
+    }
+    return estimateSelectivity(&statistics, low, high);
+}
+
+/*
+ *  orderConjunctiveSelects()
+ *  Finds chains of conjunctive selects in a batch, e.g.
+ *  s1=select(a,0,10); f=fetch(b,s1); s2=select(s1,f,5,7), and rewrites them so that the
+ *  predicate with the lowest estimated selectivity is evaluated with the full scan and
+ *  the others refine progressively smaller position lists. Chains whose intermediate
+ *  variables are used elsewhere in the batch are left alone. The intermediate variables
+ *  of a reordered chain hold other predicates and columns than the user's, so they are
+ *  given internal names and dropped once the chain is done.
+ */
+void orderConjunctiveSelects(int connectionfd, batchStatement* statements, int numberOfStatements)
+{
+    for (int i = 0; i < numberOfStatements; i++)
+    {
+        // a chain starts with a select over a column
+        batchStatement* head = &statements[i];
+        if ((head->query.commandName == NULL) || (strcmp(head->query.commandName, "select") != 0) ||
+            (head->query.outputVariable == NULL) || (head->query.numberOfArguments < 1) || (head->query.numberOfArguments > 3) ||
+            (selectFilterArgument(&head->query) != NULL) || (lookupIntermediateResult(currentSession, head->query.arguments[0]) != NULL))
+        {
+            continue;
+        }
+
+        // follow fetch/refining select pairs for as long as they only feed each other
+        char* predicateColumns[16];
+        char* predicateBounds[16][2];
+        double selectivities[16];
+        int chain[32];
+        int numberOfPredicates = 1;
+        int chainLength = 0;
+        predicateColumns[0] = head->query.arguments[0];
+        predicateBounds[0][0] = (head->query.numberOfArguments >= 2) ? head->query.arguments[1] : NULL;
+        predicateBounds[0][1] = (head->query.numberOfArguments == 3) ? head->query.arguments[2] : predicateBounds[0][0];
+        int current = i;
+        while (numberOfPredicates < 16)
+        {
+            char* positionsName = statements[current].query.outputVariable;
+            int fetchIndex = findNextReference(statements, numberOfStatements, current, positionsName);
+            if ((fetchIndex == -1) || (statements[fetchIndex].query.commandName == NULL) ||
+                (strcmp(statements[fetchIndex].query.commandName, "fetch") != 0) || (statements[fetchIndex].query.outputVariable == NULL) ||
+                (statements[fetchIndex].query.numberOfArguments != 2) || (strcmp(statements[fetchIndex].query.arguments[1], positionsName) != 0))
             {
-                free(columnNames[j]);
-                free(columnData[j]);
+                break;
             }
-            free(columnNames);
-            free(filePath);
-            free(columnPath);
-            free(columnBuffer);
-            free(readingBuffer);
-            fclose(fp);
-            return;
+            char* valuesName = statements[fetchIndex].query.outputVariable;
+            int refineIndex = findNextReference(statements, numberOfStatements, fetchIndex, valuesName);
+            if ((refineIndex == -1) || (statements[refineIndex].query.commandName == NULL) ||
+                (strcmp(statements[refineIndex].query.commandName, "select") != 0) || (statements[refineIndex].query.outputVariable == NULL) ||
+                (statements[refineIndex].query.numberOfArguments < 3) || (selectFilterArgument(&statements[refineIndex].query) != NULL) ||
+                (strcmp(statements[refineIndex].query.arguments[0], positionsName) != 0) ||
+                (strcmp(statements[refineIndex].query.arguments[1], valuesName) != 0) ||
+                (findNextReference(statements, numberOfStatements, fetchIndex, positionsName) != refineIndex) ||
+                (findNextReference(statements, numberOfStatements, refineIndex, positionsName) != -1) ||
+                (findNextReference(statements, numberOfStatements, refineIndex, valuesName) != -1))
+            {
+                break;
+            }
+            predicateColumns[numberOfPredicates] = statements[fetchIndex].query.arguments[0];
+            predicateBounds[numberOfPredicates][0] = statements[refineIndex].query.arguments[2];
+            predicateBounds[numberOfPredicates][1] = (statements[refineIndex].query.numberOfArguments == 4) ? statements[refineIndex].query.arguments[3] : statements[refineIndex].query.arguments[2];
+            numberOfPredicates++;
+            chain[chainLength++] = fetchIndex;
+            chain[chainLength++] = refineIndex;
+            current = refineIndex;
+        }
+        if (numberOfPredicates < 2)
+        {
+            continue;
         }
 
-        // read, store, and reset the header info
-        int headerStorageType;
-        int headerStorageSize;
-        fread(&headerStorageType, sizeof(int), 1, columnFp);
-        fread(&headerStorageSize, sizeof(int), 1, columnFp);
-        if ((headerStorageType != UNSORTED) && (headerStorageType != SORTED) && (headerStorageType != BTREE))
+        // a chain assigning to existing variables is left to report it
+        bool outputsFree = (lookupIntermediateResult(currentSession, head->query.outputVariable) == NULL);
+        for (int c = 0; c < chainLength; c++)
         {
-            // clean up
-            raiseDatabaseException(connectionfd, "loadOperator\0", "Unable to do this load operation. The column ~ does not have valid header info\0", columnNames[i]);
-            for (int j = 0; j < numberOfColumns; j++)
+            outputsFree = outputsFree && (lookupIntermediateResult(currentSession, statements[chain[c]].query.outputVariable) == NULL);
+        }
+        if (!outputsFree)
+        {
+            i = current;
+            continue;
+        }
+
+        // order the predicates by estimated selectivity (insertion sort, chains are short)
+        int order[16];
+        for (int p = 0; p < numberOfPredicates; p++)
+        {
+            // (statistics are kept over ints, so wider bounds are clamped)
+            long long low = (predicateBounds[p][0] == NULL) ? INT_MIN : atoll(predicateBounds[p][0]);
+            long long high = (predicateBounds[p][1] == NULL) ? INT_MAX : atoll(predicateBounds[p][1]);
+            low = (low < INT_MIN) ? INT_MIN : ((low > INT_MAX) ? INT_MAX : low);
+            high = (high < INT_MIN) ? INT_MIN : ((high > INT_MAX) ? INT_MAX : high);
+            selectivities[p] = estimateColumnSelectivity(predicateColumns[p], (int)low, (int)high);
+            int q = p;
+            while ((q > 0) && (selectivities[order[q - 1]] > selectivities[p]))
             {
-                free(columnNames[j]);
-                free(columnData[j]);
+                order[q] = order[q - 1];
+                q--;
             }
-            free(columnNames);
-            free(columnBuffer);
-            free(readingBuffer);
-            fclose(columnFp);
-            fclose(fp);
-            return;
+            order[q] = p;
+        }
+        bool alreadyOrdered = true;
+        for (int p = 0; p < numberOfPredicates; p++)
+        {
+            alreadyOrdered = alreadyOrdered && (order[p] == p);
+        }
+        if (alreadyOrdered)
+        {
+            i = current;
+            continue;
         }
 
-        // write to the file
-        headerStorageSize = 0;
-        for (int j = 0; j < currentArrayIndex; j++)
+        // the chain's intermediate variables get internal names, only its final positions keep the
+        // user's name (they are the same whatever the order)
+        batchStatement* last = &statements[chain[chainLength - 1]];
+        last->temporaryVariables = arenaAllocate(&currentSession->queryArena, chainLength * sizeof(char*));
+        for (int c = -1; c < chainLength - 1; c++)
         {
-            fwrite(&columnData[i][j], sizeof(int), 1, columnFp);
-            headerStorageSize += (int)sizeof(int);
+            batchStatement* intermediate = (c == -1) ? head : &statements[chain[c]];
+            char* name = arenaAllocate(&currentSession->queryArena, strlen(intermediate->query.outputVariable) + 2);
+            sprintf(name, "~%s", intermediate->query.outputVariable);
+            intermediate->query.outputVariable = name;
+            last->temporaryVariables[last->numberOfTemporaryVariables++] = name;
         }
 
-        // update the header and clean up
-        fseek(columnFp, sizeof(int), SEEK_SET);
-        fwrite(&headerStorageSize, sizeof(int), 1, columnFp);
-        fclose(columnFp);
+        // rewrite the arguments of the chain so it takes the predicates in the new order (the
+        // predicates were captured above, so the statements can be rewritten in place). an unbounded
+        // predicate stays unbounded: a select over the whole column, or a refine by the widest range
+        for (int p = 0; p < numberOfPredicates; p++)
+        {
+            int predicate = order[p];
+            char* low = (predicateBounds[predicate][0] == NULL) ? "-9223372036854775808" : predicateBounds[predicate][0];
+            char* high = (predicateBounds[predicate][1] == NULL) ? "9223372036854775807" : predicateBounds[predicate][1];
+            if (p == 0)
+            {
+                head->query.arguments[0] = predicateColumns[predicate];
+                head->query.arguments[1] = predicateBounds[predicate][0];
+                head->query.arguments[2] = predicateBounds[predicate][1];
+                head->query.numberOfArguments = (predicateBounds[predicate][0] == NULL) ? 1 : 3;
+                continue;
+            }
+            batchStatement* previous = (p == 1) ? head : &statements[chain[2 * p - 3]];
+            batchStatement* fetchStatement = &statements[chain[2 * p - 2]];
+            batchStatement* refineStatement = &statements[chain[2 * p - 1]];
+            fetchStatement->query.arguments[0] = predicateColumns[predicate];
+            fetchStatement->query.arguments[1] = previous->query.outputVariable;
+            refineStatement->query.arguments[0] = previous->query.outputVariable;
+            refineStatement->query.arguments[1] = fetchStatement->query.outputVariable;
+            refineStatement->query.arguments[2] = low;
+            refineStatement->query.arguments[3] = high;
+            refineStatement->query.numberOfArguments = 4;
+        }
+        printf("Reordered %d conjunctive selects by estimated selectivity.\n", numberOfPredicates);
+        i = current;
+    }
+}
 
-        // update the file size
-        fseek(fp, sizeof(int), SEEK_SET);
-        int fileSizeActual = i * sizeof(int);
-        fwrite(&fileSizeActual, sizeof(int), 1, fp);
+/*
+ *  executeFusedChain()
+ *  Evaluates a select over a column, a fetch of another column at the selected positions,
+ *  and optionally an aggregate over the fetched values in one pass over cache sized chunks
+ *  of both columns. Positions and values are only materialized when requested. Returns
+ *  false without evaluating anything if the chain cannot be fused.
+ */
+bool executeFusedChain(int connectionfd, batchStatement* selectStatement, batchStatement* fetchStatement,
+                       batchStatement* aggregateStatement, bool materializePositions, bool materializeValues)
+{
+    // the output variables must not exist yet
+    if ((lookupIntermediateResult(currentSession, selectStatement->query.outputVariable) != NULL) ||
+        (lookupIntermediateResult(currentSession, fetchStatement->query.outputVariable) != NULL) ||
+        ((aggregateStatement != NULL) && (lookupIntermediateResult(currentSession, aggregateStatement->query.outputVariable) != NULL)))
+    {
+        return false;
     }
 
-    // clean up
-    for (int j = 0; j < numberOfColumns; j++)
+    // a chain that only computes an aggregate of the values of a column in a range (or of all of
+    // them) is answered from a materialized aggregate with that definition, if there is one
+    if ((aggregateStatement != NULL) && !materializePositions && !materializeValues &&
+        (strcmp(selectStatement->query.arguments[0], fetchStatement->query.arguments[0]) == 0) &&
+        answerChainFromMaterialized(connectionfd, selectStatement, fetchStatement, aggregateStatement))
     {
-        free(columnNames[j]);
-        free(columnData[j]);
+        return true;
     }
-    free(columnNames);
-    free(columnBuffer);
-    free(filePath);
-    free(readingBuffer);
-    fclose(fp);
 
-    // create a message and write it to the client
-    char* prefix = "Loaded `\0";
-    char* suffix = "` into the database.\0";
-    char* message = createCustomMessage(connectionfd, prefix, fileName, suffix);
-    if (message == NULL)
+    // selects on cracked columns are answered from their cracker copy rather than a scan, and
+    // partitioned columns are scanned a partition at a time
+    if ((findCrackerColumn(selectStatement->query.arguments[0]) != NULL) ||
+        readPartitionDirectory(selectStatement->query.arguments[0], NULL) || readPartitionDirectory(fetchStatement->query.arguments[0], NULL))
     {
-        raiseDatabaseException(connectionfd, "loadOperator\0", "createCustomMessage() returned a NULL pointer\0", NULL);
-        return;
+        return false;
     }
-    writeResponseToClient(connectionfd, message);
+
+    // open both columns, falling back to unfused evaluation (which reports errors) if either is
+    // invalid. the fused loop runs over int32 values, so columns of other types fall back as well
+    char* selectColumn = selectStatement->query.arguments[0];
+    char* fetchColumn = fetchStatement->query.arguments[0];
+    int selectColumnLength;
+    int fetchColumnLength;
+    int selectColumnType;
+    int fetchColumnType;
+    int errorResponseLength = batchResponseLength;
+    long long ioStart = profileStart();
+    FILE* selectFp = openColumnForReading(connectionfd, "executeFusedChain\0", selectColumn, &selectColumnLength, &selectColumnType);
+    FILE* fetchFp = (selectFp == NULL) ? NULL : openColumnForReading(connectionfd, "executeFusedChain\0", fetchColumn, &fetchColumnLength, &fetchColumnType);
+    profileEnd(PROFILE_IO, ioStart);
+    if ((selectFp == NULL) || (fetchFp == NULL) || (fetchColumnLength < selectColumnLength) ||
+        (selectColumnType != COLUMN_INT32) || (fetchColumnType != COLUMN_INT32))
+    {
+        batchResponseLength = errorResponseLength;
+        batchResponse[batchResponseLength] = '\0';
+        if (selectFp != NULL)
+            fclose(selectFp);
+        if (fetchFp != NULL)
+            fclose(fetchFp);
+        return false;
+    }
+
+    // capture the predicate
+    int low = INT_MIN;
+    int high = INT_MAX;
+    if (selectStatement->query.numberOfArguments >= 2)
+    {
+        low = atoi(selectStatement->query.arguments[1]);
+        high = (selectStatement->query.numberOfArguments == 3) ? atoi(selectStatement->query.arguments[2]) : low;
+    }
+
+    // outputs that are materialized
+    int* positions = materializePositions ? poolAllocate((selectColumnLength + 1) * sizeof(int)) : NULL;
+    int* values = materializeValues ? poolAllocate((selectColumnLength + 1) * sizeof(int)) : NULL;
+    int numberOfResults = 0;
+    aggregateState state;
+    initializeAggregateState(&state);
+
+    // evaluate the chain one chunk at a time, directly from the blocks both columns are read ahead
+    // in (the blocks of the two scans cover the same rows)
+    columnScan selectScan;
+    columnScan fetchScan;
+    off_t valuesEnd = (2 + (off_t)selectColumnLength) * sizeof(int);
+    openColumnScan(&selectScan, fileno(selectFp), 2 * sizeof(int), valuesEnd);
+    openColumnScan(&fetchScan, fileno(fetchFp), 2 * sizeof(int), valuesEnd);
+    int selectionVector[FUSED_CHUNK_SIZE];
+    int gatheredValues[FUSED_CHUNK_SIZE];
+    int base = 0;
+    while (base < selectColumnLength)
+    {
+        size_t selectBlockLength;
+        size_t fetchBlockLength;
+        ioStart = profileStart();
+        int* selectBlock = (int*)nextColumnScanBlock(&selectScan, &selectBlockLength);
+        int* fetchBlock = (int*)nextColumnScanBlock(&fetchScan, &fetchBlockLength);
+        profileEnd(PROFILE_IO, ioStart);
+        int blockLength = ((selectBlockLength < fetchBlockLength) ? selectBlockLength : fetchBlockLength) / sizeof(int);
+        if (blockLength == 0)
+        {
+            break;
+        }
+        for (int offset = 0; offset < blockLength; offset += FUSED_CHUNK_SIZE, base += FUSED_CHUNK_SIZE)
+        {
+            int chunkLength = (blockLength - offset < FUSED_CHUNK_SIZE) ? (blockLength - offset) : FUSED_CHUNK_SIZE;
+            int* selectChunk = selectBlock + offset;
+            int* fetchChunk = fetchBlock + offset;
+
+            // select (branch free) and gather
+            int selected = 0;
+            for (int i = 0; i < chunkLength; i++)
+            {
+                selectionVector[selected] = i;
+                selected += (selectChunk[i] >= low) & (selectChunk[i] <= high);
+            }
+            for (int i = 0; i < selected; i++)
+            {
+                gatheredValues[i] = fetchChunk[selectionVector[i]];
+            }
+
+            // aggregate and materialize
+            if (aggregateStatement != NULL)
+            {
+                updateAggregateState(&state, gatheredValues, COLUMN_INT32, selected);
+            }
+            if (materializePositions)
+            {
+                for (int i = 0; i < selected; i++)
+                    positions[numberOfResults + i] = base + selectionVector[i];
+            }
+            if (materializeValues)
+            {
+                memcpy(values + numberOfResults, gatheredValues, selected * sizeof(int));
+            }
+            numberOfResults += selected;
+        }
+    }
+    closeColumnScan(&selectScan);
+    closeColumnScan(&fetchScan);
+    fclose(selectFp);
+    fclose(fetchFp);
+    recordBytesRead((4 + (2 * (long long)selectColumnLength)) * sizeof(int));
+    recordRowsSelected(selectColumnLength, numberOfResults);
+
+    // store the materialized variables
+    selectStatement->executed = true;
+    fetchStatement->executed = true;
+    if (materializePositions)
+    {
+        intermediateResult* variable = createIntermediateResult(selectStatement->query.outputVariable, POSITION_LIST);
+        variable->validPositions = poolShrink(positions, numberOfResults * sizeof(int), (numberOfResults + 1) * sizeof(int));
+        variable->numberOfValidPositions = numberOfResults;
+        insertIntermediateResult(currentSession, variable);
+    }
+    if (materializeValues)
+    {
+        intermediateResult* variable = createIntermediateResult(fetchStatement->query.outputVariable, VALUE_LIST);
+        variable->values = poolShrink(values, numberOfResults * sizeof(int), (numberOfResults + 1) * sizeof(int));
+        variable->numberOfValues = numberOfResults;
+        insertIntermediateResult(currentSession, variable);
+    }
+    // the fetch and the aggregate respond when the batch reaches them
+    char* selectMessage = createCustomMessage(connectionfd, "Selected valid positions from the column `\0", selectColumn, "` (fused).\0");
+    char* fetchMessage = createCustomMessage(connectionfd, "Fetched values from the column `\0", fetchColumn, "` (fused).\0");
+    writeResponseToClient(connectionfd, selectMessage);
+    int responseStart = batchResponseLength;
+    writeResponseToClient(connectionfd, fetchMessage);
+    deferBatchResponse(fetchStatement, responseStart);
+    if (aggregateStatement != NULL)
+    {
+        aggregateStatement->executed = true;
+        intermediateResult* variable = createIntermediateResult(aggregateStatement->query.outputVariable, SCALAR_VALUE);
+        if (storeAggregateResult(connectionfd, "executeFusedChain\0", variable, aggregateStatement->query.commandName, &state))
+        {
+            insertIntermediateResult(currentSession, variable);
+            char* aggregateMessage = createCustomMessage(connectionfd, "Computed the aggregate of `\0", fetchStatement->query.outputVariable, "` (fused).\0");
+            writeResponseToClient(connectionfd, aggregateMessage);
+        }
+        else
+        {
+            releaseIntermediateResult(variable);
+        }
+        deferBatchResponse(aggregateStatement, responseStart);
+    }
+    return true;
+}
+
+/*
+ *  answerChainFromMaterialized()
+ *  Answers a fused chain computing an aggregate of the values of a column selected from
+ *  that same column from a materialized aggregate of its values in the range (or of all
+ *  of them, for a select without one). Returns false without evaluating anything if there
+ *  is no such aggregate.
+ */
+bool answerChainFromMaterialized(int connectionfd, batchStatement* selectStatement, batchStatement* fetchStatement, batchStatement* aggregateStatement)
+{
+    char* column = selectStatement->query.arguments[0];
+    int kind = (selectStatement->query.numberOfArguments >= 2) ? MATERIALIZED_RANGE : MATERIALIZED_TOTAL;
+    long long low = (kind == MATERIALIZED_RANGE) ? atoll(selectStatement->query.arguments[1]) : 0;
+    long long high = (selectStatement->query.numberOfArguments == 3) ? atoll(selectStatement->query.arguments[2]) : low;
+    materializedAggregate materialized;
+    if (!lookupMaterializedAggregate(kind, column, NULL, low, high, &materialized))
+    {
+        return false;
+    }
+    aggregateState state;
+    state.sum = materialized.definition.sum;
+    state.min = materialized.definition.min;
+    state.max = materialized.definition.max;
+    state.count = (int)materialized.definition.count;
+    freeMaterializedAggregate(&materialized);
+    profileRows(0, 1);
+
+    // neither the positions nor the values are needed, only the aggregate is stored
+    selectStatement->executed = true;
+    fetchStatement->executed = true;
+    aggregateStatement->executed = true;
+    writeResponseToClient(connectionfd, createCustomMessage(connectionfd, "Selected valid positions from the column `\0", column, "` (materialized).\0"));
+    int responseStart = batchResponseLength;
+    writeResponseToClient(connectionfd, createCustomMessage(connectionfd, "Fetched values from the column `\0", column, "` (materialized).\0"));
+    deferBatchResponse(fetchStatement, responseStart);
+    intermediateResult* variable = createIntermediateResult(aggregateStatement->query.outputVariable, SCALAR_VALUE);
+    if (storeAggregateResult(connectionfd, "executeFusedChain\0", variable, aggregateStatement->query.commandName, &state))
+    {
+        insertIntermediateResult(currentSession, variable);
+        char* aggregateMessage = createCustomMessage(connectionfd, "Computed the aggregate of `\0", fetchStatement->query.outputVariable, "` (materialized).\0");
+        writeResponseToClient(connectionfd, aggregateMessage);
+    }
+    else
+    {
+        releaseIntermediateResult(variable);
+    }
+    deferBatchResponse(aggregateStatement, responseStart);
+    return true;
 }
 
 
@@ -904,3 +4840,4 @@ void loadOperator(int connectionfd, char* query)
 
 
 
+
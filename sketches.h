@@ -0,0 +1,320 @@
+// approximate answers are given with the half width of an interval that holds the exact answer about
+// 95% of the time: this many standard errors
+#define APPROXIMATE_CONFIDENCE 1.96
+
+// count, sum, and avg are estimated from a sample of blocks of a column (read on their own, a block
+// being contiguous on disk). columns of at most SAMPLE_BLOCKS blocks are read whole, so exactly
+#define SAMPLE_BLOCK_VALUES 4096
+#define SAMPLE_BLOCKS 256
+
+// the number of distinct values of a column is estimated by a HyperLogLog sketch with 2^14 registers
+// (a standard error of about 0.8%)
+#define DISTINCT_SKETCH_BITS 14
+#define DISTINCT_SKETCH_REGISTERS (1 << DISTINCT_SKETCH_BITS)
+
+// quantiles are estimated from a sketch of compactors: levels of at most QUANTILE_SKETCH_CAPACITY
+// values, those at level l standing for 2^l values each. a full level is sorted and every other value
+// (starting at random with the first or the second) moves up a level
+#define QUANTILE_SKETCH_CAPACITY 512
+#define QUANTILE_SKETCH_LEVELS 40
+
+// the sketches of a column, rebuilt whenever the column is loaded (and added to when values are
+// appended to it)
+typedef struct columnSketches
+{
+	char* columnName;
+	long long count;
+	unsigned char registers[DISTINCT_SKETCH_REGISTERS];
+	long long* levels[QUANTILE_SKETCH_LEVELS];
+	int levelSizes[QUANTILE_SKETCH_LEVELS];
+	long long compactions[QUANTILE_SKETCH_LEVELS];
+	unsigned int seed;
+	struct columnSketches* next;
+}columnSketches;
+columnSketches* columnSketchesRoot = NULL;
+pthread_mutex_t columnSketchesLock = PTHREAD_MUTEX_INITIALIZER;
+
+// picks numberOfSamples of numberOfBlocks blocks, each as likely as any other, in increasing order
+// (selection sampling, so the blocks are read front to back)
+void chooseSampleBlocks(int numberOfBlocks, int numberOfSamples, unsigned int* seed, int* blocks)
+{
+	int chosen = 0;
+	for (int block = 0; (block < numberOfBlocks) && (chosen < numberOfSamples); block++)
+	{
+		double draw = rand_r(seed) / ((double)RAND_MAX + 1.0);
+		if ((numberOfBlocks - block) * draw < numberOfSamples - chosen)
+		{
+			blocks[chosen++] = block;
+		}
+	}
+}
+
+// estimates the ratio of two quantities (the sum and count of the values an average is over) from
+// their totals in the sampled blocks, and its bound by linearizing the ratio
+void estimateRatioFromBlocks(double* sums, double* counts, int numberOfSamples, int numberOfBlocks, double* estimate, double* bound)
+{
+	double sum = 0.0;
+	double count = 0.0;
+	for (int i = 0; i < numberOfSamples; i++)
+	{
+		sum += sums[i];
+		count += counts[i];
+	}
+	*estimate = sum / count;
+	double variance = 0.0;
+	for (int i = 0; i < numberOfSamples; i++)
+	{
+		double residual = sums[i] - (*estimate * counts[i]);
+		variance += residual * residual;
+	}
+	variance = (numberOfSamples > 1) ? variance / (numberOfSamples - 1) : 0.0;
+	double meanCount = count / numberOfSamples;
+	double unsampled = 1.0 - ((double)numberOfSamples / numberOfBlocks);
+	*bound = APPROXIMATE_CONFIDENCE * sqrt(unsampled * variance / numberOfSamples) / meanCount;
+}
+
+// estimates the total of a quantity over the numberOfValues values of a column from its totals in the
+// sampled blocks and the sizes of those blocks: the total per value sampled, scaled to the column.
+// blocks at the ends of files are short, so scaling by the number of blocks instead would be skewed
+void estimateTotalFromBlocks(double* totals, double* sizes, int numberOfSamples, int numberOfBlocks, long long numberOfValues, double* estimate, double* bound)
+{
+	*estimate = 0.0;
+	*bound = 0.0;
+	if (numberOfValues > 0)
+	{
+		estimateRatioFromBlocks(totals, sizes, numberOfSamples, numberOfBlocks, estimate, bound);
+		*estimate *= numberOfValues;
+		*bound *= numberOfValues;
+	}
+}
+
+// adds a value to the register it hashes to, which keeps the most leading zeros seen after the bits
+// that pick the register
+void insertDistinctValue(columnSketches* sketches, long long value)
+{
+	unsigned long long hash = groupHash(value);
+	int reg = hash >> (64 - DISTINCT_SKETCH_BITS);
+	unsigned long long rest = (hash << DISTINCT_SKETCH_BITS) | (1ULL << (DISTINCT_SKETCH_BITS - 1));
+	unsigned char rank = __builtin_clzll(rest) + 1;
+	sketches->registers[reg] = (rank > sketches->registers[reg]) ? rank : sketches->registers[reg];
+}
+
+// estimates the number of distinct values (counting empty registers instead while few are full)
+void estimateDistinctFromSketch(columnSketches* sketches, double* estimate, double* bound)
+{
+	double registers = DISTINCT_SKETCH_REGISTERS;
+	double harmonic = 0.0;
+	int empty = 0;
+	for (int i = 0; i < DISTINCT_SKETCH_REGISTERS; i++)
+	{
+		harmonic += ldexp(1.0, -sketches->registers[i]);
+		empty += (sketches->registers[i] == 0);
+	}
+	*estimate = (0.7213 / (1.0 + (1.079 / registers))) * registers * registers / harmonic;
+	if ((*estimate <= 2.5 * registers) && (empty > 0))
+		*estimate = registers * log(registers / empty);
+	*estimate = (*estimate > sketches->count) ? sketches->count : *estimate;
+	*bound = APPROXIMATE_CONFIDENCE * (1.04 / sqrt(registers)) * *estimate;
+}
+
+int compareSketchValues(const void* first, const void* second)
+{
+	long long a = *(const long long*)first;
+	long long b = *(const long long*)second;
+	return (a > b) - (a < b);
+}
+
+void insertQuantileValue(columnSketches* sketches, int level, long long value);
+
+// sorts a full level and moves every other value up a level
+void compactQuantileLevel(columnSketches* sketches, int level)
+{
+	long long* values = sketches->levels[level];
+	qsort(values, sketches->levelSizes[level], sizeof(long long), compareSketchValues);
+	for (int i = rand_r(&sketches->seed) & 1; i < sketches->levelSizes[level]; i += 2)
+	{
+		insertQuantileValue(sketches, level + 1, values[i]);
+	}
+	sketches->levelSizes[level] = 0;
+	sketches->compactions[level]++;
+}
+
+// adds a value to a level (level 0 for a value of the column), compacting the level first if it is full
+void insertQuantileValue(columnSketches* sketches, int level, long long value)
+{
+	if (sketches->levels[level] == NULL)
+		sketches->levels[level] = malloc(QUANTILE_SKETCH_CAPACITY * sizeof(long long));
+	if ((sketches->levelSizes[level] == QUANTILE_SKETCH_CAPACITY) && (level + 1 < QUANTILE_SKETCH_LEVELS))
+		compactQuantileLevel(sketches, level);
+	if (sketches->levelSizes[level] < QUANTILE_SKETCH_CAPACITY)
+		sketches->levels[level][sketches->levelSizes[level]++] = value;
+}
+
+// a value kept by a quantile sketch and how many values it stands for
+typedef struct weightedValue
+{
+	long long value;
+	long long weight;
+}weightedValue;
+
+int compareWeightedValues(const void* first, const void* second)
+{
+	return compareSketchValues(&((const weightedValue*)first)->value, &((const weightedValue*)second)->value);
+}
+
+// returns the value of the given rank among the sorted kept values
+long long weightedValueAtRank(weightedValue* kept, int numberOfKept, double rank)
+{
+	double seen = 0.0;
+	for (int i = 0; i < numberOfKept; i++)
+	{
+		seen += kept[i].weight;
+		if (seen > rank)
+			return kept[i].value;
+	}
+	return kept[numberOfKept - 1].value;
+}
+
+// estimates the value at a fraction of the way through the sorted values (false if there are none).
+// every compaction at level l moves the rank of a value by at most 2^l (either way, as likely as not),
+// and the bound is how far the estimate is from the values at the ranks that far either side of it
+bool estimateQuantileFromSketch(columnSketches* sketches, double fraction, long long* estimate, long long* bound)
+{
+	int numberOfKept = 0;
+	double rankVariance = 0.0;
+	for (int level = 0; level < QUANTILE_SKETCH_LEVELS; level++)
+	{
+		numberOfKept += sketches->levelSizes[level];
+		rankVariance += sketches->compactions[level] * ldexp(1.0, 2 * level);
+	}
+	if (numberOfKept == 0)
+		return false;
+	weightedValue* kept = malloc(numberOfKept * sizeof(weightedValue));
+	long long total = 0;
+	for (int level = 0, k = 0; level < QUANTILE_SKETCH_LEVELS; level++)
+	{
+		for (int i = 0; i < sketches->levelSizes[level]; i++, k++)
+		{
+			kept[k].value = sketches->levels[level][i];
+			kept[k].weight = 1LL << level;
+			total += kept[k].weight;
+		}
+	}
+	qsort(kept, numberOfKept, sizeof(weightedValue), compareWeightedValues);
+	double rank = fraction * (total - 1);
+	double rankBound = APPROXIMATE_CONFIDENCE * sqrt(rankVariance);
+	*estimate = weightedValueAtRank(kept, numberOfKept, rank);
+	long long below = weightedValueAtRank(kept, numberOfKept, (rank - rankBound < 0) ? 0 : rank - rankBound);
+	long long above = weightedValueAtRank(kept, numberOfKept, (rank + rankBound > total - 1) ? total - 1 : rank + rankBound);
+	*bound = ((above - *estimate) > (*estimate - below)) ? above - *estimate : *estimate - below;
+	free(kept);
+	return true;
+}
+
+void freeColumnSketches(columnSketches* sketches)
+{
+	for (int level = 0; level < QUANTILE_SKETCH_LEVELS; level++)
+	{
+		free(sketches->levels[level]);
+	}
+	free(sketches->columnName);
+	free(sketches);
+}
+
+// removes the sketches of a column, so they are built again from its values when next needed
+void discardColumnSketches(char* columnName)
+{
+	pthread_mutex_lock(&columnSketchesLock);
+	columnSketches** trav = &columnSketchesRoot;
+	while ((*trav != NULL) && (strcmp(columnName, (*trav)->columnName) != 0))
+	{
+		trav = &(*trav)->next;
+	}
+	columnSketches* discarded = *trav;
+	if (discarded != NULL)
+	{
+		*trav = discarded->next;
+		freeColumnSketches(discarded);
+	}
+	pthread_mutex_unlock(&columnSketchesLock);
+}
+
+// (re)builds the sketches of a column from all of its values, one value at a time
+void updateColumnSketches(char* columnName, long long* values, int numberOfValues)
+{
+	columnSketches* built = calloc(1, sizeof(columnSketches));
+	built->columnName = malloc(strlen(columnName) + 1);
+	strcpy(built->columnName, columnName);
+	built->seed = (unsigned int)time(NULL) ^ (unsigned int)numberOfValues;
+	built->count = numberOfValues;
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		insertDistinctValue(built, values[i]);
+		insertQuantileValue(built, 0, values[i]);
+	}
+
+	// replace the old sketches (queries read them under the lock, so they can be freed)
+	discardColumnSketches(columnName);
+	pthread_mutex_lock(&columnSketchesLock);
+	built->next = columnSketchesRoot;
+	columnSketchesRoot = built;
+	pthread_mutex_unlock(&columnSketchesLock);
+}
+
+// adds values appended to a column to its sketches, if it has any (otherwise they are built from all
+// of its values when next needed)
+void appendColumnSketches(char* columnName, long long* values, int numberOfValues)
+{
+	pthread_mutex_lock(&columnSketchesLock);
+	columnSketches* trav = columnSketchesRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	for (int i = 0; (trav != NULL) && (i < numberOfValues); i++)
+	{
+		insertDistinctValue(trav, values[i]);
+		insertQuantileValue(trav, 0, values[i]);
+	}
+	if (trav != NULL)
+	{
+		trav->count += numberOfValues;
+	}
+	pthread_mutex_unlock(&columnSketchesLock);
+}
+
+// estimates the number of distinct values of a column from its sketches. returns false if the column
+// has none yet
+bool estimateDistinctValues(char* columnName, double* estimate, double* bound)
+{
+	pthread_mutex_lock(&columnSketchesLock);
+	columnSketches* trav = columnSketchesRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	if (trav != NULL)
+	{
+		estimateDistinctFromSketch(trav, estimate, bound);
+	}
+	pthread_mutex_unlock(&columnSketchesLock);
+	return (trav != NULL);
+}
+
+// estimates a quantile of a column from its sketches. returns false if the column has no sketches yet,
+// and sets empty if it has no values
+bool estimateQuantile(char* columnName, double fraction, long long* estimate, long long* bound, bool* empty)
+{
+	pthread_mutex_lock(&columnSketchesLock);
+	columnSketches* trav = columnSketchesRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	if (trav != NULL)
+	{
+		*empty = !estimateQuantileFromSketch(trav, fraction, estimate, bound);
+	}
+	pthread_mutex_unlock(&columnSketchesLock);
+	return (trav != NULL);
+}
@@ -0,0 +1,464 @@
+// a reader that is not in a query announces this epoch, which holds back no segment
+#define SNAPSHOT_IDLE ULLONG_MAX
+
+// an immutable version of a column's file. writers never change a segment, they write a new one
+// and rename it over db/<column>, so the segment is kept open to survive being replaced. readers
+// open it again through path (/proc/self/fd/<fd>), which works even once the file is unlinked
+typedef struct columnSegment
+{
+	unsigned long long version;     // 1 for the first segment of a column the server saw
+	unsigned long long publishedEpoch;  // snapshots taken at or after this epoch see the segment
+	int fd;
+	char path[32];
+	struct columnSegment* older;    // the segment this one replaced, until it is reclaimed
+}columnSegment;
+
+// the segments of a column, newest first. columns are only ever added to the list, so readers
+// traverse it without a lock
+typedef struct versionedColumn
+{
+	char* columnName;
+	columnSegment* current;         // NULL while the column has no published segment yet
+	struct versionedColumn* next;
+}versionedColumn;
+
+// the epoch a thread's snapshot was taken at (SNAPSHOT_IDLE outside of queries). segments that
+// replaced others at or before the oldest announced epoch leave the replaced ones unreachable
+typedef struct snapshotSlot
+{
+	unsigned long long epoch;
+	bool owned;                     // false once the owning thread exited, so another thread can take over
+	struct snapshotSlot* next;
+}snapshotSlot;
+
+// the epoch advances every time writers publish segments
+unsigned long long globalEpoch = 1;
+versionedColumn* versionedColumnRoot = NULL;
+pthread_mutex_t versionedColumnsLock = PTHREAD_MUTEX_INITIALIZER;
+snapshotSlot* snapshotSlotRoot = NULL;
+pthread_mutex_t snapshotSlotsLock = PTHREAD_MUTEX_INITIALIZER;
+__thread snapshotSlot* currentSnapshotSlot = NULL;
+__thread int snapshotDepth = 0;
+
+// writers (and reclamation) are serialized. segments replaced but not reclaimed yet are counted so
+// readers leaving a snapshot know whether reclamation is worth trying
+pthread_mutex_t columnWritersLock = PTHREAD_MUTEX_INITIALIZER;
+int retiredSegments = 0;
+
+// returns the snapshot slot of the calling thread, on first use taking over the slot of a thread
+// that exited or registering a new one
+snapshotSlot* getSnapshotSlot(void)
+{
+	if (currentSnapshotSlot == NULL)
+	{
+		pthread_mutex_lock(&snapshotSlotsLock);
+		for (snapshotSlot* trav = snapshotSlotRoot; (trav != NULL) && (currentSnapshotSlot == NULL); trav = trav->next)
+		{
+			currentSnapshotSlot = trav->owned ? NULL : trav;
+		}
+		if (currentSnapshotSlot == NULL)
+		{
+			currentSnapshotSlot = calloc(1, sizeof(snapshotSlot));
+			currentSnapshotSlot->epoch = SNAPSHOT_IDLE;
+			currentSnapshotSlot->next = snapshotSlotRoot;
+			__atomic_store_n(&snapshotSlotRoot, currentSnapshotSlot, __ATOMIC_RELEASE);
+		}
+		currentSnapshotSlot->owned = true;
+		pthread_mutex_unlock(&snapshotSlotsLock);
+	}
+	return currentSnapshotSlot;
+}
+
+// gives up the snapshot slot of the calling thread when it exits
+void releaseSnapshotSlot(void)
+{
+	if (currentSnapshotSlot != NULL)
+	{
+		pthread_mutex_lock(&snapshotSlotsLock);
+		currentSnapshotSlot->epoch = SNAPSHOT_IDLE;
+		currentSnapshotSlot->owned = false;
+		pthread_mutex_unlock(&snapshotSlotsLock);
+		currentSnapshotSlot = NULL;
+	}
+}
+
+// returns the oldest epoch a snapshot is still being read at
+unsigned long long oldestSnapshotEpoch(void)
+{
+	unsigned long long oldest = SNAPSHOT_IDLE;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (snapshotSlot* trav = __atomic_load_n(&snapshotSlotRoot, __ATOMIC_ACQUIRE); trav != NULL; trav = trav->next)
+	{
+		unsigned long long epoch = __atomic_load_n(&trav->epoch, __ATOMIC_SEQ_CST);
+		oldest = (epoch < oldest) ? epoch : oldest;
+	}
+	return oldest;
+}
+
+// closes and frees the segments no snapshot can reach anymore: those older than the newest segment
+// published at or before the oldest snapshot. the writers lock must be held
+void reclaimColumnSegments(void)
+{
+	unsigned long long oldest = oldestSnapshotEpoch();
+	for (versionedColumn* column = __atomic_load_n(&versionedColumnRoot, __ATOMIC_ACQUIRE); column != NULL; column = column->next)
+	{
+		columnSegment* segment = column->current;
+		while ((segment != NULL) && (segment->publishedEpoch > oldest))
+		{
+			segment = segment->older;
+		}
+		if ((segment == NULL) || (segment->older == NULL))
+		{
+			continue;
+		}
+		columnSegment* garbage = segment->older;
+		__atomic_store_n(&segment->older, NULL, __ATOMIC_RELEASE);
+		while (garbage != NULL)
+		{
+			columnSegment* older = garbage->older;
+			close(garbage->fd);
+			free(garbage);
+			__atomic_sub_fetch(&retiredSegments, 1, __ATOMIC_RELAXED);
+			garbage = older;
+		}
+	}
+}
+
+// pins a snapshot of every column for the calling thread: until the matching endSnapshot() its reads
+// see the segments published before the snapshot was taken (or by the thread itself since), and none
+// of them are reclaimed. snapshots nest, only the outermost one is taken
+void beginSnapshot(void)
+{
+	if (snapshotDepth++ > 0)
+	{
+		return;
+	}
+
+	// announce the epoch, making sure no reclamation that missed the announcement could free its segments
+	snapshotSlot* slot = getSnapshotSlot();
+	unsigned long long epoch = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+	while (1)
+	{
+		__atomic_store_n(&slot->epoch, epoch, __ATOMIC_SEQ_CST);
+		unsigned long long now = __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST);
+		if (now == epoch)
+		{
+			break;
+		}
+		epoch = now;
+	}
+}
+
+// unpins the calling thread's snapshot, reclaiming the segments it held back if no writer is busy
+void endSnapshot(void)
+{
+	if (--snapshotDepth > 0)
+	{
+		return;
+	}
+	__atomic_store_n(&currentSnapshotSlot->epoch, SNAPSHOT_IDLE, __ATOMIC_SEQ_CST);
+	if ((__atomic_load_n(&retiredSegments, __ATOMIC_RELAXED) > 0) && (pthread_mutex_trylock(&columnWritersLock) == 0))
+	{
+		reclaimColumnSegments();
+		pthread_mutex_unlock(&columnWritersLock);
+	}
+}
+
+// opens a new segment of a file in the database, filling in its path
+columnSegment* openColumnSegment(char* path, unsigned long long version, unsigned long long publishedEpoch)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	columnSegment* segment = calloc(1, sizeof(columnSegment));
+	segment->version = version;
+	segment->publishedEpoch = publishedEpoch;
+	segment->fd = fd;
+	snprintf(segment->path, sizeof(segment->path), "/proc/self/fd/%d", fd);
+	return segment;
+}
+
+// finds the versions of a column, NULL if the server has not seen it yet
+versionedColumn* findVersionedColumn(char* columnName)
+{
+	versionedColumn* trav = __atomic_load_n(&versionedColumnRoot, __ATOMIC_ACQUIRE);
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	return trav;
+}
+
+// finds the versions of a column, adopting the file of a column the server has not seen yet as its
+// first segment (visible to every snapshot). returns NULL if there is no such file, unless create is
+// true, in which case the column starts out without segments
+versionedColumn* registerVersionedColumn(char* columnName, bool create)
+{
+	versionedColumn* column = findVersionedColumn(columnName);
+	if (column != NULL)
+	{
+		return column;
+	}
+	pthread_mutex_lock(&versionedColumnsLock);
+	column = findVersionedColumn(columnName);
+	if (column == NULL)
+	{
+		char path[strlen(columnName) + 4];
+		sprintf(path, "db/%s", columnName);
+		columnSegment* segment = openColumnSegment(path, 1, 0);
+		if ((segment != NULL) || create)
+		{
+			column = malloc(sizeof(versionedColumn));
+			column->columnName = malloc(strlen(columnName) + 1);
+			strcpy(column->columnName, columnName);
+			column->current = segment;
+			column->next = versionedColumnRoot;
+			__atomic_store_n(&versionedColumnRoot, column, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&versionedColumnsLock);
+	return column;
+}
+
+// returns the segment of a column in the calling thread's snapshot, NULL if the column does not
+// exist in it. the thread must be in a snapshot
+columnSegment* snapshotSegment(char* columnName)
+{
+	assert(snapshotDepth > 0);
+	versionedColumn* column = registerVersionedColumn(columnName, false);
+	if (column == NULL)
+	{
+		return NULL;
+	}
+	unsigned long long epoch = currentSnapshotSlot->epoch;
+	columnSegment* segment = __atomic_load_n(&column->current, __ATOMIC_ACQUIRE);
+	while ((segment != NULL) && (segment->publishedEpoch > epoch))
+	{
+		segment = __atomic_load_n(&segment->older, __ATOMIC_ACQUIRE);
+	}
+	return segment;
+}
+
+// returns the path to open a column's file at in the calling thread's snapshot, NULL if the column
+// does not exist in it. the path stays valid until the snapshot ends
+char* columnSnapshotPath(char* columnName)
+{
+	columnSegment* segment = snapshotSegment(columnName);
+	return (segment != NULL) ? segment->path : NULL;
+}
+
+// returns the version of a column in the calling thread's snapshot, 0 if it does not exist in it
+unsigned long long columnSnapshotVersion(char* columnName)
+{
+	columnSegment* segment = snapshotSegment(columnName);
+	return (segment != NULL) ? segment->version : 0;
+}
+
+// returns the newest version of a column, 0 if it has none
+unsigned long long newestColumnVersion(char* columnName)
+{
+	versionedColumn* column = findVersionedColumn(columnName);
+	columnSegment* segment = (column == NULL) ? NULL : __atomic_load_n(&column->current, __ATOMIC_ACQUIRE);
+	return (segment != NULL) ? segment->version : 0;
+}
+
+// returns whether the calling thread's snapshot has the newest version of a column. state shared
+// between queries (cached results, cracker copies) is only used by readers of the newest version
+bool isColumnSnapshotCurrent(char* columnName)
+{
+	columnSegment* segment = snapshotSegment(columnName);
+	versionedColumn* column = findVersionedColumn(columnName);
+	return (column == NULL) || (segment == __atomic_load_n(&column->current, __ATOMIC_ACQUIRE));
+}
+
+// returns the path of the newest segment of a column, NULL if it has none. a writer holding the
+// writers lock reads what it is about to replace through it, since its snapshot may be older
+char* newestColumnPath(char* columnName)
+{
+	versionedColumn* column = registerVersionedColumn(columnName, false);
+	columnSegment* segment = (column == NULL) ? NULL : __atomic_load_n(&column->current, __ATOMIC_ACQUIRE);
+	return (segment != NULL) ? segment->path : NULL;
+}
+
+// a segment that was written and waits to be published
+typedef struct stagedSegment
+{
+	char* columnName;
+	FILE* fp;
+}stagedSegment;
+
+// the segments the writer holding the writers lock staged so far
+stagedSegment* stagedSegments = NULL;
+int numberOfStagedSegments = 0;
+
+// starts writing new segments. writers are serialized, readers are never blocked
+void beginColumnWrites(void)
+{
+	pthread_mutex_lock(&columnWritersLock);
+}
+
+// creates the file of a new segment of a column, to be staged with stageColumnSegment() once
+// written. NULL if it cannot be created
+FILE* createColumnSegment(char* columnName)
+{
+	char path[strlen(columnName) + 8];
+	sprintf(path, "db/%s.new", columnName);
+	return fopen(path, "wb+");
+}
+
+// throws away a segment that was created but not published
+void discardColumnSegment(char* columnName, FILE* fp)
+{
+	char path[strlen(columnName) + 8];
+	sprintf(path, "db/%s.new", columnName);
+	fclose(fp);
+	unlink(path);
+}
+
+// queues a written segment of a column for publishColumnWrites(). returns false (discarding the
+// segment) if it could not be written out
+bool stageColumnSegment(char* columnName, FILE* fp)
+{
+	if (fflush(fp) != 0)
+	{
+		discardColumnSegment(columnName, fp);
+		return false;
+	}
+	stagedSegments = realloc(stagedSegments, (numberOfStagedSegments + 1) * sizeof(stagedSegment));
+	stagedSegments[numberOfStagedSegments].columnName = malloc(strlen(columnName) + 1);
+	strcpy(stagedSegments[numberOfStagedSegments].columnName, columnName);
+	stagedSegments[numberOfStagedSegments].fp = fp;
+	numberOfStagedSegments++;
+	return true;
+}
+
+// returns the file of the segment of a column staged so far by the writer holding the writers lock,
+// NULL if it has staged none
+FILE* findStagedColumnSegment(char* columnName)
+{
+	for (int i = numberOfStagedSegments - 1; i >= 0; i--)
+	{
+		if (strcmp(stagedSegments[i].columnName, columnName) == 0)
+			return stagedSegments[i].fp;
+	}
+	return NULL;
+}
+
+// renames a staged segment (already on stable storage) over the file of its column and makes it the
+// column's newest segment. snapshots do not see it until the epoch advances. returns false if the
+// segment cannot be installed, the caller discards it then
+bool installColumnSegment(stagedSegment* staged)
+{
+	char temporaryPath[strlen(staged->columnName) + 8];
+	char path[strlen(staged->columnName) + 4];
+	sprintf(temporaryPath, "db/%s.new", staged->columnName);
+	sprintf(path, "db/%s", staged->columnName);
+
+	// the column's current file must be adopted before it is replaced
+	versionedColumn* column = registerVersionedColumn(staged->columnName, true);
+	columnSegment* older = column->current;
+	columnSegment* segment = openColumnSegment(temporaryPath, (older != NULL) ? older->version + 1 : 1, __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST) + 1);
+	if ((segment == NULL) || (rename(temporaryPath, path) != 0))
+	{
+		if (segment != NULL)
+		{
+			close(segment->fd);
+			free(segment);
+		}
+		return false;
+	}
+	fclose(staged->fp);
+
+	// the segment becomes reachable now, but snapshots older than its epoch pass over it
+	segment->older = older;
+	__atomic_store_n(&column->current, segment, __ATOMIC_RELEASE);
+	if (older != NULL)
+		__atomic_add_fetch(&retiredSegments, 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+// publishes the staged segments. they are flushed to stable storage with one batched sync, renamed
+// over the files of their columns, and the directory is flushed, so after a crash each column is
+// either its old or its new version. snapshots then see every segment at once (so a load of several
+// columns is seen whole or not at all), the writer's own included. finally reclaims the segments no
+// snapshot needs anymore and lets the next writer in. returns false if some segment could not be
+// published (it is discarded)
+bool publishColumnWrites(void)
+{
+	int* fds = malloc((numberOfStagedSegments + 1) * sizeof(int));
+	for (int i = 0; i < numberOfStagedSegments; i++)
+	{
+		fds[i] = fileno(stagedSegments[i].fp);
+	}
+	bool published = syncFilesAsync(fds, numberOfStagedSegments);
+	free(fds);
+	int installed = 0;
+	for (int i = 0; i < numberOfStagedSegments; i++)
+	{
+		if (published && installColumnSegment(&stagedSegments[i]))
+		{
+			installed++;
+		}
+		else
+		{
+			discardColumnSegment(stagedSegments[i].columnName, stagedSegments[i].fp);
+			published = false;
+		}
+		free(stagedSegments[i].columnName);
+	}
+	numberOfStagedSegments = 0;
+	if (installed > 0)
+	{
+		int directoryfd = open("db", O_RDONLY | O_DIRECTORY);
+		published = (directoryfd >= 0) && (fsync(directoryfd) == 0) && published;
+		if (directoryfd >= 0)
+			close(directoryfd);
+	}
+
+	// the writer's own snapshot moves up to include what it published, so the statements after it in
+	// the same query (a batch) read its writes
+	unsigned long long epoch = __atomic_add_fetch(&globalEpoch, 1, __ATOMIC_SEQ_CST);
+	if (snapshotDepth > 0)
+		__atomic_store_n(&currentSnapshotSlot->epoch, epoch, __ATOMIC_SEQ_CST);
+	reclaimColumnSegments();
+	pthread_mutex_unlock(&columnWritersLock);
+	return published;
+}
+
+// discards the staged segments instead of publishing them, so a write that failed part way leaves
+// every column as it was, and lets the next writer in
+void abortColumnWrites(void)
+{
+	for (int i = 0; i < numberOfStagedSegments; i++)
+	{
+		discardColumnSegment(stagedSegments[i].columnName, stagedSegments[i].fp);
+		free(stagedSegments[i].columnName);
+	}
+	numberOfStagedSegments = 0;
+	pthread_mutex_unlock(&columnWritersLock);
+}
+
+// removes the segments a crash left unpublished (they never replaced their column's file)
+void removeUnpublishedColumnSegments(void)
+{
+	DIR* directory = opendir("db");
+	if (directory == NULL)
+	{
+		return;
+	}
+	struct dirent* entry;
+	while ((entry = readdir(directory)) != NULL)
+	{
+		size_t length = strlen(entry->d_name);
+		if ((length > 4) && (strcmp(entry->d_name + length - 4, ".new") == 0))
+		{
+			char path[length + 4];
+			sprintf(path, "db/%s", entry->d_name);
+			unlink(path);
+			printf("Removed the unpublished column file `%s`.\n", path);
+		}
+	}
+	closedir(directory);
+}
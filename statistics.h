@@ -0,0 +1,132 @@
+// number of buckets in the equi-width histogram kept for each column
+#define HISTOGRAM_BUCKETS 64
+
+// a struct for storing statistics about the values of a column
+typedef struct columnStatistics
+{
+	char* columnName;
+	int min;
+	int max;
+	int count;
+	int histogram[HISTOGRAM_BUCKETS];
+	bool stale;                     // the column changed, the statistics are gathered again when next needed
+	struct columnStatistics* next;
+}columnStatistics;
+columnStatistics* columnStatisticsRoot = NULL;
+pthread_mutex_t columnStatisticsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// copies the statistics of a column into statistics, since a load may update the shared ones while
+// they are in use. returns false if they have not been gathered yet (or are stale)
+bool findColumnStatistics(char* columnName, columnStatistics* statistics)
+{
+	pthread_mutex_lock(&columnStatisticsLock);
+	columnStatistics* trav = columnStatisticsRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	bool found = (trav != NULL) && !trav->stale;
+	if (found)
+	{
+		*statistics = *trav;
+		statistics->next = NULL;
+	}
+	pthread_mutex_unlock(&columnStatisticsLock);
+	return found;
+}
+
+// marks the statistics of a column stale, e.g. once values were appended to it (kept in place, since
+// they may be in use)
+void markColumnStatisticsStale(char* columnName)
+{
+	pthread_mutex_lock(&columnStatisticsLock);
+	columnStatistics* trav = columnStatisticsRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	if (trav != NULL)
+	{
+		trav->stale = true;
+	}
+	pthread_mutex_unlock(&columnStatisticsLock);
+}
+
+// returns the histogram bucket a value falls in (values outside [min, max] fall in the first or last)
+int histogramBucket(columnStatistics* statistics, int value)
+{
+	long long range = (long long)statistics->max - statistics->min + 1;
+	long long bucket = (((long long)value - statistics->min) * HISTOGRAM_BUCKETS) / range;
+	return (int)((bucket < 0) ? 0 : ((bucket >= HISTOGRAM_BUCKETS) ? HISTOGRAM_BUCKETS - 1 : bucket));
+}
+
+// (re)computes the statistics of a column from all of its values
+void updateColumnStatistics(char* columnName, int* values, int numberOfValues)
+{
+	// compute the new statistics
+	columnStatistics computed;
+	memset(&computed, 0, sizeof(columnStatistics));
+	computed.min = INT_MAX;
+	computed.max = INT_MIN;
+	computed.count = numberOfValues;
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		computed.min = (values[i] < computed.min) ? values[i] : computed.min;
+		computed.max = (values[i] > computed.max) ? values[i] : computed.max;
+	}
+	for (int i = 0; i < numberOfValues; i++)
+	{
+		computed.histogram[histogramBucket(&computed, values[i])]++;
+	}
+
+	// replace the old statistics (or insert them at the head of the list)
+	pthread_mutex_lock(&columnStatisticsLock);
+	columnStatistics* trav = columnStatisticsRoot;
+	while ((trav != NULL) && (strcmp(columnName, trav->columnName) != 0))
+	{
+		trav = trav->next;
+	}
+	if (trav == NULL)
+	{
+		trav = malloc(sizeof(columnStatistics));
+		trav->columnName = malloc(strlen(columnName) + 1);
+		strcpy(trav->columnName, columnName);
+		trav->next = columnStatisticsRoot;
+		columnStatisticsRoot = trav;
+	}
+	trav->min = computed.min;
+	trav->max = computed.max;
+	trav->count = computed.count;
+	trav->stale = false;
+	memcpy(trav->histogram, computed.histogram, sizeof(computed.histogram));
+	pthread_mutex_unlock(&columnStatisticsLock);
+}
+
+// estimates the fraction of a column's values that fall in [low, high], assuming values
+// are spread uniformly within each histogram bucket
+double estimateSelectivity(columnStatistics* statistics, int low, int high)
+{
+	if ((statistics->count == 0) || (low > high) || (high < statistics->min) || (low > statistics->max))
+	{
+		return 0.0;
+	}
+	low = (low < statistics->min) ? statistics->min : low;
+	high = (high > statistics->max) ? statistics->max : high;
+
+	// add up the overlap with every bucket
+	long long range = (long long)statistics->max - statistics->min + 1;
+	double matching = 0.0;
+	for (int bucket = histogramBucket(statistics, low), last = histogramBucket(statistics, high); bucket <= last; bucket++)
+	{
+		long long bucketLow = statistics->min + (range * bucket + HISTOGRAM_BUCKETS - 1) / HISTOGRAM_BUCKETS;
+		long long bucketHigh = statistics->min + (range * (bucket + 1) + HISTOGRAM_BUCKETS - 1) / HISTOGRAM_BUCKETS - 1;
+		if (bucketHigh < bucketLow)
+		{
+			continue;
+		}
+		long long overlapLow = (low > bucketLow) ? low : bucketLow;
+		long long overlapHigh = (high < bucketHigh) ? high : bucketHigh;
+		matching += statistics->histogram[bucket] * (double)(overlapHigh - overlapLow + 1) / (bucketHigh - bucketLow + 1);
+	}
+	return matching / statistics->count;
+}
@@ -0,0 +1,439 @@
+/*
+ *  Runs a standardized set of workloads against a running server and writes one JSON
+ *  object per workload (latency percentiles and throughput) to a results file. If the
+ *  results of an earlier build are given, workloads whose mean latency regressed by more
+ *  than REGRESSION_THRESHOLD are reported and the exit status is 1.
+ *  Usage: ./benchmark csvFileName rows cardinality iterations resultsFile [baselineFile]
+ *  The .csv file must be in csvTables/ (see generateBenchmarkData).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// a workload is a regression if its mean latency grows by more than this factor
+#define REGRESSION_THRESHOLD 1.10
+
+// most columns and workloads a benchmark handles
+#define MAX_COLUMNS 64
+#define MAX_WORKLOADS 32
+
+// a struct for storing the measurements of a workload
+typedef struct workloadResult
+{
+	char name[64];
+	int iterations;
+	double meanMicroseconds;
+	double p50Microseconds;
+	double p99Microseconds;
+	double maxMicroseconds;
+	double queriesPerSecond;
+}workloadResult;
+
+// variables
+int socketfd;
+int cardinality;
+int iterations;
+int numberOfColumns;
+char columnNames[MAX_COLUMNS][64];
+workloadResult results[MAX_WORKLOADS];
+int numberOfResults = 0;
+unsigned long long randomState = 42;
+int variableCounter = 0;
+
+// function prototypes
+void connectToServer(void);
+void receiveAll(void* buffer, int length);
+char* sendQuery(char* query);
+double secondsNow(void);
+int nextRandom(int bound);
+void recordWorkload(char* name, double* latencies, int numberOfLatencies);
+void runSelectWorkload(char* name, double selectivity);
+void runChainWorkload(char* name, double selectivity, bool fused);
+void runAggregateWorkload(char* aggregate);
+void runPreparedWorkload(double selectivity);
+int compareDoubles(const void* a, const void* b);
+bool compareWithBaseline(char* baselineFile);
+
+int main(int argc, char** argv)
+{
+	// error checking
+	if ((argc != 6) && (argc != 7))
+	{
+		printf("Usage: ./benchmark csvFileName rows cardinality iterations resultsFile [baselineFile]\n");
+		return 1;
+	}
+	char* csvFileName = argv[1];
+	long rows = atol(argv[2]);
+	cardinality = atoi(argv[3]);
+	iterations = atoi(argv[4]);
+	if ((rows <= 0) || (cardinality <= 0) || (iterations <= 0))
+	{
+		printf("rows, cardinality, and iterations must be positive\n");
+		return 1;
+	}
+
+	// read the column names from the header of the .csv file
+	char path[BUFSIZ];
+	char header[BUFSIZ];
+	snprintf(path, sizeof(path), "csvTables/%s", csvFileName);
+	FILE* fp = fopen(path, "r");
+	if ((fp == NULL) || (fgets(header, sizeof(header), fp) == NULL))
+	{
+		printf("Could not read the header of %s\n", path);
+		return 2;
+	}
+	fclose(fp);
+	char* last;
+	for (char* name = strtok_r(header, ",\n", &last); (name != NULL) && (numberOfColumns < MAX_COLUMNS); name = strtok_r(NULL, ",\n", &last))
+	{
+		strncpy(columnNames[numberOfColumns++], name, 63);
+	}
+	if (numberOfColumns < 2)
+	{
+		printf("The benchmark needs at least 2 columns\n");
+		return 2;
+	}
+
+	// create and load the columns (the load is timed)
+	connectToServer();
+	char query[BUFSIZ];
+	for (int i = 0; i < numberOfColumns; i++)
+	{
+		snprintf(query, sizeof(query), "create(%s,\"unsorted\")", columnNames[i]);
+		free(sendQuery(query));
+	}
+	snprintf(query, sizeof(query), "load(\"%s\")", csvFileName);
+	double start = secondsNow();
+	char* response = sendQuery(query);
+	double loadLatency = (secondsNow() - start) * 1e6;
+	if (strncmp(response, "Loaded", 6) != 0)
+	{
+		printf("The load failed: %s\n", response);
+		return 3;
+	}
+	free(response);
+	recordWorkload("load", &loadLatency, 1);
+	results[numberOfResults - 1].queriesPerSecond = rows / (loadLatency / 1e6);
+
+	// run the workloads
+	runSelectWorkload("point_select", 0.0);
+	runSelectWorkload("range_select_0.1%", 0.001);
+	runSelectWorkload("range_select_1%", 0.01);
+	runSelectWorkload("range_select_10%", 0.1);
+	runSelectWorkload("range_select_50%", 0.5);
+	runChainWorkload("select_fetch_sum_1%", 0.01, false);
+	runChainWorkload("fused_select_fetch_sum_1%", 0.01, true);
+	runChainWorkload("fused_select_fetch_sum_10%", 0.1, true);
+	runAggregateWorkload("min");
+	runAggregateWorkload("max");
+	runAggregateWorkload("sum");
+	runAggregateWorkload("avg");
+	runPreparedWorkload(0.01);
+	close(socketfd);
+
+	// write the results
+	FILE* resultsFp = fopen(argv[5], "w");
+	if (resultsFp == NULL)
+	{
+		printf("Could not open %s\n", argv[5]);
+		return 2;
+	}
+	printf("%-28s %10s %12s %12s %12s %12s %12s\n", "workload", "iterations", "mean_us", "p50_us", "p99_us", "max_us", "per_second");
+	for (int i = 0; i < numberOfResults; i++)
+	{
+		workloadResult* result = &results[i];
+		fprintf(resultsFp, "{\"workload\": \"%s\", \"iterations\": %d, \"mean_us\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, \"per_second\": %.1f}\n",
+		        result->name, result->iterations, result->meanMicroseconds, result->p50Microseconds, result->p99Microseconds,
+		        result->maxMicroseconds, result->queriesPerSecond);
+		printf("%-28s %10d %12.1f %12.1f %12.1f %12.1f %12.1f\n", result->name, result->iterations, result->meanMicroseconds,
+		       result->p50Microseconds, result->p99Microseconds, result->maxMicroseconds, result->queriesPerSecond);
+	}
+	fclose(resultsFp);
+	printf("Wrote the results to %s\n", argv[5]);
+
+	// compare them with an earlier build
+	return ((argc == 7) && !compareWithBaseline(argv[6])) ? 1 : 0;
+}
+
+/*
+ *  connectToServer()
+ *  Connects to the server on port 5000, retrying for a few seconds while it starts.
+ */
+void connectToServer(void)
+{
+	struct sockaddr_in serverAddress;
+	memset(&serverAddress, 0, sizeof(serverAddress));
+	serverAddress.sin_family = AF_INET;
+	serverAddress.sin_port = htons(5000);
+	inet_pton(AF_INET, "127.0.0.1", &serverAddress.sin_addr);
+	for (int attempt = 0; attempt < 100; attempt++)
+	{
+		socketfd = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(socketfd, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) == 0)
+		{
+			return;
+		}
+		close(socketfd);
+		usleep(100000);
+	}
+	printf("Could not connect to the server\n");
+	exit(2);
+}
+
+/*
+ *  receiveAll()
+ *  Receives exactly length bytes from the server.
+ */
+void receiveAll(void* buffer, int length)
+{
+	for (int received = 0, bytes; received < length; received += bytes)
+	{
+		bytes = recv(socketfd, (char*)buffer + received, length - received, 0);
+		if (bytes <= 0)
+		{
+			printf("The server closed the connection\n");
+			exit(3);
+		}
+	}
+}
+
+/*
+ *  sendQuery()
+ *  Sends a query to the server and returns its response (on the heap).
+ */
+char* sendQuery(char* query)
+{
+	int queryLength = strlen(query) + 1;
+	bool acknowledgement = true;
+	write(socketfd, &queryLength, sizeof(int));
+	receiveAll(&acknowledgement, sizeof(bool));
+	write(socketfd, query, queryLength);
+	int responseLength;
+	receiveAll(&responseLength, sizeof(int));
+	write(socketfd, &acknowledgement, sizeof(bool));
+	char* response = malloc(responseLength + 1);
+	receiveAll(response, responseLength);
+	response[responseLength] = '\0';
+	return response;
+}
+
+/*
+ *  secondsNow()
+ *  Returns the time from a monotonic clock in seconds.
+ */
+double secondsNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+/*
+ *  nextRandom()
+ *  Returns a pseudo random number in [0, bound) from a fixed seed, so every run issues
+ *  the same queries.
+ */
+int nextRandom(int bound)
+{
+	randomState = (randomState * 6364136223846793005ULL) + 1442695040888963407ULL;
+	return (int)((randomState >> 33) % (unsigned long long)bound);
+}
+
+/*
+ *  compareDoubles()
+ *  Comparison function for qsort.
+ */
+int compareDoubles(const void* a, const void* b)
+{
+	double difference = *(const double*)a - *(const double*)b;
+	return (difference > 0) - (difference < 0);
+}
+
+/*
+ *  recordWorkload()
+ *  Summarizes the latencies (in microseconds) of a workload.
+ */
+void recordWorkload(char* name, double* latencies, int numberOfLatencies)
+{
+	workloadResult* result = &results[numberOfResults++];
+	double total = 0.0;
+	qsort(latencies, numberOfLatencies, sizeof(double), compareDoubles);
+	for (int i = 0; i < numberOfLatencies; i++)
+	{
+		total += latencies[i];
+	}
+	strncpy(result->name, name, sizeof(result->name) - 1);
+	result->iterations = numberOfLatencies;
+	result->meanMicroseconds = total / numberOfLatencies;
+	result->p50Microseconds = latencies[numberOfLatencies / 2];
+	result->p99Microseconds = latencies[(int)(numberOfLatencies * 0.99)];
+	result->maxMicroseconds = latencies[numberOfLatencies - 1];
+	result->queriesPerSecond = numberOfLatencies / (total / 1e6);
+}
+
+/*
+ *  runSelectWorkload()
+ *  Times selects over the first column covering a fraction of its domain (a single
+ *  value if selectivity is 0). Bounds vary between iterations so the result cache
+ *  does not answer them.
+ */
+void runSelectWorkload(char* name, double selectivity)
+{
+	double* latencies = malloc(iterations * sizeof(double));
+	int width = (int)(selectivity * cardinality);
+	char query[BUFSIZ];
+	for (int i = 0; i < iterations; i++)
+	{
+		int low = nextRandom(cardinality - width + 1);
+		int variable = variableCounter++;
+		if (width <= 1)
+			snprintf(query, sizeof(query), "bq%d=select(%s,%d)", variable, columnNames[0], low);
+		else
+			snprintf(query, sizeof(query), "bq%d=select(%s,%d,%d)", variable, columnNames[0], low, low + width - 1);
+		double start = secondsNow();
+		free(sendQuery(query));
+		latencies[i] = (secondsNow() - start) * 1e6;
+		snprintf(query, sizeof(query), "drop(bq%d)", variable);
+		free(sendQuery(query));
+	}
+	recordWorkload(name, latencies, iterations);
+	free(latencies);
+}
+
+/*
+ *  runChainWorkload()
+ *  Times a select over the first column, a fetch of the second column, and a sum,
+ *  either as three queries or as one batch the server can fuse.
+ */
+void runChainWorkload(char* name, double selectivity, bool fused)
+{
+	double* latencies = malloc(iterations * sizeof(double));
+	int width = (int)(selectivity * cardinality);
+	width = (width < 1) ? 1 : width;
+	char query[3][BUFSIZ];
+	char batch[4 * BUFSIZ];
+	for (int i = 0; i < iterations; i++)
+	{
+		int low = nextRandom(cardinality - width + 1);
+		int variable = variableCounter++;
+		snprintf(query[0], BUFSIZ, "bqs%d=select(%s,%d,%d)", variable, columnNames[0], low, low + width - 1);
+		snprintf(query[1], BUFSIZ, "bqv%d=fetch(%s,bqs%d)", variable, columnNames[1], variable);
+		snprintf(query[2], BUFSIZ, "bqm%d=sum(bqv%d)", variable, variable);
+		double start = secondsNow();
+		if (fused)
+		{
+			snprintf(batch, sizeof(batch), "%s; %s; %s", query[0], query[1], query[2]);
+			free(sendQuery(batch));
+		}
+		else
+		{
+			for (int q = 0; q < 3; q++)
+				free(sendQuery(query[q]));
+		}
+		latencies[i] = (secondsNow() - start) * 1e6;
+		snprintf(batch, sizeof(batch), "drop(bqs%d); drop(bqv%d); drop(bqm%d)", variable, variable, variable);
+		free(sendQuery(batch));
+	}
+	recordWorkload(name, latencies, iterations);
+	free(latencies);
+}
+
+/*
+ *  runAggregateWorkload()
+ *  Times an aggregate over the second column's values at 10% of the rows.
+ */
+void runAggregateWorkload(char* aggregate)
+{
+	char query[BUFSIZ];
+	snprintf(query, sizeof(query), "bqaggs=select(%s,0,%d); bqaggv=fetch(%s,bqaggs)", columnNames[0], cardinality / 10, columnNames[1]);
+	free(sendQuery(query));
+	double* latencies = malloc(iterations * sizeof(double));
+	for (int i = 0; i < iterations; i++)
+	{
+		int variable = variableCounter++;
+		snprintf(query, sizeof(query), "bq%d=%s(bqaggv)", variable, aggregate);
+		double start = secondsNow();
+		free(sendQuery(query));
+		latencies[i] = (secondsNow() - start) * 1e6;
+		snprintf(query, sizeof(query), "drop(bq%d)", variable);
+		free(sendQuery(query));
+	}
+	free(sendQuery("drop(bqaggs); drop(bqaggv)"));
+	snprintf(query, sizeof(query), "aggregate_%s_10%%", aggregate);
+	recordWorkload(query, latencies, iterations);
+	free(latencies);
+}
+
+/*
+ *  runPreparedWorkload()
+ *  Times range selects executed through a prepared statement.
+ */
+void runPreparedWorkload(double selectivity)
+{
+	char query[BUFSIZ];
+	snprintf(query, sizeof(query), "prepare(bqrange,?=select(%s,?,?))", columnNames[0]);
+	free(sendQuery(query));
+	double* latencies = malloc(iterations * sizeof(double));
+	int width = (int)(selectivity * cardinality);
+	width = (width < 1) ? 1 : width;
+	for (int i = 0; i < iterations; i++)
+	{
+		int low = nextRandom(cardinality - width + 1);
+		int variable = variableCounter++;
+		snprintf(query, sizeof(query), "execute(bqrange,bq%d,%d,%d)", variable, low, low + width - 1);
+		double start = secondsNow();
+		free(sendQuery(query));
+		latencies[i] = (secondsNow() - start) * 1e6;
+		snprintf(query, sizeof(query), "drop(bq%d)", variable);
+		free(sendQuery(query));
+	}
+	recordWorkload("prepared_range_select_1%", latencies, iterations);
+	free(latencies);
+}
+
+/*
+ *  compareWithBaseline()
+ *  Compares the mean latency of every workload with the results of an earlier build.
+ *  Returns false if any workload regressed.
+ */
+bool compareWithBaseline(char* baselineFile)
+{
+	FILE* fp = fopen(baselineFile, "r");
+	if (fp == NULL)
+	{
+		printf("Could not open the baseline %s\n", baselineFile);
+		return false;
+	}
+	bool regressed = false;
+	char line[BUFSIZ];
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char name[64];
+		char* mean = strstr(line, "\"mean_us\": ");
+		if ((sscanf(line, "{\"workload\": \"%63[^\"]\"", name) != 1) || (mean == NULL))
+		{
+			continue;
+		}
+		double baselineMean = atof(mean + strlen("\"mean_us\": "));
+		for (int i = 0; i < numberOfResults; i++)
+		{
+			if (strcmp(results[i].name, name) != 0)
+			{
+				continue;
+			}
+			double ratio = results[i].meanMicroseconds / baselineMean;
+			printf("%-28s %12.1f -> %12.1f us (%+.1f%%)%s\n", name, baselineMean, results[i].meanMicroseconds, (ratio - 1.0) * 100.0,
+			       (ratio > REGRESSION_THRESHOLD) ? "  REGRESSION" : "");
+			regressed = regressed || (ratio > REGRESSION_THRESHOLD);
+		}
+	}
+	fclose(fp);
+	return !regressed;
+}
@@ -0,0 +1,135 @@
+/*
+ *  Generates a .csv file of integer columns for benchmarking. The data only depends on
+ *  the arguments (the seed included), so every run and every machine gets the same file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// distributions of the generated values
+#define UNIFORM 1
+#define ZIPF 2
+#define SORTED 3
+#define CLUSTERED 4
+
+// rows in a run of clustered values, and how far the values of a run spread
+#define CLUSTER_LENGTH 1024
+#define CLUSTER_SPREAD 100
+
+// state of the random number generator (splitmix64, so the data does not depend on the libc)
+unsigned long long randomState;
+
+unsigned long long nextRandom(void)
+{
+	unsigned long long z = (randomState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// returns a value in [0, 1)
+double nextUniform(void)
+{
+	return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int main(int argc, char** argv)
+{
+	// error checking
+	if (argc != 7)
+	{
+		printf("Usage: ./generateBenchmarkData outputFile rows columns uniform|zipf|sorted|clustered cardinality seed\n");
+		return 1;
+	}
+	char* outputFile = argv[1];
+	long rows = atol(argv[2]);
+	int columns = atoi(argv[3]);
+	int cardinality = atoi(argv[5]);
+	int distribution = (strcmp(argv[4], "uniform") == 0) ? UNIFORM :
+	                   ((strcmp(argv[4], "zipf") == 0) ? ZIPF :
+	                   ((strcmp(argv[4], "sorted") == 0) ? SORTED :
+	                   ((strcmp(argv[4], "clustered") == 0) ? CLUSTERED : -1)));
+	randomState = strtoull(argv[6], NULL, 10);
+	if ((rows <= 0) || (columns <= 0) || (cardinality <= 0) || (distribution == -1))
+	{
+		printf("rows, columns, and cardinality must be positive and the distribution one of uniform, zipf, sorted, or clustered\n");
+		return 1;
+	}
+	FILE* fp = fopen(outputFile, "w");
+	if (fp == NULL)
+	{
+		printf("Could not open %s\n", outputFile);
+		return 2;
+	}
+
+	// the zipf distribution (exponent 1) is sampled by binary searching its cumulative distribution
+	double* cumulative = NULL;
+	if (distribution == ZIPF)
+	{
+		cumulative = malloc(cardinality * sizeof(double));
+		double total = 0.0;
+		for (int rank = 0; rank < cardinality; rank++)
+		{
+			total += 1.0 / (rank + 1);
+			cumulative[rank] = total;
+		}
+		for (int rank = 0; rank < cardinality; rank++)
+		{
+			cumulative[rank] /= total;
+		}
+	}
+
+	// write the header (columns are named bm0, bm1, ...)
+	for (int column = 0; column < columns; column++)
+	{
+		fprintf(fp, (column + 1 < columns) ? "bm%d," : "bm%d\n", column);
+	}
+
+	// write the rows
+	int* clusterBases = calloc(columns, sizeof(int));
+	for (long row = 0; row < rows; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			int value;
+			if (distribution == UNIFORM)
+			{
+				value = nextRandom() % cardinality;
+			}
+			else if (distribution == ZIPF)
+			{
+				double target = nextUniform();
+				int low = 0;
+				int high = cardinality - 1;
+				while (low < high)
+				{
+					int middle = (low + high) / 2;
+					if (cumulative[middle] < target)
+						low = middle + 1;
+					else
+						high = middle;
+				}
+				value = low;
+			}
+			else if (distribution == SORTED)
+			{
+				value = (int)((row * (long long)cardinality) / rows);
+			}
+			else
+			{
+				if (row % CLUSTER_LENGTH == 0)
+				{
+					clusterBases[column] = nextRandom() % cardinality;
+				}
+				value = (clusterBases[column] + (nextRandom() % CLUSTER_SPREAD)) % cardinality;
+			}
+			fprintf(fp, (column + 1 < columns) ? "%d," : "%d\n", value);
+		}
+	}
+	fclose(fp);
+	free(clusterBases);
+	free(cumulative);
+	printf("Wrote %ld rows of %d %s columns (cardinality %d) to %s\n", rows, columns, argv[4], cardinality, outputFile);
+	return 0;
+}
@@ -10,6 +10,15 @@
 #define SORTED 2
 #define BTREE 3
 
+// the type of a column's values is stored above these bits of the storage type
+#define COLUMN_TYPE_SHIFT 8
+
+// set in the storage type of a partitioned column's file, which holds its partition directory
+#define PARTITIONED_COLUMN (1 << 16)
+
+// the storage type of the file of a materialized aggregate (db/<name>.mat)
+#define MATERIALIZED_AGGREGATE (1 << 17)
+
 int main(int argc, char** argv)
 {
 	// make sure a file was passed in
@@ -28,6 +37,15 @@ int main(int argc, char** argv)
 	}
 	int storageType;
 	fread(&storageType, sizeof(int), 1, fp);
+	if (storageType == MATERIALIZED_AGGREGATE)
+	{
+		printf("The file holds a materialized aggregate, not the values of a column\n");
+		return 0;
+	}
+	int partitioned = storageType & PARTITIONED_COLUMN;
+	int valueType = (storageType >> COLUMN_TYPE_SHIFT) & 0xFF;
+	storageType &= (1 << COLUMN_TYPE_SHIFT) - 1;
+	assert((valueType >= 0) && (valueType <= 3));
 	assert((storageType == UNSORTED) || (storageType == SORTED) || (storageType == BTREE));
 	if (storageType == UNSORTED)
 		printf("Storage type is UNSORTED (1)\n");
@@ -37,6 +55,14 @@ int main(int argc, char** argv)
 		printf("Storage type is BTREE (3)\n");
 	else
 		abort();
+	char* typeNames[] = {"int32", "int8", "int16", "int64"};
+	int typeWidths[] = {4, 1, 2, 8};
+	printf("Value type is %s (%d)\n", typeNames[valueType], valueType);
+	if (partitioned)
+	{
+		printf("The column is partitioned, its values are in %s.part0, %s.part1, ...\n", argv[1], argv[1]);
+		return 0;
+	}
 
 	// read the file size
 	int fileSize;
@@ -44,13 +70,16 @@ int main(int argc, char** argv)
 	printf("File size is: %d bytes\n", fileSize);
 
 	// read the data
-	int* fileData = malloc(fileSize);
+	char* fileData = malloc(fileSize);
 	fread(fileData, fileSize, 1, fp);
 
 	// print the data
-	for (int i = 0; i < (fileSize / 4); i++)
+	for (int i = 0; i < (fileSize / typeWidths[valueType]); i++)
 	{
-		printf("%d-", fileData[i]);
+		long long value = (valueType == 1) ? ((signed char*)fileData)[i] :
+		                  ((valueType == 2) ? ((short*)fileData)[i] :
+		                  ((valueType == 3) ? ((long long*)fileData)[i] : ((int*)fileData)[i]));
+		printf("%lld-", value);
 		fflush(stdout);
 	}
 	printf("EOF\n");
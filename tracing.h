@@ -0,0 +1,174 @@
+// events each thread's ring buffer holds. once it is full the oldest events are overwritten, so a
+// trace always covers the most recent activity of every thread
+#define TRACE_BUFFER_EVENTS 65536
+
+// the file traces are written to unless the server was given another one
+#define TRACE_DEFAULT_FILE "trace.json"
+
+// a span of time spent by a thread, e.g. in a query or an operator. a trace event records both
+// the beginning and the end of the span (a Chrome trace "complete" event), so a ring buffer that
+// wrapped around never holds an end without its beginning
+typedef struct traceEvent
+{
+	char* name;                     // names and categories are static strings
+	char* category;
+	char* argumentName;             // NULL if the event has no argument
+	long long argument;
+	long long start;
+	long long duration;
+	int threadId;
+}traceEvent;
+
+// a thread's ring buffer. only the owning thread writes events, publishing each one by advancing
+// head, so recording an event takes no lock
+typedef struct traceBuffer
+{
+	traceEvent events[TRACE_BUFFER_EVENTS];
+	unsigned long long head;        // events recorded so far
+	int threadId;
+	char threadName[32];
+	bool owned;                     // false once the owning thread exited, so another thread can take over
+	struct traceBuffer* next;
+}traceBuffer;
+
+bool tracingEnabled = false;
+char* traceFile = TRACE_DEFAULT_FILE;
+traceBuffer* traceBufferRoot = NULL;
+pthread_mutex_t traceBuffersLock = PTHREAD_MUTEX_INITIALIZER;
+int nextTraceThreadId = 1;
+__thread traceBuffer* currentTraceBuffer = NULL;
+
+// returns the time since an arbitrary point in nanoseconds
+long long monotonicNanoseconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((long long)now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+// returns the ring buffer of the calling thread, on first use taking over the buffer of a thread
+// that exited or registering a new one. every thread gets an id of its own either way
+traceBuffer* getTraceBuffer(void)
+{
+	if (currentTraceBuffer == NULL)
+	{
+		pthread_mutex_lock(&traceBuffersLock);
+		for (traceBuffer* trav = traceBufferRoot; (trav != NULL) && (currentTraceBuffer == NULL); trav = trav->next)
+		{
+			currentTraceBuffer = trav->owned ? NULL : trav;
+		}
+		if (currentTraceBuffer == NULL)
+		{
+			currentTraceBuffer = calloc(1, sizeof(traceBuffer));
+			currentTraceBuffer->next = traceBufferRoot;
+			traceBufferRoot = currentTraceBuffer;
+		}
+		currentTraceBuffer->owned = true;
+		currentTraceBuffer->threadId = nextTraceThreadId++;
+		snprintf(currentTraceBuffer->threadName, sizeof(currentTraceBuffer->threadName), "thread %d", currentTraceBuffer->threadId);
+		pthread_mutex_unlock(&traceBuffersLock);
+	}
+	return currentTraceBuffer;
+}
+
+// gives up the ring buffer of the calling thread when it exits. its events stay in the buffer
+// until the next owner overwrites them
+void releaseTraceBuffer(void)
+{
+	if (currentTraceBuffer != NULL)
+	{
+		pthread_mutex_lock(&traceBuffersLock);
+		currentTraceBuffer->owned = false;
+		pthread_mutex_unlock(&traceBuffersLock);
+		currentTraceBuffer = NULL;
+	}
+}
+
+// names the calling thread in traces, e.g. after the connection it serves
+void nameTraceThread(char* name)
+{
+	if (tracingEnabled)
+	{
+		traceBuffer* buffer = getTraceBuffer();
+		pthread_mutex_lock(&traceBuffersLock);
+		snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", name);
+		pthread_mutex_unlock(&traceBuffersLock);
+	}
+}
+
+// starts timing a span. the clock is only read if tracing is enabled
+long long traceStart(void)
+{
+	return tracingEnabled ? monotonicNanoseconds() : 0;
+}
+
+// records the span since traceStart(), with an optional argument (argumentName NULL if none)
+void traceEnd(char* name, char* category, long long start, char* argumentName, long long argument)
+{
+	if (!tracingEnabled || (start == 0))
+	{
+		return;
+	}
+	traceBuffer* buffer = getTraceBuffer();
+	unsigned long long head = __atomic_load_n(&buffer->head, __ATOMIC_RELAXED);
+	traceEvent* event = &buffer->events[head % TRACE_BUFFER_EVENTS];
+	event->name = name;
+	event->category = category;
+	event->argumentName = argumentName;
+	event->argument = argument;
+	event->start = start;
+	event->duration = monotonicNanoseconds() - start;
+	event->threadId = buffer->threadId;
+	__atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// writes the events of every thread to a file as Chrome trace JSON (which Perfetto also opens).
+// threads keep recording while their buffers are copied, so events that may have been overwritten
+// during the copy are left out. returns the number of events written, -1 if the file cannot be opened
+long long writeTrace(char* fileName)
+{
+	FILE* fp = fopen(fileName, "w");
+	if (fp == NULL)
+	{
+		return -1;
+	}
+	traceEvent* events = malloc(TRACE_BUFFER_EVENTS * sizeof(traceEvent));
+	long long written = 0;
+	int pid = getpid();
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	pthread_mutex_lock(&traceBuffersLock);
+	for (traceBuffer* trav = traceBufferRoot; trav != NULL; trav = trav->next)
+	{
+		// copy the buffer, keeping the events that were not overwritten in the meantime
+		unsigned long long headBefore = __atomic_load_n(&trav->head, __ATOMIC_ACQUIRE);
+		unsigned long long copiedFrom = (headBefore > TRACE_BUFFER_EVENTS) ? headBefore - TRACE_BUFFER_EVENTS : 0;
+		for (unsigned long long i = copiedFrom; i < headBefore; i++)
+		{
+			events[i - copiedFrom] = trav->events[i % TRACE_BUFFER_EVENTS];
+		}
+		unsigned long long headAfter = __atomic_load_n(&trav->head, __ATOMIC_ACQUIRE);
+		unsigned long long first = (headAfter >= TRACE_BUFFER_EVENTS) ? headAfter - TRACE_BUFFER_EVENTS + 1 : 0;
+		first = (first > copiedFrom) ? first : copiedFrom;
+
+		// the thread's name, then its events with times in microseconds
+		if (trav->owned)
+		{
+			fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			        (written++ > 0) ? "," : "", pid, trav->threadId, trav->threadName);
+		}
+		for (unsigned long long i = first; i < headBefore; i++)
+		{
+			traceEvent* event = &events[i - copiedFrom];
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+			        (written++ > 0) ? "," : "", event->name, event->category, pid, event->threadId, event->start / 1e3, event->duration / 1e3);
+			if (event->argumentName != NULL)
+				fprintf(fp, ",\"args\":{\"%s\":%lld}", event->argumentName, event->argument);
+			fprintf(fp, "}");
+		}
+	}
+	pthread_mutex_unlock(&traceBuffersLock);
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	free(events);
+	return written;
+}